@@ -3,8 +3,6 @@
 
 #include <iostream>
 
-#include "glm/glm.hpp"
-
 GenericBezier::GenericBezier(Node * srcPoint, Node * dstPoint, float size_x, float size_y, float scale_x, float scale_y, GLWidget * glwidget, int channel, QColor color) {
 	setAcceptedMouseButtons(0);
 
@@ -20,6 +18,7 @@ GenericBezier::GenericBezier(Node * srcPoint, Node * dstPoint, float size_x, flo
 	nodes_.push_back(dstPoint);
 
 	points_ = new std::vector<QPointF>(2);
+    curve_ = AddCurve();
 
 	srcPoint->addBezier(this);
 	dstPoint->addBezier(this);
@@ -43,6 +42,7 @@ GenericBezier::GenericBezier(Node * srcPoint, Node * ctrlPoint, Node * dstPoint,
 	nodes_.push_back(dstPoint);
 
 	points_ = new std::vector<QPointF>(3);
+    curve_ = AddCurve();
 
 	srcPoint->addBezier(this);
 	ctrlPoint->addBezier(this);
@@ -68,6 +68,7 @@ GenericBezier::GenericBezier(Node * srcPoint, Node * ctrlPoint1, Node * ctrlPoin
 	nodes_.push_back(dstPoint);
 
 	points_ = new std::vector<QPointF>(4);
+    curve_ = AddCurve();
 
 	srcPoint->addBezier(this);
 	ctrlPoint1->addBezier(this);
@@ -91,6 +92,7 @@ GenericBezier::GenericBezier(std::vector<Node*>& nodes, float size_x, float size
     color_ = color;
 
 	points_ = new std::vector<QPointF>(nodes.size());
+    curve_ = AddCurve();
 
 	for (std::vector<Node *>::iterator itr = nodes_.begin(); itr != nodes_.end(); ++itr) {
 		(*itr)->addBezier(this);
@@ -125,6 +127,36 @@ void GenericBezier::adjust() {
 		}
 	}
 
+    Evaluate();
+}
+
+int GenericBezier::AddCurve() {
+    if (glwidget_ == nullptr) return -1;
+    return glwidget_->transfer_function_.AddCurve(channel_, points_->size());
+}
+
+void GenericBezier::Evaluate() {
+    /* The control points in (entry, value) coordinates */
+    control_points_.resize(points_->size());
+    for (size_t i = 0; i < points_->size(); i++)
+        control_points_[i] = Eigen::Vector2f(points_->at(i).x() / scale_x_, (size_y_ - points_->at(i).y()) / scale_y_);
+
+    /* The transfer function is only evaluated again if the nodes moved, and only the entries that changed are uploaded */
+    const std::vector<Eigen::Vector2f> * samples = &samples_;
+    if (curve_ >= 0) {
+        int first, last;
+        if (glwidget_->transfer_function_.SetControlPoints(curve_, control_points_, &first, &last))
+            glwidget_->SetTransferFunction(first, last);
+        samples = &glwidget_->transfer_function_.GetSamples(curve_);
+    } else {
+        data_visualization::TransferFunction::EvaluateBezier(control_points_, &samples_);
+    }
+
+    /* Cache the line drawn by paint() */
+    polyline_.resize(samples->size());
+    for (size_t i = 0; i < samples->size(); i++)
+        polyline_[i] = QPointF((*samples)[i].x() * scale_x_, size_y_ - (*samples)[i].y() * scale_y_);
+    update();
 }
 
 void GenericBezier::setScale(float scale) {
@@ -150,52 +182,8 @@ void GenericBezier::paint(QPainter * painter, const QStyleOptionGraphicsItem * o
 
 	painter->setPen(QPen(color_));
 
-    // One point for every x index is the minimum number of a good looking bezier curve
-	int manhattan_x = find([](QPointF * a, QPointF * b) -> bool {return a->x() < b->x(); })->x() - find([](QPointF * a, QPointF * b) -> bool {return a->x() > b->x(); })->x();
-	int manhattan_y = find([](QPointF * a, QPointF * b) -> bool {return a->y() < b->y(); })->y() - find([](QPointF * a, QPointF * b) -> bool {return a->y() > b->y(); })->y();
-	int min_points = sqrt(pow(manhattan_x, 2) + pow(manhattan_y, 2));
-
-    /* Use double the sampling rate of the distance between the two points, to make sure that the transfer function will not have unset values */
-    min_points = 2 * (min_points / scale_x_);
-    double step = 1.0 / double(min_points);
-    QPoint * points = static_cast<QPoint *>(malloc((min_points + 1) * sizeof(QPoint)));
-
-    /* Calculate bezier intermidiate points */
-	int n = nodes_.size() - 1;
-#pragma omp parallel for num_threads(4) shared(points, n, min_points)
-    for (int np = 0; np <= min_points; np++) {
-		double x = 0;
-		double y = 0;
-		double t = np*step;
-		for (int i = 0; i <= n; i++) {
-			int coeff = binomialCoeff(n, i);
-			x += coeff * pow((1 - t), n - i) * pow(t, i) * points_->at(i).x();
-			y += coeff * pow((1 - t), n - i) * pow(t, i) * points_->at(i).y();
-		}
-        points[np].setX(x);
-        points[np].setY(y);
-    }
-
-    /* Calculate actual transfer function data from the intermidiate points
-     * If min_points was big enough, we should cover all values within the range
-     */
-    if (glwidget_ != nullptr){
-        for(int i=0; i< min_points + 1; i++){
-            float x = points[i].x() / scale_x_;
-            float y = (size_y_ - (float) points[i].y())/scale_y_;
-            /* Data are stored rgbargbargba..., and the size is 256 * 4 */
-            int index = static_cast<int>(x) * 4 + channel_;
-            /* The user is free to move the nodes anywhere */
-            if (index < 0 || index >= 256*4) continue;
-            glwidget_->transfer_function_values_[index] = glm::clamp(y, 0.0f, 1.0f);
-        }
-        /* Draw transfer function */
-        glwidget_->SetTransferFunction();
-    }
-
-    /* Draw line */
-    painter->drawPolyline(points, min_points + 1);
-    delete points;
+    /* Draw line, evaluated when the nodes moved */
+    painter->drawPolyline(polyline_);
 }
 
 QPointF *  GenericBezier::find(bool(*f)(QPointF *, QPointF *)) const{
@@ -209,21 +197,3 @@ QPointF *  GenericBezier::find(bool(*f)(QPointF *, QPointF *)) const{
 	}
 	return current;
 }
-
-int GenericBezier::binomialCoeff(int n, int k) {
-	int ** C = new int*[n+1];
-	for (int i = 0; i < n+1; i++) C[i] = new int[k+1];
-
-	for (int i = 0; i <= n; i++) {
-		for (int j = 0; j <= std::min(i, k); j++) {
-			if (j == 0 || j == i) C[i][j] = 1;
-			else C[i][j] = C[i - 1][j - 1] + C[i - 1][j];
-		}
-	}
-	int result = C[n][k];
-
-	for (int i = 0; i < n + 1; i++) delete C[i];
-	delete C;
-
-	return result;
-}
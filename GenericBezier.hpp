@@ -5,7 +5,6 @@
 #include <vector>
 #include <algorithm>
 #include <exception>
-#include <omp.h>
 
 #include <qgraphicsitem.h>
 #include <qpainter.h>
@@ -58,8 +57,15 @@ private:
     GLWidget * glwidget_;
     int channel_;
 
+    /* Index of the curve in the transfer function of glwidget_, -1 if none */
+    int curve_;
+    std::vector<Eigen::Vector2f> control_points_;
+    std::vector<Eigen::Vector2f> samples_;
+    QPolygonF polyline_;
+
 	QPointF * find(bool(*f)(QPointF *, QPointF *)) const;
-	int binomialCoeff(int n, int k);
+    int AddCurve();
+    void Evaluate();
 };
 
 #endif
@@ -77,9 +77,6 @@ void Node::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
 	emit posChanged(x_position, y.toInt());
 
 	QGraphicsItem::mouseReleaseEvent(event);
-
-    /* At mouse releave event, make sure you updateGL(), because glwidget_->SetTransferFunction() may not always update */
-    glwidget_->updateGL();
 }
 
 void Node::mouseMoveEvent(QGraphicsSceneMouseEvent *event){
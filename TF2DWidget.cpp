@@ -0,0 +1,203 @@
+#include <TF2DWidget.hpp>
+
+#include <QColorDialog>
+#include <QMouseEvent>
+#include <QPainter>
+
+#include <algorithm>
+
+using data_visualization::kTransferFunction2DSize;
+using data_visualization::TransferFunctionRegion;
+
+namespace {
+
+/* Pixels around the top right corner of a region that resize it */
+const double kCornerSize = 8.0;
+
+/* Colors of the new regions, in turn */
+const QColor kRegionColors[] = {Qt::red, Qt::yellow, Qt::green, Qt::cyan,
+                                Qt::blue, Qt::magenta};
+const int kRegionColorCount = sizeof(kRegionColors) / sizeof(QColor);
+
+}  // namespace
+
+TF2DWidget::TF2DWidget(GLWidget * glwidget, QWidget *parent)
+    : QWidget(parent), glwidget_(glwidget), dragged_(-1), resizing_(false) {
+
+    setFixedSize(740, 256);
+
+    histogram_ = QImage(kTransferFunction2DSize, kTransferFunction2DSize,
+                        QImage::Format_RGB32);
+    histogram_.fill(Qt::white);
+}
+
+void TF2DWidget::SetHistogram(const std::vector<double>& histogram) {
+    const int kSize = kTransferFunction2DSize;
+    histogram_.fill(Qt::white);
+    if (histogram.size() != static_cast<size_t>(kSize * kSize)) {
+        update();
+        return;
+    }
+
+    /* The most frequent pairs are the darkest, magnitude upwards */
+    for (int j = 0; j < kSize; j++) {
+        QRgb * line = reinterpret_cast<QRgb *>(
+            histogram_.scanLine(kSize - 1 - j));
+        for (int i = 0; i < kSize; i++) {
+            const int kGray = 255 - static_cast<int>(200 * histogram[j * kSize + i]);
+            line[i] = qRgb(kGray, kGray, kGray);
+        }
+    }
+    update();
+}
+
+void TF2DWidget::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+
+    /* The histogram is only scaled, never drawn again */
+    painter.drawImage(rect(), histogram_);
+
+    const std::vector<TransferFunctionRegion>& regions =
+        glwidget_->transfer_function_2d_.GetRegions();
+    for (size_t i = 0; i < regions.size(); i++) {
+        const TransferFunctionRegion& region = regions[i];
+        const QRectF kRect = RegionRect(region);
+        QColor fill = QColor::fromRgbF(region.color[0], region.color[1],
+                                       region.color[2]);
+        fill.setAlphaF(0.2 + 0.5 * region.color[3]);
+
+        painter.setPen(QPen(Qt::black, static_cast<int>(i) == dragged_ ? 2 : 1));
+        painter.setBrush(fill);
+        painter.drawRect(kRect);
+
+        painter.setBrush(Qt::black);
+        painter.drawRect(QRectF(kRect.topRight() - QPointF(3, 3), QSizeF(6, 6)));
+    }
+}
+
+void TF2DWidget::mousePressEvent(QMouseEvent *event) {
+    const int kRegion = RegionAt(event->localPos());
+
+    if (event->button() == Qt::RightButton) {
+        if (kRegion < 0) return;
+        glwidget_->transfer_function_2d_.RemoveRegion(kRegion);
+        glwidget_->SetTransferFunction2D();
+        update();
+        return;
+    }
+    if (event->button() != Qt::LeftButton) return;
+
+    drag_start_ = ToTransferFunction(event->localPos());
+    if (kRegion >= 0) {
+        dragged_ = kRegion;
+        drag_region_ = glwidget_->transfer_function_2d_.GetRegions()[kRegion];
+        const QPointF kCorner = RegionRect(drag_region_).topRight();
+        resizing_ = (event->localPos() - kCorner).manhattanLength() < kCornerSize;
+        anchor_ = QPointF(drag_region_.density_min, drag_region_.magnitude_min);
+    } else {
+        /* A new region grows from the pressed point */
+        const size_t kCount = glwidget_->transfer_function_2d_.GetRegions().size();
+        const QColor kColor = kRegionColors[kCount % kRegionColorCount];
+        drag_region_ = TransferFunctionRegion();
+        drag_region_.density_min = drag_region_.density_max = drag_start_.x();
+        drag_region_.magnitude_min = drag_region_.magnitude_max = drag_start_.y();
+        drag_region_.color[0] = kColor.redF();
+        drag_region_.color[1] = kColor.greenF();
+        drag_region_.color[2] = kColor.blueF();
+        drag_region_.color[3] = 0.5f;
+        dragged_ = glwidget_->transfer_function_2d_.AddRegion(drag_region_);
+        resizing_ = true;
+        anchor_ = drag_start_;
+    }
+    update();
+}
+
+void TF2DWidget::mouseMoveEvent(QMouseEvent *event) {
+    if (dragged_ < 0) return;
+
+    const QPointF kPosition = ToTransferFunction(event->localPos());
+    TransferFunctionRegion region = drag_region_;
+    if (resizing_) {
+        region.density_min = std::min(anchor_.x(), kPosition.x());
+        region.density_max = std::max(anchor_.x(), kPosition.x());
+        region.magnitude_min = std::min(anchor_.y(), kPosition.y());
+        region.magnitude_max = std::max(anchor_.y(), kPosition.y());
+    } else {
+        /* Moved as a whole, inside the transfer function */
+        const float kDx = std::min(std::max(kPosition.x() - drag_start_.x(),
+            -static_cast<double>(region.density_min)),
+            1.0 - region.density_max);
+        const float kDy = std::min(std::max(kPosition.y() - drag_start_.y(),
+            -static_cast<double>(region.magnitude_min)),
+            1.0 - region.magnitude_max);
+        region.density_min += kDx;
+        region.density_max += kDx;
+        region.magnitude_min += kDy;
+        region.magnitude_max += kDy;
+    }
+    SetRegion(dragged_, region);
+}
+
+void TF2DWidget::mouseReleaseEvent(QMouseEvent *) {
+    if (dragged_ < 0) return;
+
+    /* A click that did not drag leaves no empty region behind */
+    const TransferFunctionRegion& region =
+        glwidget_->transfer_function_2d_.GetRegions()[dragged_];
+    if (region.density_max <= region.density_min ||
+        region.magnitude_max <= region.magnitude_min) {
+        glwidget_->transfer_function_2d_.RemoveRegion(dragged_);
+        glwidget_->SetTransferFunction2D();
+    }
+    dragged_ = -1;
+    update();
+}
+
+void TF2DWidget::mouseDoubleClickEvent(QMouseEvent *event) {
+    const int kRegion = RegionAt(event->localPos());
+    if (kRegion < 0) return;
+
+    TransferFunctionRegion region =
+        glwidget_->transfer_function_2d_.GetRegions()[kRegion];
+    const QColor kColor = QColorDialog::getColor(
+        QColor::fromRgbF(region.color[0], region.color[1], region.color[2],
+                         region.color[3]),
+        this, tr("Region color"), QColorDialog::ShowAlphaChannel);
+    if (!kColor.isValid()) return;
+
+    region.color[0] = kColor.redF();
+    region.color[1] = kColor.greenF();
+    region.color[2] = kColor.blueF();
+    region.color[3] = kColor.alphaF();
+    SetRegion(kRegion, region);
+}
+
+int TF2DWidget::RegionAt(const QPointF& position) const {
+    const std::vector<TransferFunctionRegion>& regions =
+        glwidget_->transfer_function_2d_.GetRegions();
+    for (int i = static_cast<int>(regions.size()) - 1; i >= 0; i--) {
+        const QRectF kRect = RegionRect(regions[i]).adjusted(
+            -kCornerSize / 2, -kCornerSize / 2, kCornerSize / 2, kCornerSize / 2);
+        if (kRect.contains(position)) return i;
+    }
+    return -1;
+}
+
+QRectF TF2DWidget::RegionRect(const TransferFunctionRegion& region) const {
+    return QRectF(QPointF(region.density_min * width(),
+                          (1.0 - region.magnitude_max) * height()),
+                  QPointF(region.density_max * width(),
+                          (1.0 - region.magnitude_min) * height()));
+}
+
+QPointF TF2DWidget::ToTransferFunction(const QPointF& position) const {
+    return QPointF(
+        std::min(std::max(position.x() / width(), 0.0), 1.0),
+        std::min(std::max(1.0 - position.y() / height(), 0.0), 1.0));
+}
+
+void TF2DWidget::SetRegion(int region, const TransferFunctionRegion& value) {
+    glwidget_->transfer_function_2d_.SetRegion(region, value);
+    glwidget_->SetTransferFunction2D();
+    update();
+}
@@ -0,0 +1,80 @@
+#ifndef TF2DWIDGET_H_
+#define TF2DWIDGET_H_
+
+#include <QImage>
+#include <QWidget>
+
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "glwidget.h"
+
+/**
+ * @brief TF2DWidget Editor of the 2D transfer function. The joint histogram of
+ * the volume, density along x and gradient magnitude upwards, is drawn once
+ * into a cached image, and the regions of the transfer function over it.
+ * Dragging on the histogram adds a region, dragging a region moves it and
+ * dragging its top right corner resizes it. A double click picks the color
+ * and opacity of a region, and a right click removes it.
+ */
+class TF2DWidget : public QWidget {
+  Q_OBJECT
+
+ public:
+  TF2DWidget(GLWidget * glwidget, QWidget *parent = 0);
+
+  /**
+   * @brief SetHistogram Draws the joint histogram into the cached image.
+   * @param histogram Bins normalized in [0, 1], rows by gradient magnitude.
+   */
+  void SetHistogram(const std::vector<double>& histogram);
+
+ protected:
+  void paintEvent(QPaintEvent *event);
+
+  void mousePressEvent(QMouseEvent *event);
+
+  void mouseMoveEvent(QMouseEvent *event);
+
+  void mouseReleaseEvent(QMouseEvent *event);
+
+  void mouseDoubleClickEvent(QMouseEvent *event);
+
+ private:
+  /**
+   * @brief RegionAt Returns the topmost region under a position, -1 if none.
+   */
+  int RegionAt(const QPointF& position) const;
+
+  /**
+   * @brief RegionRect Returns the rectangle of a region in the widget.
+   */
+  QRectF RegionRect(const data_visualization::TransferFunctionRegion& region)
+      const;
+
+  /**
+   * @brief ToTransferFunction Returns the density and the gradient magnitude
+   * at a position of the widget.
+   */
+  QPointF ToTransferFunction(const QPointF& position) const;
+
+  /**
+   * @brief SetRegion Sets a region and renders again.
+   */
+  void SetRegion(int region,
+                 const data_visualization::TransferFunctionRegion& value);
+
+  GLWidget * glwidget_;
+  QImage histogram_;
+
+  /* The region dragged, -1 if none, as it was when pressed, and the point
+   * that stays in place while it is resized */
+  int dragged_;
+  bool resizing_;
+  QPointF drag_start_;
+  QPointF anchor_;
+  data_visualization::TransferFunctionRegion drag_region_;
+};
+
+#endif  //  TF2DWIDGET_H_
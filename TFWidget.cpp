@@ -4,6 +4,7 @@
 #include "qlabel.h"
 
 #include "GraphWidget.hpp"
+#include "TF2DWidget.hpp"
 
 TFWidget::TFWidget(GLWidget * glwidget, QWidget *parent) : QWidget(parent) {
 
@@ -14,6 +15,8 @@ TFWidget::TFWidget(GLWidget * glwidget, QWidget *parent) : QWidget(parent) {
     green_ = new GraphWidget(250, 1, 1, glwidget, this);
     blue_ = new GraphWidget(250, 1, 2, glwidget, this);
     alpha_ = new GraphWidget(250, 1, 3, glwidget, this);
+    /* Used instead of the four curves with the 2D transfer function */
+    tf_2d_ = new TF2DWidget(glwidget, this);
 
     QVBoxLayout * layout = new QVBoxLayout();
     layout->addWidget(new QLabel("red"));
@@ -24,6 +27,8 @@ TFWidget::TFWidget(GLWidget * glwidget, QWidget *parent) : QWidget(parent) {
     layout->addWidget(blue_);
     layout->addWidget(new QLabel("alpha"));
     layout->addWidget(alpha_);
+    layout->addWidget(new QLabel("density x gradient magnitude"));
+    layout->addWidget(tf_2d_);
 
     setLayout(layout);
 }
@@ -35,6 +40,10 @@ void TFWidget::SetHistogram(std::vector<double>& histogram){
     alpha_->DrawHistogram(histogram);
 }
 
+void TFWidget::SetJointHistogram(const std::vector<double>& histogram){
+    tf_2d_->SetHistogram(histogram);
+}
+
 TFWidget::~TFWidget() {
 
 }
@@ -6,6 +6,7 @@
 #include <GL/glew.h>
 
 #include "GraphWidget.hpp"
+#include "TF2DWidget.hpp"
 #include "glwidget.h"
 
 class TFWidget : public QWidget {
@@ -18,10 +19,13 @@ class TFWidget : public QWidget {
 
   void SetHistogram(std::vector<double>& histogram);
 
+  void SetJointHistogram(const std::vector<double>& histogram);
+
  protected:
 
  private:
   GraphWidget * red_, * green_, * blue_, * alpha_;
+  TF2DWidget * tf_2d_;
 
  protected slots:
 
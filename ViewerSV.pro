@@ -18,34 +18,90 @@ CONFIG(debug, release|debug):OBJECTS_DIR = debug/
 CONFIG(debug, release|debug):MOC_DIR = debug/
 CONFIG(debug, release|debug):UI_DIR = debug/
 
+# Debug builds count the GL objects and the allocations of every frame
+CONFIG(debug, release|debug):DEFINES += VOLRENDAPP_FRAME_COUNTERS
+CONFIG(debug, release|debug):QMAKE_LFLAGS += -Wl,--wrap=glGenTextures
+
 INCLUDEPATH += /usr/include/eigen3/
 
 LIBS += -lGLEW  -lboost_system -lboost_filesystem -fopenmp
 
 SOURCES += \
+    accumulation_buffer.cc \
+    brick_cache.cc \
+    brick_store.cc \
     camera.cc \
+    classified_volume.cc \
+    cpu_raycaster.cc \
     cube.cc \
+    frame_counters.cc \
+    frame_governor.cc \
+    frame_profiler.cc \
     glwidget.cc \
+    isosurface.cc \
+    light_volume.cc \
     main.cc \
     main_window.cc \
+    mesh.cc \
+    occupancy_grid.cc \
+    preintegration_table.cc \
+    raycast_program.cc \
+    render_target.cc \
+    reprojection_buffer.cc \
+    shader_variants.cc \
+    transfer_function.cc \
+    transfer_function_2d.cc \
+    transfer_function_texture.cc \
     volume.cc \
+    volume_file.cc \
     volume_io.cc \
+    volume_loader.cc \
+    volume_stream.cc \
     *.cpp
 
 HEADERS  += \
+    accumulation_buffer.h \
+    brick_cache.h \
+    brick_store.h \
     camera.h \
+    classified_volume.h \
+    cpu_raycaster.h \
     cube.h \
+    frame_counters.h \
+    frame_governor.h \
+    frame_profiler.h \
     glwidget.h \
+    isosurface.h \
+    light_volume.h \
     main_window.h \
+    mesh.h \
+    occupancy_grid.h \
+    preintegration_table.h \
+    raycast_program.h \
+    render_target.h \
+    reprojection_buffer.h \
+    shader_variants.h \
+    transfer_function.h \
+    transfer_function_2d.h \
+    transfer_function_texture.h \
     volume.h \
+    volume_file.h \
     volume_io.h \
+    volume_loader.h \
+    volume_stream.h \
     *.hpp\
 
 FORMS    += \
     main_window.ui
 
 DISTFILES += \
+    shaders/light_volume.frag \
+    shaders/light_volume.vert \
+    shaders/mesh.frag \
+    shaders/mesh.vert \
     shaders/raycast.frag \
-    shaders/raycast.vert
+    shaders/raycast.vert \
+    shaders/reproject.frag \
+    shaders/reproject.vert
 
 
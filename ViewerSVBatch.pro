@@ -0,0 +1,47 @@
+QT       += core gui opengl
+
+TARGET = ViewerSVBatch
+TEMPLATE = app
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+CONFIG(release, release|debug):QMAKE_CXXFLAGS += -Wall -O2 -fopenmp
+
+CONFIG(release, release|debug):DESTDIR = release/
+CONFIG(release, release|debug):OBJECTS_DIR = release/batch/
+CONFIG(release, release|debug):MOC_DIR = release/batch/
+
+CONFIG(debug, release|debug):DESTDIR = debug/
+CONFIG(debug, release|debug):OBJECTS_DIR = debug/batch/
+CONFIG(debug, release|debug):MOC_DIR = debug/batch/
+
+INCLUDEPATH += /usr/include/eigen3/
+
+LIBS += -lGLEW  -lboost_system -lboost_filesystem -fopenmp
+
+SOURCES += \
+    batch_main.cc \
+    brick_cache.cc \
+    brick_store.cc \
+    camera.cc \
+    cpu_raycaster.cc \
+    occupancy_grid.cc \
+    preintegration_table.cc \
+    transfer_function_2d.cc \
+    volume.cc \
+    volume_file.cc \
+    volume_io.cc \
+    volume_stream.cc
+
+HEADERS  += \
+    brick_cache.h \
+    brick_store.h \
+    camera.h \
+    cpu_raycaster.h \
+    occupancy_grid.h \
+    preintegration_table.h \
+    transfer_function_2d.h \
+    volume.h \
+    volume_file.h \
+    volume_io.h \
+    volume_stream.h
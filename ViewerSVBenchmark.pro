@@ -0,0 +1,65 @@
+QT       += core gui opengl
+
+TARGET = ViewerSVBenchmark
+TEMPLATE = app
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+CONFIG(release, release|debug):QMAKE_CXXFLAGS += -Wall -O2 -fopenmp
+
+CONFIG(release, release|debug):DESTDIR = release/
+CONFIG(release, release|debug):OBJECTS_DIR = release/benchmark/
+CONFIG(release, release|debug):MOC_DIR = release/benchmark/
+
+CONFIG(debug, release|debug):DESTDIR = debug/
+CONFIG(debug, release|debug):OBJECTS_DIR = debug/benchmark/
+CONFIG(debug, release|debug):MOC_DIR = debug/benchmark/
+
+INCLUDEPATH += /usr/include/eigen3/
+
+LIBS += -lGLEW -lEGL -lboost_system -lboost_filesystem -fopenmp
+
+SOURCES += \
+    benchmark_main.cc \
+    brick_cache.cc \
+    brick_store.cc \
+    camera.cc \
+    cpu_raycaster.cc \
+    cube.cc \
+    light_volume.cc \
+    occupancy_grid.cc \
+    offscreen_context.cc \
+    preintegration_table.cc \
+    raycast_program.cc \
+    render_target.cc \
+    shader_variants.cc \
+    synthetic_volume.cc \
+    transfer_function.cc \
+    transfer_function_2d.cc \
+    transfer_function_texture.cc \
+    volume.cc \
+    volume_file.cc \
+    volume_io.cc \
+    volume_stream.cc
+
+HEADERS  += \
+    brick_cache.h \
+    brick_store.h \
+    camera.h \
+    cpu_raycaster.h \
+    cube.h \
+    light_volume.h \
+    occupancy_grid.h \
+    offscreen_context.h \
+    preintegration_table.h \
+    raycast_program.h \
+    render_target.h \
+    shader_variants.h \
+    synthetic_volume.h \
+    transfer_function.h \
+    transfer_function_2d.h \
+    transfer_function_texture.h \
+    volume.h \
+    volume_file.h \
+    volume_io.h \
+    volume_stream.h
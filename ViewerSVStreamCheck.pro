@@ -0,0 +1,43 @@
+QT       += core gui
+
+TARGET = ViewerSVStreamCheck
+TEMPLATE = app
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+CONFIG(release, release|debug):QMAKE_CXXFLAGS += -Wall -O2 -fopenmp
+
+CONFIG(release, release|debug):DESTDIR = release/
+CONFIG(release, release|debug):OBJECTS_DIR = release/stream_check/
+CONFIG(release, release|debug):MOC_DIR = release/stream_check/
+
+CONFIG(debug, release|debug):DESTDIR = debug/
+CONFIG(debug, release|debug):OBJECTS_DIR = debug/stream_check/
+CONFIG(debug, release|debug):MOC_DIR = debug/stream_check/
+
+INCLUDEPATH += /usr/include/eigen3/
+
+LIBS += -lGLEW -lEGL -lboost_system -lboost_filesystem -fopenmp
+
+SOURCES += \
+    brick_cache.cc \
+    brick_store.cc \
+    occupancy_grid.cc \
+    offscreen_context.cc \
+    stream_check_main.cc \
+    synthetic_volume.cc \
+    volume.cc \
+    volume_file.cc \
+    volume_io.cc \
+    volume_stream.cc
+
+HEADERS  += \
+    brick_cache.h \
+    brick_store.h \
+    occupancy_grid.h \
+    offscreen_context.h \
+    synthetic_volume.h \
+    volume.h \
+    volume_file.h \
+    volume_io.h \
+    volume_stream.h
@@ -0,0 +1,75 @@
+#include <accumulation_buffer.h>
+
+namespace data_visualization {
+
+AccumulationBuffer::AccumulationBuffer()
+    : framebuffer_(0), color_(0), depth_(0), width_(0), height_(0) {}
+
+AccumulationBuffer::~AccumulationBuffer() { Release(); }
+
+bool AccumulationBuffer::Resize(int width, int height) {
+  if (framebuffer_ != 0 && width == width_ && height == height_) return false;
+
+  Release();
+  width_ = width;
+  height_ = height;
+
+  /* Renderbuffers, the average is only ever blitted */
+  glGenRenderbuffers(1, &color_);
+  glBindRenderbuffer(GL_RENDERBUFFER, color_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA32F, width_, height_);
+  glGenRenderbuffers(1, &depth_);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width_,
+                        height_);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &framebuffer_);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, color_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  return true;
+}
+
+void AccumulationBuffer::BeginPass(float weight) {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  if (weight >= 1.0f) {
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  } else {
+    glClear(GL_DEPTH_BUFFER_BIT);
+  }
+
+  /* average = weight * pass + (1 - weight) * average */
+  glEnable(GL_BLEND);
+  glBlendColor(0.0f, 0.0f, 0.0f, weight);
+  glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+}
+
+void AccumulationBuffer::EndPass() {
+  glDisable(GL_BLEND);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void AccumulationBuffer::Display() {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_,
+                    GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void AccumulationBuffer::Release() {
+  if (framebuffer_ != 0) glDeleteFramebuffers(1, &framebuffer_);
+  if (color_ != 0) glDeleteRenderbuffers(1, &color_);
+  if (depth_ != 0) glDeleteRenderbuffers(1, &depth_);
+  framebuffer_ = 0;
+  color_ = 0;
+  depth_ = 0;
+}
+
+}  // namespace data_visualization
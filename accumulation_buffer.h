@@ -0,0 +1,72 @@
+#ifndef ACCUMULATION_BUFFER_H_
+#define ACCUMULATION_BUFFER_H_
+
+#include <GL/glew.h>
+
+namespace data_visualization {
+
+/**
+ * @brief AccumulationBuffer A floating point framebuffer, the size of the
+ * viewport, holding the running average of the passes of the progressive
+ * mode. Every pass is rendered into it with constant blending, weighted by
+ * one over the number of passes so far, so averaging takes no extra draw.
+ * The average is then copied to the default framebuffer, also when nothing
+ * changed and no pass is rendered.
+ */
+class AccumulationBuffer {
+ public:
+  /**
+   * @brief AccumulationBuffer Constructor of the class.
+   */
+  AccumulationBuffer();
+
+  /**
+   * @brief ~AccumulationBuffer Destructor of the class. Calls Release.
+   */
+  ~AccumulationBuffer();
+
+  AccumulationBuffer(const AccumulationBuffer&) = delete;
+  AccumulationBuffer& operator=(const AccumulationBuffer&) = delete;
+
+  /**
+   * @brief Resize Allocates the framebuffer for a viewport size, if it
+   * changed. Requires the GL context to be current.
+   * @return Whether it was allocated, the average is lost then.
+   */
+  bool Resize(int width, int height);
+
+  /**
+   * @brief BeginPass Binds the framebuffer and sets up the blending so that
+   * the colors drawn are weighted into the average. A weight of one clears
+   * the average to white. The pass must draw opaque colors, and set no
+   * blending of its own.
+   * @param weight The weight of the pass, one over the number of passes.
+   */
+  void BeginPass(float weight);
+
+  /**
+   * @brief EndPass Disables the blending and binds the default framebuffer.
+   */
+  void EndPass();
+
+  /**
+   * @brief Display Copies the average to the default framebuffer.
+   */
+  void Display();
+
+  /**
+   * @brief Release Deletes the framebuffer and its attachments.
+   */
+  void Release();
+
+ private:
+  GLuint framebuffer_;
+  GLuint color_;
+  GLuint depth_;
+  int width_;
+  int height_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  ACCUMULATION_BUFFER_H_
@@ -0,0 +1,278 @@
+// Renders the views listed in a job file offscreen, with the CPU ray caster:
+//
+//   ViewerSVBatch job.json
+//
+// {
+//   "volume": "path/to/stack",
+//   "output": "frames",
+//   "width": 512, "height": 512,
+//   "transfer_function": [{"density": 0.3, "color": [1, 0.8, 0.6, 0.05]},
+//                         {"density": 1.0, "color": [1, 1, 1, 0.8]}],
+//   "light": {"position": [1, 1, 1], "color": [1, 1, 1]},
+//   "phong": true, "shadows": true, "preintegrated": false,
+//   "step_scale": 1,
+//   "cameras": [{"rotation_x": 0.3, "rotation_y": 0, "distance": 2}],
+//   "turntable": {"frames": 36, "rotation_x": 0.3, "distance": 2}
+// }
+//
+// The transfer function is interpolated linearly between its control points
+// (densities in [0, 1]) and is transparent outside them. The turntable adds
+// frames evenly spaced around the Y axis after the listed cameras. Frames are
+// written to output/frame_0000.png, and so on.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./camera.h"
+#include "./cpu_raycaster.h"
+#include "./volume_file.h"
+#include "./volume_io.h"
+
+namespace {
+
+const float kFieldOfView = 60;
+const float kZNear = 0.1;
+const float kZFar = 10;
+
+const int kDefaultSize = 512;
+
+/* Number of entries of the transfer function */
+const int kTransferFunctionSize = 256;
+
+/**
+ * @brief CameraPose A view of the volume, as set by data_visualization::Camera.
+ */
+struct CameraPose {
+  double rotation_x, rotation_y, distance;
+};
+
+/**
+ * @brief BatchJob The volume, shading and views to render.
+ */
+struct BatchJob {
+  std::string volume;
+  QString output;
+  int width, height;
+  std::vector<float> transfer_function;
+  data_visualization::RaycastSettings settings;
+  std::vector<CameraPose> cameras;
+};
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+Eigen::Vector3f ReadVector(const QJsonValue &value,
+                           const Eigen::Vector3f &fallback) {
+  const QJsonArray kArray = value.toArray();
+  if (kArray.size() != 3) return fallback;
+  return Eigen::Vector3f(kArray[0].toDouble(), kArray[1].toDouble(),
+                         kArray[2].toDouble());
+}
+
+CameraPose ReadPose(const QJsonObject &object) {
+  CameraPose pose;
+  pose.rotation_x = object["rotation_x"].toDouble(0.0);
+  pose.rotation_y = object["rotation_y"].toDouble(0.0);
+  pose.distance = object["distance"].toDouble(2.0);
+  return pose;
+}
+
+/**
+ * @brief ReadTransferFunction Samples the control points of a transfer
+ * function, sorted by density, into kTransferFunctionSize rgba entries.
+ */
+bool ReadTransferFunction(const QJsonArray &points,
+                          std::vector<float> *transfer_function) {
+  std::vector<std::pair<double, QJsonArray>> controls;
+  for (const QJsonValue &point : points) {
+    const QJsonArray kColor = point.toObject()["color"].toArray();
+    if (kColor.size() != 4) return false;
+    controls.emplace_back(point.toObject()["density"].toDouble(), kColor);
+  }
+  if (controls.empty()) return false;
+  std::stable_sort(controls.begin(), controls.end(),
+                   [](const std::pair<double, QJsonArray> &a,
+                      const std::pair<double, QJsonArray> &b) {
+                     return a.first < b.first;
+                   });
+
+  transfer_function->assign(4 * kTransferFunctionSize, 0.0f);
+  for (int i = 0; i < kTransferFunctionSize; ++i) {
+    const double kDensity = i / (kTransferFunctionSize - 1.0);
+    if (kDensity < controls.front().first || kDensity > controls.back().first)
+      continue;
+
+    size_t next = 0;
+    while (next + 1 < controls.size() && controls[next].first < kDensity)
+      ++next;
+    const size_t kPrevious = next == 0 ? 0 : next - 1;
+    const double kSpan = controls[next].first - controls[kPrevious].first;
+    const double kWeight =
+        kSpan > 0.0 ? (kDensity - controls[kPrevious].first) / kSpan : 1.0;
+    for (int c = 0; c < 4; ++c)
+      (*transfer_function)[4 * i + c] =
+          (1.0 - kWeight) * controls[kPrevious].second[c].toDouble() +
+          kWeight * controls[next].second[c].toDouble();
+  }
+
+  return true;
+}
+
+bool ReadJob(const QString &filename, BatchJob *job) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    std::cerr << "Error " << filename.toStdString() << " not found."
+              << std::endl;
+    return false;
+  }
+
+  QJsonParseError error;
+  const QJsonDocument kDocument = QJsonDocument::fromJson(file.readAll(),
+                                                          &error);
+  if (!kDocument.isObject()) {
+    std::cerr << "Invalid job file: " << error.errorString().toStdString()
+              << std::endl;
+    return false;
+  }
+  const QJsonObject kJob = kDocument.object();
+
+  job->volume = kJob["volume"].toString().toStdString();
+  job->output = kJob["output"].toString(".");
+  job->width = kJob["width"].toInt(kDefaultSize);
+  job->height = kJob["height"].toInt(kDefaultSize);
+  if (job->volume.empty() || job->width <= 0 || job->height <= 0) {
+    std::cerr << "The job needs a volume and a positive image size."
+              << std::endl;
+    return false;
+  }
+
+  if (!ReadTransferFunction(kJob["transfer_function"].toArray(),
+                            &job->transfer_function)) {
+    std::cerr << "The transfer function needs control points with a density "
+                 "and an rgba color."
+              << std::endl;
+    return false;
+  }
+
+  data_visualization::RaycastSettings &settings = job->settings;
+  const QJsonObject kLight = kJob["light"].toObject();
+  settings.light_position =
+      ReadVector(kLight["position"], settings.light_position);
+  settings.light_color = ReadVector(kLight["color"], settings.light_color);
+  settings.phong = kJob["phong"].toBool(settings.phong);
+  settings.shadows = kJob["shadows"].toBool(settings.shadows);
+  settings.preintegrated = kJob["preintegrated"].toBool(settings.preintegrated);
+  settings.step_scale = kJob["step_scale"].toDouble(settings.step_scale);
+
+  for (const QJsonValue &camera : kJob["cameras"].toArray())
+    job->cameras.push_back(ReadPose(camera.toObject()));
+
+  const QJsonObject kTurntable = kJob["turntable"].toObject();
+  const int kTurntableFrames = kTurntable["frames"].toInt(0);
+  for (int i = 0; i < kTurntableFrames; ++i) {
+    CameraPose pose = ReadPose(kTurntable);
+    pose.rotation_y += 2.0 * M_PI * i / kTurntableFrames;
+    job->cameras.push_back(pose);
+  }
+
+  if (job->cameras.empty()) {
+    std::cerr << "The job has no cameras." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " job.json" << std::endl;
+    return 1;
+  }
+
+  BatchJob job;
+  if (!ReadJob(argv[1], &job)) return 1;
+  if (!QDir().mkpath(job.output)) {
+    std::cerr << "Could not create " << job.output.toStdString() << std::endl;
+    return 1;
+  }
+
+  /* The volume is loaded once and shared by every frame */
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  data_representation::VolumeFile volume;
+  if (!data_representation::MapDicomVolume(job.volume, &volume)) {
+    std::cerr << "Could not load the volume " << job.volume << std::endl;
+    return 1;
+  }
+  const data_representation::VolumeFileHeader &header = volume.GetHeader();
+  const double kLoadTime = ElapsedMilliseconds(start);
+
+  start = std::chrono::steady_clock::now();
+  data_visualization::CpuRaycaster raycaster;
+  raycaster.SetVolume(volume.GetData(), header.width, header.height,
+                      header.depth);
+  raycaster.SetTransferFunction(job.transfer_function);
+  const double kSetupTime = ElapsedMilliseconds(start);
+
+  std::cout << "Volume " << header.width << " x " << header.height << " x "
+            << header.depth << " loaded in " << kLoadTime
+            << " ms, prepared in " << kSetupTime << " ms" << std::endl;
+
+  /* The volume is rendered in the unit cube, as in the viewer */
+  data_visualization::Camera camera;
+  camera.UpdateModel(Eigen::Vector3f::Constant(-0.5f),
+                     Eigen::Vector3f::Constant(0.5f));
+  camera.SetViewportSize(job.width, job.height);
+  const Eigen::Matrix4f kProjection =
+      camera.SetProjection(kFieldOfView, kZNear, kZFar);
+  const Eigen::Matrix4f kModel = camera.SetModel();
+
+  std::vector<unsigned char> image;
+  std::vector<double> times;
+  for (size_t i = 0; i < job.cameras.size(); ++i) {
+    const CameraPose &pose = job.cameras[i];
+    camera.SetPose(pose.rotation_x, pose.rotation_y, pose.distance);
+
+    start = std::chrono::steady_clock::now();
+    raycaster.Render(kProjection, camera.SetView(), kModel, job.settings,
+                     job.width, job.height, &image);
+    times.push_back(ElapsedMilliseconds(start));
+
+    const QString kFilename = QString("%1/frame_%2.png")
+                                  .arg(job.output)
+                                  .arg(i, 4, 10, QChar('0'));
+    if (!QImage(image.data(), job.width, job.height, QImage::Format_RGBA8888)
+             .save(kFilename)) {
+      std::cerr << "Could not write " << kFilename.toStdString() << std::endl;
+      return 1;
+    }
+  }
+
+  /* The first frame also sweeps the light volume and builds the tables */
+  double total = 0.0;
+  for (double time : times) total += time;
+  std::cout << times.size() << " frames of " << job.width << " x "
+            << job.height << " rendered in " << total << " ms, "
+            << 1000.0 * times.size() / total << " fps (first frame "
+            << times.front() << " ms)" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,606 @@
+// Renders a synthetic volume from a fixed orbit of cameras and reports the
+// milliseconds per frame of every render mode and resolution as JSON:
+//
+//   ViewerSVBenchmark --shape phantom --size 128 --sparsity 0.7 --seed 1
+//                     --preset ct --frames 36 --resolutions 256,512
+//                     --modes composite,mip,minip,average --edits 1000
+//                     --backend gl --shaders ../shaders --output out.json
+//
+// The gl backend ray casts with the shaders of the viewer (raycast.frag, with
+// the empty space skipping and precomputed gradients of a loaded volume) in
+// an offscreen EGL context, which Mesa provides with llvmpipe on machines
+// without a GPU, and waits for every frame to finish. Where no context can be
+// created it falls back to the CPU ray caster, which --backend cpu selects.
+// The volume, transfer function and orbit depend only on the options, so two
+// runs on the same machine render the same frames. Every mode and resolution
+// renders one untimed frame first, which sweeps the light volume and builds
+// the tables, and then the orbit. The transfer function editor is measured
+// too: every edit moves a node of the default curves of a channel (as laid
+// out by GraphWidget) and evaluates the two curves it joins, in microseconds:
+//
+// {
+//   "backend": "gl", "renderer": "llvmpipe (LLVM 15.0.7, 256 bits)",
+//   "shape": "phantom", "size": 128, "sparsity": 0.7, "seed": 1,
+//   "preset": "ct", "frames": 36, "threads": 8,
+//   "results": [{"mode": "composite", "width": 256, "height": 256,
+//                "min": 10.1, "p50": 11.0, "p90": 12.3, "p99": 13.0,
+//                "max": 13.2, "mean": 11.2}],
+//   "transfer_function": {"edits": 1000, "min": 1.1, "p50": 1.6, ...}
+// }
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <omp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "./camera.h"
+#include "./cpu_raycaster.h"
+#include "./cube.h"
+#include "./light_volume.h"
+#include "./occupancy_grid.h"
+#include "./offscreen_context.h"
+#include "./preintegration_table.h"
+#include "./raycast_program.h"
+#include "./render_target.h"
+#include "./shader_variants.h"
+#include "./synthetic_volume.h"
+#include "./transfer_function.h"
+#include "./transfer_function_texture.h"
+#include "./volume_io.h"
+
+namespace {
+
+const float kFieldOfView = 60;
+const float kZNear = 0.1;
+const float kZFar = 10;
+
+/* The orbit, around the Y axis */
+const double kOrbitRotationX = 0.3;
+const double kOrbitDistance = 2.0;
+
+/* Number of entries of the transfer function */
+const int kTransferFunctionSize = 256;
+
+/* The nodes of a channel in the transfer function editor, joined by lines */
+const float kEditorNodes[] = {-1.0f, 50.0f, 100.0f, 150.0f, 200.0f, 256.0f};
+const int kEditorNodeCount = 6;
+
+/**
+ * @brief ControlPoint A control point of a transfer function preset.
+ */
+struct ControlPoint {
+  float density;
+  float color[4];
+};
+
+/**
+ * @brief TransferFunctionPreset A fixed transfer function, interpolated
+ * linearly between its control points and transparent outside them.
+ */
+struct TransferFunctionPreset {
+  const char *name;
+  std::vector<ControlPoint> points;
+};
+
+const TransferFunctionPreset kPresets[] = {
+    /* Soft tissue faint, bone opaque */
+    {"ct",
+     {{0.1f, {0.8f, 0.4f, 0.3f, 0.0f}},
+      {0.25f, {0.9f, 0.6f, 0.5f, 0.05f}},
+      {0.5f, {1.0f, 0.9f, 0.8f, 0.3f}},
+      {1.0f, {1.0f, 1.0f, 1.0f, 0.9f}}}},
+    /* Rays stop early */
+    {"opaque",
+     {{0.05f, {0.9f, 0.9f, 0.9f, 0.0f}}, {0.1f, {0.9f, 0.9f, 0.9f, 1.0f}},
+      {1.0f, {1.0f, 1.0f, 1.0f, 1.0f}}}},
+    /* Rays cross the whole volume */
+    {"translucent",
+     {{0.0f, {0.2f, 0.4f, 1.0f, 0.0f}}, {1.0f, {1.0f, 0.8f, 0.4f, 0.02f}}}}};
+
+/**
+ * @brief BenchmarkMode A render mode and its name in the options and the
+ * report.
+ */
+struct BenchmarkMode {
+  const char *name;
+  data_visualization::RenderMode mode;
+};
+
+const BenchmarkMode kModes[] = {
+    {"composite", data_visualization::kComposite},
+    {"mip", data_visualization::kMaximumIntensity},
+    {"minip", data_visualization::kMinimumIntensity},
+    {"average", data_visualization::kAverageIntensity}};
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+/**
+ * @brief SamplePreset Samples the control points of a preset into
+ * kTransferFunctionSize rgba entries.
+ */
+std::vector<float> SamplePreset(const TransferFunctionPreset &preset) {
+  const std::vector<ControlPoint> &kPoints = preset.points;
+  std::vector<float> transfer_function(4 * kTransferFunctionSize, 0.0f);
+  for (int i = 0; i < kTransferFunctionSize; ++i) {
+    const float kDensity = i / (kTransferFunctionSize - 1.0f);
+    if (kDensity < kPoints.front().density ||
+        kDensity > kPoints.back().density)
+      continue;
+
+    size_t next = 0;
+    while (next + 1 < kPoints.size() && kPoints[next].density < kDensity)
+      ++next;
+    const size_t kPrevious = next == 0 ? 0 : next - 1;
+    const float kSpan = kPoints[next].density - kPoints[kPrevious].density;
+    const float kWeight =
+        kSpan > 0.0f ? (kDensity - kPoints[kPrevious].density) / kSpan : 1.0f;
+    for (int c = 0; c < 4; ++c)
+      transfer_function[4 * i + c] =
+          (1.0f - kWeight) * kPoints[kPrevious].color[c] +
+          kWeight * kPoints[next].color[c];
+  }
+  return transfer_function;
+}
+
+/**
+ * @brief Percentile Returns the nearest rank percentile of sorted times.
+ */
+double Percentile(const std::vector<double> &sorted, double percentile) {
+  const size_t kRank = std::max(
+      1.0, std::ceil(percentile / 100.0 * sorted.size()));
+  return sorted[kRank - 1];
+}
+
+QJsonObject Summarize(std::vector<double> times) {
+  std::sort(times.begin(), times.end());
+  double total = 0.0;
+  for (double time : times) total += time;
+
+  QJsonObject summary;
+  summary["min"] = times.front();
+  summary["p50"] = Percentile(times, 50);
+  summary["p90"] = Percentile(times, 90);
+  summary["p99"] = Percentile(times, 99);
+  summary["max"] = times.back();
+  summary["mean"] = total / times.size();
+  return summary;
+}
+
+/**
+ * @brief BenchmarkEdits Moves random inner nodes of the editor curves of
+ * every channel and returns the microseconds of every edit.
+ */
+std::vector<double> BenchmarkEdits(int edits, unsigned int seed) {
+  data_visualization::TransferFunction transfer_function;
+  std::vector<std::vector<Eigen::Vector2f>> nodes(4);
+  int first, last;
+  for (int channel = 0; channel < 4; ++channel) {
+    for (float x : kEditorNodes)
+      nodes[channel].emplace_back(x, 0.0f);
+    for (int i = 0; i + 1 < kEditorNodeCount; ++i)
+      transfer_function.SetControlPoints(
+          transfer_function.AddCurve(channel, 2),
+          {nodes[channel][i], nodes[channel][i + 1]}, &first, &last);
+  }
+
+  std::mt19937 random(seed);
+  std::vector<Eigen::Vector2f> control_points(2);
+  std::vector<double> times(edits);
+  for (int edit = 0; edit < edits; ++edit) {
+    const int kChannel = random() % 4;
+    const int kNode = 1 + random() % (kEditorNodeCount - 2);
+    Eigen::Vector2f &node = nodes[kChannel][kNode];
+    node.y() = (random() >> 8) / static_cast<float>(1 << 24);
+
+    const std::chrono::steady_clock::time_point kStart =
+        std::chrono::steady_clock::now();
+    for (int i = kNode - 1; i <= kNode; ++i) {
+      control_points[0] = nodes[kChannel][i];
+      control_points[1] = nodes[kChannel][i + 1];
+      transfer_function.SetControlPoints(
+          kChannel * (kEditorNodeCount - 1) + i, control_points, &first,
+          &last);
+    }
+    times[edit] = 1000.0 * ElapsedMilliseconds(kStart);
+  }
+  return times;
+}
+
+/**
+ * @brief GlRaycaster Renders with shaders/raycast.frag in an offscreen
+ * context, through the programs and inputs of GLWidget::RenderVolume, with
+ * the light volume, occupancy grid and precomputed gradients of the viewer,
+ * into a framebuffer of the resolution.
+ */
+class GlRaycaster {
+ public:
+  /**
+   * @brief GlRaycaster Constructor of the class.
+   * @param shaders Directory of the shaders.
+   */
+  explicit GlRaycaster(const std::string &shaders)
+      : program_(shaders + "/raycast.vert", shaders + "/raycast.frag",
+                 data_visualization::kRaycastFeatures,
+                 data_visualization::kRaycastInterface),
+        program_light_(shaders + "/light_volume.vert",
+                       shaders + "/light_volume.frag") {}
+
+  /**
+   * @brief ~GlRaycaster Destructor of the class. The context must still be
+   * current.
+   */
+  ~GlRaycaster() {
+    glDeleteTextures(1, &volume_);
+    glDeleteTextures(1, &gradients_);
+    glDeleteBuffers(1, &frame_uniforms_);
+  }
+
+  GlRaycaster(const GlRaycaster &) = delete;
+  GlRaycaster &operator=(const GlRaycaster &) = delete;
+
+  /**
+   * @brief Init Reads the shaders and uploads the volume, its gradients and
+   * occupancy, as the viewer does for a loaded volume. Requires the context
+   * to be current.
+   * @return Whether the shaders could be read.
+   */
+  bool Init(const std::vector<unsigned char> &voxels, int size,
+            const std::vector<float> &transfer_function) {
+    if (!program_.Load() || !program_light_.Load()) return false;
+
+    size_ = Eigen::Vector3i::Constant(size);
+    transfer_function_ = transfer_function;
+    transfer_function_texture_.Update(transfer_function_);
+
+    volume_ = data_representation::CreateVolumeTexture(size, size, size);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, size, size, size, GL_RED,
+                    GL_UNSIGNED_BYTE, voxels.data());
+    glGenerateMipmap(GL_TEXTURE_3D);
+
+    std::vector<unsigned char> gradients(4 * voxels.size());
+    data_representation::ComputeGradients(voxels.data(), size, size, size,
+                                          gradients.data());
+    gradients_ = data_representation::CreateGradientTexture(
+        gradients.data(), size, size, size);
+
+    occupancy_.Init(size, size, size, data_representation::kOccupancyCellSize);
+    occupancy_.Accumulate(voxels.data(), 0, size);
+
+    cube_.reset(new data_representation::Cube);
+
+    /* The state of GLWidget::initializeGL */
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glEnable(GL_DEPTH_TEST);
+
+    glGenBuffers(1, &frame_uniforms_);
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_uniforms_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(data_visualization::FrameBlock),
+                 nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, data_visualization::kFrameBinding,
+                     frame_uniforms_);
+
+    return true;
+  }
+
+  /**
+   * @brief Render Renders a frame and waits for the GPU to finish it. The
+   * light volume, the tables and the classification of the occupancy are
+   * only updated when the settings change, as in the viewer.
+   * @return Whether the variant of the program could be built.
+   */
+  bool Render(const Eigen::Matrix4f &projection, const Eigen::Matrix4f &view,
+              const Eigen::Matrix4f &model,
+              const data_visualization::RaycastSettings &settings, int width,
+              int height) {
+    data_visualization::RaycastOptions options;
+    options.mode = settings.mode;
+    options.phong = settings.phong;
+    options.shadows = settings.shadows;
+    options.preintegrated = settings.preintegrated;
+    options.skip_empty = true;
+    options.precomputed_gradients = true;
+    const unsigned int kVariant =
+        data_visualization::GetRaycastVariant(options);
+    const data_visualization::ShaderVariants::Program &kProgram =
+        program_.Get(kVariant);
+    const GLuint kLightProgram = program_light_.Get(0).id;
+    if (kProgram.id == 0 || kLightProgram == 0) return false;
+
+    data_visualization::FrameBlock frame = {};
+    std::copy_n(projection.data(), 16, frame.projection);
+    std::copy_n(view.data(), 16, frame.view);
+    std::copy_n(model.data(), 16, frame.model);
+    std::copy_n(settings.light_position.data(), 3, frame.light_position);
+    std::copy_n(settings.light_color.data(), 3, frame.light_color);
+    frame.step_scale = settings.step_scale;
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_uniforms_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+
+    target_.Resize(width, height);
+    target_.Bind(1.0f);
+
+    if (kVariant & data_visualization::kShadowsFeature)
+      light_volume_.Update(
+          kLightProgram, volume_, size_,
+          transfer_function_texture_.GetTextureId(), transfer_function_,
+          settings.light_position + Eigen::Vector3f::Constant(0.5f));
+    if (kVariant & data_visualization::kPreintegratedFeature)
+      preintegration_table_.Update(transfer_function_, settings.step_scale);
+    occupancy_.Update(transfer_function_);
+
+    data_visualization::RaycastInputs inputs;
+    inputs.volume = volume_;
+    inputs.volume_size = size_;
+    inputs.transfer_function = transfer_function_texture_.GetTextureId();
+    inputs.occupancy = &occupancy_;
+    inputs.gradients = gradients_;
+    inputs.light_volume = light_volume_.GetTextureId();
+    inputs.light_axes = light_volume_.GetAxes();
+    inputs.preintegration_table = preintegration_table_.GetTextureId();
+    data_visualization::RenderRaycast(kProgram, kVariant, inputs,
+                                      cube_.get());
+
+    glFinish();
+    return true;
+  }
+
+ private:
+  data_visualization::ShaderVariants program_;
+  data_visualization::ShaderVariants program_light_;
+  std::unique_ptr<data_representation::Cube> cube_;
+  data_visualization::TransferFunctionTexture transfer_function_texture_;
+  data_visualization::LightVolume light_volume_;
+  data_visualization::PreintegrationTable preintegration_table_;
+  data_visualization::RenderTarget target_;
+  data_representation::OccupancyGrid occupancy_;
+  std::vector<float> transfer_function_;
+  Eigen::Vector3i size_ = Eigen::Vector3i::Zero();
+  GLuint volume_ = 0;
+  GLuint gradients_ = 0;
+  GLuint frame_uniforms_ = 0;
+};
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Orbit benchmark of the ray casters on a synthetic volume");
+  parser.addHelpOption();
+  const QCommandLineOption kShape(
+      "shape", "Volume: sphere, noise or phantom.", "shape", "phantom");
+  const QCommandLineOption kSize("size", "Voxels along every edge.", "size",
+                                 "128");
+  const QCommandLineOption kSparsity(
+      "sparsity", "Fraction of empty voxels.", "fraction", "0.7");
+  const QCommandLineOption kSeed("seed", "Seed of the noise.", "seed", "1");
+  const QCommandLineOption kPreset(
+      "preset", "Transfer function: ct, opaque or translucent.", "preset",
+      "ct");
+  const QCommandLineOption kFrames("frames", "Cameras of the orbit.",
+                                   "frames", "36");
+  const QCommandLineOption kResolutions(
+      "resolutions", "Comma separated square image sizes.", "sizes",
+      "256,512");
+  const QCommandLineOption kModeList(
+      "modes", "Comma separated modes: composite, mip, minip, average.",
+      "modes", "composite,mip,minip,average");
+  const QCommandLineOption kEdits(
+      "edits", "Transfer function edits timed, none if 0.", "edits", "1000");
+  const QCommandLineOption kOutput(
+      "output", "JSON report file, the standard output by default.", "file");
+  const QCommandLineOption kBackend(
+      "backend",
+      "Ray caster: gl (shaders/raycast.frag, the CPU one without OpenGL) or "
+      "cpu.",
+      "backend", "gl");
+  const QCommandLineOption kShaders(
+      "shaders", "Directory of the shaders of the gl backend.", "directory",
+      "../shaders");
+  parser.addOptions({kShape, kSize, kSparsity, kSeed, kPreset, kFrames,
+                     kResolutions, kModeList, kEdits, kOutput, kBackend,
+                     kShaders});
+  parser.process(app);
+
+  data_representation::SyntheticShape shape;
+  const std::string kShapeName = parser.value(kShape).toStdString();
+  if (!data_representation::ParseSyntheticShape(kShapeName, &shape)) {
+    std::cerr << "Unknown shape " << kShapeName << std::endl;
+    return 1;
+  }
+
+  const TransferFunctionPreset *preset = nullptr;
+  for (const TransferFunctionPreset &candidate : kPresets)
+    if (parser.value(kPreset) == candidate.name) preset = &candidate;
+  if (preset == nullptr) {
+    std::cerr << "Unknown preset " << parser.value(kPreset).toStdString()
+              << std::endl;
+    return 1;
+  }
+
+  if (parser.value(kBackend) != "gl" && parser.value(kBackend) != "cpu") {
+    std::cerr << "Unknown backend " << parser.value(kBackend).toStdString()
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<const BenchmarkMode *> modes;
+  for (const QString &name : parser.value(kModeList).split(',')) {
+    const BenchmarkMode *mode = nullptr;
+    for (const BenchmarkMode &candidate : kModes)
+      if (name == candidate.name) mode = &candidate;
+    if (mode == nullptr) {
+      std::cerr << "Unknown mode " << name.toStdString() << std::endl;
+      return 1;
+    }
+    modes.push_back(mode);
+  }
+
+  std::vector<int> resolutions;
+  for (const QString &resolution : parser.value(kResolutions).split(',')) {
+    bool valid = false;
+    resolutions.push_back(resolution.toInt(&valid));
+    if (!valid || resolutions.back() <= 0) {
+      std::cerr << "Invalid resolution " << resolution.toStdString()
+                << std::endl;
+      return 1;
+    }
+  }
+
+  bool valid_size = false, valid_sparsity = false, valid_seed = false,
+       valid_frames = false, valid_edits = false;
+  const int kVolumeSize = parser.value(kSize).toInt(&valid_size);
+  const float kVolumeSparsity =
+      parser.value(kSparsity).toFloat(&valid_sparsity);
+  const unsigned int kVolumeSeed = parser.value(kSeed).toUInt(&valid_seed);
+  const int kOrbitFrames = parser.value(kFrames).toInt(&valid_frames);
+  const int kTransferFunctionEdits = parser.value(kEdits).toInt(&valid_edits);
+  if (!valid_size || kVolumeSize <= 0 || !valid_sparsity || !valid_seed ||
+      !valid_frames || kOrbitFrames <= 0 || !valid_edits ||
+      kTransferFunctionEdits < 0) {
+    std::cerr << "The size and frames must be positive, the edits not "
+                 "negative, the sparsity and seed numbers."
+              << std::endl;
+    return 1;
+  }
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<unsigned char> voxels;
+  data_representation::GenerateVolume(shape, kVolumeSize, kVolumeSize,
+                                      kVolumeSize, kVolumeSparsity,
+                                      kVolumeSeed, &voxels);
+  const double kGenerateTime = ElapsedMilliseconds(start);
+
+  /* The GL ray caster renders in an offscreen context, Mesa llvmpipe on
+   * machines without a GPU, and the CPU one where there is no OpenGL */
+  start = std::chrono::steady_clock::now();
+  data_visualization::OffscreenContext context;
+  std::unique_ptr<GlRaycaster> gl_raycaster;
+  data_visualization::CpuRaycaster raycaster;
+  if (parser.value(kBackend) == "gl" && context.Create()) {
+    gl_raycaster.reset(
+        new GlRaycaster(parser.value(kShaders).toStdString()));
+    if (!gl_raycaster->Init(voxels, kVolumeSize, SamplePreset(*preset))) {
+      std::cerr << "Could not read the shaders in "
+                << parser.value(kShaders).toStdString() << std::endl;
+      return 1;
+    }
+    std::cerr << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+  } else {
+    if (parser.value(kBackend) == "gl")
+      std::cerr << "Falling back to the CPU ray caster" << std::endl;
+    raycaster.SetVolume(voxels.data(), kVolumeSize, kVolumeSize, kVolumeSize);
+    raycaster.SetTransferFunction(SamplePreset(*preset));
+  }
+  const double kSetupTime = ElapsedMilliseconds(start);
+
+  std::cerr << "Volume " << kVolumeSize << "^3 generated in " << kGenerateTime
+            << " ms, prepared in " << kSetupTime << " ms" << std::endl;
+
+  /* The volume is rendered in the unit cube, as in the viewer */
+  data_visualization::Camera camera;
+  camera.UpdateModel(Eigen::Vector3f::Constant(-0.5f),
+                     Eigen::Vector3f::Constant(0.5f));
+  const Eigen::Matrix4f kModel = camera.SetModel();
+
+  QJsonArray results;
+  std::vector<unsigned char> image;
+  std::vector<double> times(kOrbitFrames);
+  for (int resolution : resolutions) {
+    camera.SetViewportSize(resolution, resolution);
+    const Eigen::Matrix4f kProjection =
+        camera.SetProjection(kFieldOfView, kZNear, kZFar);
+
+    for (const BenchmarkMode *mode : modes) {
+      data_visualization::RaycastSettings settings;
+      settings.mode = mode->mode;
+
+      for (int i = -1; i < kOrbitFrames; ++i) {
+        camera.SetPose(kOrbitRotationX,
+                       2.0 * M_PI * std::max(i, 0) / kOrbitFrames,
+                       kOrbitDistance);
+        start = std::chrono::steady_clock::now();
+        if (gl_raycaster == nullptr) {
+          raycaster.Render(kProjection, camera.SetView(), kModel, settings,
+                           resolution, resolution, &image);
+        } else if (!gl_raycaster->Render(kProjection, camera.SetView(),
+                                         kModel, settings, resolution,
+                                         resolution)) {
+          std::cerr << "Could not build the program of " << mode->name
+                    << std::endl;
+          return 1;
+        }
+        if (i >= 0) times[i] = ElapsedMilliseconds(start);
+      }
+
+      QJsonObject result = Summarize(times);
+      result["mode"] = mode->name;
+      result["width"] = resolution;
+      result["height"] = resolution;
+      results.append(result);
+
+      std::cerr << mode->name << " " << resolution << " x " << resolution
+                << ": " << result["p50"].toDouble() << " ms median"
+                << std::endl;
+    }
+  }
+
+  QJsonObject report;
+  report["backend"] = gl_raycaster != nullptr ? "gl" : "cpu";
+  if (gl_raycaster != nullptr)
+    report["renderer"] = reinterpret_cast<const char *>(
+        glGetString(GL_RENDERER));
+  report["shape"] = parser.value(kShape);
+  report["size"] = kVolumeSize;
+  report["sparsity"] = kVolumeSparsity;
+  report["seed"] = static_cast<qint64>(kVolumeSeed);
+  report["preset"] = preset->name;
+  report["frames"] = kOrbitFrames;
+  report["threads"] = omp_get_max_threads();
+  report["results"] = results;
+  if (kTransferFunctionEdits > 0) {
+    QJsonObject edits =
+        Summarize(BenchmarkEdits(kTransferFunctionEdits, kVolumeSeed));
+    edits["edits"] = kTransferFunctionEdits;
+    report["transfer_function"] = edits;
+    std::cerr << "Transfer function edit: " << edits["p50"].toDouble()
+              << " us median" << std::endl;
+  }
+  const QByteArray kJson =
+      QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+  if (!parser.isSet(kOutput)) {
+    std::cout << kJson.constData();
+    return 0;
+  }
+  QFile file(parser.value(kOutput));
+  if (!file.open(QIODevice::WriteOnly) || file.write(kJson) != kJson.size()) {
+    std::cerr << "Could not write " << parser.value(kOutput).toStdString()
+              << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+#include <brick_cache.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "./occupancy_grid.h"
+
+namespace data_representation {
+
+namespace {
+
+/* Bricks uploaded per frame, bounds the stall of a frame */
+const int kMaxUploadsPerFrame = 16;
+
+const size_t kStoredBrickVoxels = static_cast<size_t>(kStoredBrickSize) *
+                                  kStoredBrickSize * kStoredBrickSize;
+
+}  // namespace
+
+BrickCache::BrickCache()
+    : atlas_id_(0), page_table_id_(0), slots_{0, 0, 0}, frame_(0) {}
+
+BrickCache::~BrickCache() { Release(); }
+
+bool BrickCache::Init(std::unique_ptr<BrickStore> store, size_t budget,
+                      int max_texture_size) {
+  Release();
+  store_ = std::move(store);
+
+  const BrickStoreHeader& header = store_->GetHeader();
+  const int kBrickCount = store_->GetBrickCount();
+  const int kMaxSlots = max_texture_size / kStoredBrickSize;
+  const int kCapacity = static_cast<int>(std::min<size_t>(
+      std::min<size_t>(budget / kStoredBrickVoxels, kBrickCount),
+      static_cast<size_t>(kMaxSlots) * kMaxSlots * kMaxSlots));
+  if (kCapacity == 0) return false;
+
+  slots_[0] = std::min(kMaxSlots, static_cast<int>(std::cbrt(kCapacity)));
+  slots_[0] = std::max(1, slots_[0]);
+  slots_[1] = std::max(
+      1, std::min(kMaxSlots,
+                  static_cast<int>(std::sqrt(kCapacity / slots_[0]))));
+  slots_[2] = std::max(
+      1, std::min(kMaxSlots, kCapacity / (slots_[0] * slots_[1])));
+  const int kSlotCount = slots_[0] * slots_[1] * slots_[2];
+
+  glGenTextures(1, &atlas_id_);
+  glBindTexture(GL_TEXTURE_3D, atlas_id_);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  if (GLEW_ARB_texture_storage)
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_R8, slots_[0] * kStoredBrickSize,
+                   slots_[1] * kStoredBrickSize, slots_[2] * kStoredBrickSize);
+  else
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, slots_[0] * kStoredBrickSize,
+                 slots_[1] * kStoredBrickSize, slots_[2] * kStoredBrickSize, 0,
+                 GL_RED, GL_UNSIGNED_BYTE, nullptr);
+
+  page_table_.assign(4 * kBrickCount, 0);
+  glGenTextures(1, &page_table_id_);
+  glBindTexture(GL_TEXTURE_3D, page_table_id_);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8UI, header.bricks[0],
+               header.bricks[1], header.bricks[2], 0, GL_RGBA_INTEGER,
+               GL_UNSIGNED_BYTE, page_table_.data());
+
+  slot_brick_.assign(kSlotCount, -1);
+  brick_slot_.assign(kBrickCount, -1);
+  slot_frame_.assign(kSlotCount, 0);
+  lru_.clear();
+  lru_position_.resize(kSlotCount);
+  for (int i = 0; i < kSlotCount; ++i)
+    lru_position_[i] = lru_.insert(lru_.end(), i);
+  frame_ = 0;
+  order_.clear();
+  order_opaque_.clear();
+
+  std::cout << "Out-of-core volume: " << kBrickCount << " bricks, "
+            << kSlotCount << " resident at most ("
+            << (kSlotCount * kStoredBrickVoxels >> 20) << " MB)" << std::endl;
+
+  return true;
+}
+
+void BrickCache::Release() {
+  if (atlas_id_ != 0) glDeleteTextures(1, &atlas_id_);
+  if (page_table_id_ != 0) glDeleteTextures(1, &page_table_id_);
+  atlas_id_ = 0;
+  page_table_id_ = 0;
+}
+
+bool BrickCache::Update(const Eigen::Vector3f& eye,
+                        const std::vector<float>& transfer_function) {
+  const BrickStoreHeader& header = store_->GetHeader();
+  ++frame_;
+
+  /* opaque[i] is the number of non transparent entries below density i,
+   * kept in a member so that the frames do not allocate */
+  std::vector<int>& opaque = opaque_;
+  opaque.assign(transfer_function.size() / 4 + 1, 0);
+  for (size_t i = 0; i + 1 < opaque.size(); ++i)
+    opaque[i + 1] = opaque[i] + (transfer_function[4 * i + 3] >
+                                     kTransparentAlpha);
+
+  /* The needed bricks are sorted again only when the eye or the transfer
+   * function change */
+  if (opaque != order_opaque_ || eye != order_eye_) {
+    order_opaque_ = opaque;
+    order_eye_ = eye;
+    order_.clear();
+
+    std::vector<float>& distance = distance_;
+    distance.resize(store_->GetBrickCount());
+    for (int i = 0; i < store_->GetBrickCount(); ++i) {
+      const unsigned char* range = store_->GetBrickRange(i);
+      if (opaque[std::min<size_t>(range[1] + 1, opaque.size() - 1)] -
+              opaque[std::min<size_t>(range[0], opaque.size() - 1)] ==
+          0)
+        continue;
+
+      const int kX = i % header.bricks[0];
+      const int kY = (i / header.bricks[0]) % header.bricks[1];
+      const int kZ = i / (header.bricks[0] * header.bricks[1]);
+      const Eigen::Vector3f kCenter(
+          (kX + 0.5f) * kBrickSize / header.width,
+          (kY + 0.5f) * kBrickSize / header.height,
+          (kZ + 0.5f) * kBrickSize / header.depth);
+      distance[i] = (kCenter - eye).squaredNorm();
+      order_.push_back(i);
+    }
+
+    std::sort(order_.begin(), order_.end(), [&distance](int a, int b) {
+      return distance[a] < distance[b];
+    });
+  }
+
+  const size_t kWanted = std::min(order_.size(), slot_brick_.size());
+
+  /* Resident bricks are kept first, so they are not evicted below */
+  for (size_t i = 0; i < kWanted; ++i)
+    if (brick_slot_[order_[i]] >= 0) Touch(brick_slot_[order_[i]]);
+
+  bool missing = false;
+  bool changed = false;
+  int uploads = 0;
+  glBindTexture(GL_TEXTURE_3D, atlas_id_);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (size_t i = 0; i < kWanted; ++i) {
+    const int kBrick = order_[i];
+    if (brick_slot_[kBrick] >= 0) continue;
+
+    const int kSlot = lru_.back();
+    if (uploads == kMaxUploadsPerFrame || slot_frame_[kSlot] == frame_) {
+      missing = true;
+      break;
+    }
+
+    if (slot_brick_[kSlot] >= 0) {
+      brick_slot_[slot_brick_[kSlot]] = -1;
+      page_table_[4 * slot_brick_[kSlot] + 3] = 0;
+    }
+
+    const int kSlotX = kSlot % slots_[0];
+    const int kSlotY = (kSlot / slots_[0]) % slots_[1];
+    const int kSlotZ = kSlot / (slots_[0] * slots_[1]);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, kSlotX * kStoredBrickSize,
+                    kSlotY * kStoredBrickSize, kSlotZ * kStoredBrickSize,
+                    kStoredBrickSize, kStoredBrickSize, kStoredBrickSize,
+                    GL_RED, GL_UNSIGNED_BYTE, store_->GetBrick(kBrick));
+
+    slot_brick_[kSlot] = kBrick;
+    brick_slot_[kBrick] = kSlot;
+    page_table_[4 * kBrick] = kSlotX;
+    page_table_[4 * kBrick + 1] = kSlotY;
+    page_table_[4 * kBrick + 2] = kSlotZ;
+    page_table_[4 * kBrick + 3] = 255;
+    Touch(kSlot);
+
+    ++uploads;
+    changed = true;
+  }
+
+  if (changed) {
+    glBindTexture(GL_TEXTURE_3D, page_table_id_);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, header.bricks[0],
+                    header.bricks[1], header.bricks[2], GL_RGBA_INTEGER,
+                    GL_UNSIGNED_BYTE, page_table_.data());
+  }
+
+  return missing;
+}
+
+GLuint BrickCache::GetAtlasTextureId() const { return atlas_id_; }
+
+GLuint BrickCache::GetPageTableTextureId() const { return page_table_id_; }
+
+Eigen::Vector3f BrickCache::GetAtlasSize() const {
+  return Eigen::Vector3f(slots_[0], slots_[1], slots_[2]) * kStoredBrickSize;
+}
+
+const BrickStore& BrickCache::GetStore() const { return *store_; }
+
+void BrickCache::Touch(int slot) {
+  slot_frame_[slot] = frame_;
+  lru_.splice(lru_.begin(), lru_, lru_position_[slot]);
+}
+
+}  // namespace data_representation
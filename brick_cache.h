@@ -0,0 +1,130 @@
+#ifndef BRICK_CACHE_H_
+#define BRICK_CACHE_H_
+
+#include <GL/glew.h>
+
+#include <eigen3/Eigen/Geometry>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "./brick_store.h"
+
+namespace data_representation {
+
+/**
+ * @brief BrickCache Keeps the bricks of an out-of-core volume that are needed
+ * for rendering in a GPU texture atlas, within a memory budget. An
+ * indirection texture (page table) maps every brick of the volume to its slot
+ * in the atlas, or marks it as not resident. Slots are recycled in least
+ * recently used order.
+ */
+class BrickCache {
+ public:
+  /**
+   * @brief BrickCache Constructor of the class.
+   */
+  BrickCache();
+
+  /**
+   * @brief ~BrickCache Destructor of the class. Calls Release.
+   */
+  ~BrickCache();
+
+  BrickCache(const BrickCache&) = delete;
+  BrickCache& operator=(const BrickCache&) = delete;
+
+  /**
+   * @brief Init Creates the atlas and the page table.
+   * @param store The brick store the bricks are streamed from.
+   * @param budget Maximum size of the atlas, in bytes.
+   * @param max_texture_size GL_MAX_3D_TEXTURE_SIZE.
+   * @return Whether at least one brick fits in the budget.
+   */
+  bool Init(std::unique_ptr<BrickStore> store, size_t budget,
+            int max_texture_size);
+
+  /**
+   * @brief Release Deletes the textures.
+   */
+  void Release();
+
+  /**
+   * @brief Update Makes resident the bricks that are not transparent under the
+   * transfer function, nearest to the eye first, uploading a bounded number
+   * of bricks per call.
+   * @param eye Eye position, in texture coordinates.
+   * @param transfer_function The transfer function values, rgbargba...
+   * @return Whether needed bricks are still missing.
+   */
+  bool Update(const Eigen::Vector3f& eye,
+              const std::vector<float>& transfer_function);
+
+  /**
+   * @brief GetAtlasTextureId Returns the id of the 3D atlas texture.
+   */
+  GLuint GetAtlasTextureId() const;
+
+  /**
+   * @brief GetPageTableTextureId Returns the id of the page table texture.
+   */
+  GLuint GetPageTableTextureId() const;
+
+  /**
+   * @brief GetAtlasSize Returns the size of the atlas, in voxels.
+   */
+  Eigen::Vector3f GetAtlasSize() const;
+
+  /**
+   * @brief GetStore Returns the brick store.
+   */
+  const BrickStore& GetStore() const;
+
+ private:
+  /**
+   * @brief Touch Marks a slot as used by the current frame.
+   */
+  void Touch(int slot);
+
+  std::unique_ptr<BrickStore> store_;
+
+  GLuint atlas_id_;
+  GLuint page_table_id_;
+
+  /**
+   * @brief slots_ Number of slots of the atlas along every axis.
+   */
+  int slots_[3];
+
+  std::vector<int> slot_brick_;
+  std::vector<int> brick_slot_;
+  std::vector<unsigned int> slot_frame_;
+  std::list<int> lru_;
+  std::vector<std::list<int>::iterator> lru_position_;
+  unsigned int frame_;
+
+  /**
+   * @brief page_table_ Host copy of the page table, the slot coordinates of
+   * every brick and 255 if it is resident, rgbargba...
+   */
+  std::vector<unsigned char> page_table_;
+
+  /**
+   * @brief order_ The bricks needed for the last eye and transfer function,
+   * nearest first.
+   */
+  std::vector<int> order_;
+  Eigen::Vector3f order_eye_;
+  std::vector<int> order_opaque_;
+
+  /**
+   * @brief opaque_ distance_ Scratch space of Update.
+   */
+  std::vector<int> opaque_;
+  std::vector<float> distance_;
+};
+
+}  // namespace data_representation
+
+#endif  //  BRICK_CACHE_H_
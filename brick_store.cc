@@ -0,0 +1,292 @@
+#include <brick_store.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "./volume_io.h"
+
+namespace data_representation {
+
+namespace {
+
+const char kMagic[8] = {'V', 'R', 'B', 'R', 'K', 0, 0, 0};
+const uint32_t kVersion = 1;
+const uint64_t kDataAlignment = 4096;
+
+/* The longest edge of the overview, in voxels */
+const int kOverviewSize = 256;
+
+const size_t kStoredBrickVoxels = static_cast<size_t>(kStoredBrickSize) *
+                                  kStoredBrickSize * kStoredBrickSize;
+
+size_t BrickCount(const BrickStoreHeader& header) {
+  return static_cast<size_t>(header.bricks[0]) * header.bricks[1] *
+         header.bricks[2];
+}
+
+size_t OverviewVoxels(const BrickStoreHeader& header) {
+  return static_cast<size_t>(header.overview[0]) * header.overview[1] *
+         header.overview[2];
+}
+
+}  // namespace
+
+BrickStore::BrickStore() : mapping_(nullptr), mapping_size_(0) {}
+
+BrickStore::~BrickStore() { Close(); }
+
+bool BrickStore::Build(const std::vector<boost::filesystem::path>& paths,
+                       int width, int height, uint64_t source_key,
+                       const std::string& filename,
+                       std::atomic<int>* built_slices,
+                       const std::atomic<bool>* cancelled) {
+  const int kDepth = paths.size();
+  const int kDims[3] = {width, height, kDepth};
+  const int kFactor =
+      std::max(1, (std::max(width, std::max(height, kDepth)) + kOverviewSize -
+                   1) / kOverviewSize);
+
+  BrickStoreHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.brick_size = kBrickSize;
+  header.apron = kBrickApron;
+  header.width = width;
+  header.height = height;
+  header.depth = kDepth;
+  for (int i = 0; i < 3; ++i) {
+    header.bricks[i] = (kDims[i] + kBrickSize - 1) / kBrickSize;
+    header.overview[i] = (kDims[i] + kFactor - 1) / kFactor;
+  }
+  header.source_key = source_key;
+  header.range_offset = sizeof(BrickStoreHeader);
+  header.overview_offset = header.range_offset + 2 * BrickCount(header);
+  header.data_offset =
+      (header.overview_offset + OverviewVoxels(header) + kDataAlignment - 1) /
+      kDataAlignment * kDataAlignment;
+
+  const std::string kTemporary = filename + ".tmp";
+  std::ofstream outfile(kTemporary.c_str(), std::ios::binary);
+  if (!outfile.is_open()) return false;
+
+  /* The tables are only known at the end, reserve their space */
+  std::vector<char> reserved(header.data_offset, 0);
+  outfile.write(reserved.data(), reserved.size());
+
+  const size_t kSliceVoxels = static_cast<size_t>(width) * height;
+  std::vector<unsigned char> ranges(2 * BrickCount(header));
+  std::vector<uint32_t> overview_sum(OverviewVoxels(header), 0);
+  std::vector<double> histogram(kHistogramSize, 0.0);
+  std::vector<unsigned char> layer(kStoredBrickSize * kSliceVoxels);
+  std::vector<unsigned char> row(header.bricks[0] * kStoredBrickVoxels);
+
+  bool failed = false;
+  for (int bz = 0; bz < header.bricks[2] && !failed; ++bz) {
+    if (cancelled != nullptr && *cancelled) {
+      failed = true;
+      break;
+    }
+
+    /* The slices of a brick layer, apron included */
+    const int kFirst = std::max(0, bz * kBrickSize - kBrickApron);
+    const int kLast = std::min(kDepth, (bz + 1) * kBrickSize + kBrickApron);
+    if (!DecodeDicomSlices(paths, kFirst, kLast - kFirst, width, height,
+                           layer.data())) {
+      failed = true;
+      break;
+    }
+
+    const int kInteriorBegin = bz * kBrickSize;
+    const int kInteriorEnd = std::min(kDepth, kInteriorBegin + kBrickSize);
+    const unsigned char* interior =
+        layer.data() + (kInteriorBegin - kFirst) * kSliceVoxels;
+    AccumulateHistogram(interior,
+                        (kInteriorEnd - kInteriorBegin) * kSliceVoxels,
+                        &histogram);
+
+    /* Every thread owns a row of the overview */
+#pragma omp parallel for
+    for (int oy = 0; oy < header.overview[1]; ++oy) {
+      for (int z = kInteriorBegin; z < kInteriorEnd; ++z) {
+        uint32_t* overview_row =
+            &overview_sum[(static_cast<size_t>(z / kFactor) *
+                               header.overview[1] +
+                           oy) *
+                          header.overview[0]];
+        for (int y = oy * kFactor; y < std::min(height, (oy + 1) * kFactor);
+             ++y) {
+          const unsigned char* line =
+              layer.data() + (z - kFirst) * kSliceVoxels +
+              static_cast<size_t>(y) * width;
+          for (int x = 0; x < width; ++x) overview_row[x / kFactor] += line[x];
+        }
+      }
+    }
+
+    for (int by = 0; by < header.bricks[1]; ++by) {
+#pragma omp parallel for
+      for (int bx = 0; bx < header.bricks[0]; ++bx) {
+        unsigned char* brick = row.data() + bx * kStoredBrickVoxels;
+        unsigned char brick_min = 255, brick_max = 0;
+
+        /* Voxels outside the volume replicate its border */
+        int xs[kStoredBrickSize];
+        for (int i = 0; i < kStoredBrickSize; ++i)
+          xs[i] = std::min(width - 1,
+                           std::max(0, bx * kBrickSize - kBrickApron + i));
+
+        for (int lz = 0; lz < kStoredBrickSize; ++lz) {
+          const int kZ = std::min(
+              kDepth - 1, std::max(0, bz * kBrickSize - kBrickApron + lz));
+          for (int ly = 0; ly < kStoredBrickSize; ++ly) {
+            const int kY = std::min(
+                height - 1, std::max(0, by * kBrickSize - kBrickApron + ly));
+            const unsigned char* line = layer.data() +
+                                        (kZ - kFirst) * kSliceVoxels +
+                                        static_cast<size_t>(kY) * width;
+            unsigned char* dst =
+                brick + (lz * kStoredBrickSize + ly) * kStoredBrickSize;
+            for (int lx = 0; lx < kStoredBrickSize; ++lx) {
+              dst[lx] = line[xs[lx]];
+              brick_min = std::min(brick_min, dst[lx]);
+              brick_max = std::max(brick_max, dst[lx]);
+            }
+          }
+        }
+
+        const size_t kIndex =
+            bx + header.bricks[0] *
+                     (by + static_cast<size_t>(header.bricks[1]) * bz);
+        ranges[2 * kIndex] = brick_min;
+        ranges[2 * kIndex + 1] = brick_max;
+      }
+
+      outfile.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    if (built_slices != nullptr) *built_slices = kInteriorEnd;
+  }
+
+  if (failed || !outfile.good()) {
+    outfile.close();
+    std::remove(kTemporary.c_str());
+    return false;
+  }
+
+  /* Box filtered overview */
+  std::vector<unsigned char> overview(OverviewVoxels(header));
+  for (int oz = 0; oz < header.overview[2]; ++oz) {
+    const int kCountZ = std::min(kFactor, kDepth - oz * kFactor);
+    for (int oy = 0; oy < header.overview[1]; ++oy) {
+      const int kCountY = std::min(kFactor, height - oy * kFactor);
+      for (int ox = 0; ox < header.overview[0]; ++ox) {
+        const int kCountX = std::min(kFactor, width - ox * kFactor);
+        const size_t kIndex =
+            (static_cast<size_t>(oz) * header.overview[1] + oy) *
+                header.overview[0] +
+            ox;
+        overview[kIndex] = overview_sum[kIndex] / (kCountX * kCountY * kCountZ);
+      }
+    }
+  }
+
+  std::copy(histogram.begin(), histogram.end(), header.histogram);
+  outfile.seekp(0);
+  outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  outfile.write(reinterpret_cast<const char*>(ranges.data()), ranges.size());
+  outfile.write(reinterpret_cast<const char*>(overview.data()),
+                overview.size());
+  outfile.close();
+
+  if (!outfile.good() || std::rename(kTemporary.c_str(), filename.c_str())) {
+    std::remove(kTemporary.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+std::string BrickStore::Filename(uint64_t source_key) {
+  return boost::filesystem::path(VolumeCacheFilename(source_key))
+      .replace_extension(".bricks")
+      .string();
+}
+
+bool BrickStore::Open(const std::string& filename) {
+  Close();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      static_cast<size_t>(file_stat.st_size) < sizeof(BrickStoreHeader)) {
+    close(fd);
+    return false;
+  }
+
+  mapping_size_ = file_stat.st_size;
+  mapping_ = mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    return false;
+  }
+
+  /* Bricks are read in any order */
+  madvise(mapping_, mapping_size_, MADV_RANDOM);
+
+  const BrickStoreHeader& header = GetHeader();
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.brick_size != kBrickSize ||
+      header.apron != kBrickApron ||
+      header.data_offset + BrickCount(header) * kStoredBrickVoxels >
+          mapping_size_) {
+    std::cerr << "Invalid brick store " << filename << std::endl;
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void BrickStore::Close() {
+  if (mapping_ != nullptr) munmap(mapping_, mapping_size_);
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+}
+
+const BrickStoreHeader& BrickStore::GetHeader() const {
+  return *static_cast<const BrickStoreHeader*>(mapping_);
+}
+
+int BrickStore::GetBrickCount() const { return BrickCount(GetHeader()); }
+
+const unsigned char* BrickStore::GetBrick(int index) const {
+  return GetBytes() + GetHeader().data_offset + index * kStoredBrickVoxels;
+}
+
+const unsigned char* BrickStore::GetBrickRange(int index) const {
+  return GetBytes() + GetHeader().range_offset + 2 * index;
+}
+
+const unsigned char* BrickStore::GetOverview() const {
+  return GetBytes() + GetHeader().overview_offset;
+}
+
+const unsigned char* BrickStore::GetBytes() const {
+  return static_cast<const unsigned char*>(mapping_);
+}
+
+}  // namespace data_representation
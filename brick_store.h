@@ -0,0 +1,143 @@
+#ifndef BRICK_STORE_H_
+#define BRICK_STORE_H_
+
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief kBrickSize Voxels per brick edge, without the apron.
+ */
+const int kBrickSize = 64;
+
+/**
+ * @brief kBrickApron Voxels shared with the neighbour bricks on every face,
+ * so that bricks can be filtered independently.
+ */
+const int kBrickApron = 1;
+
+/**
+ * @brief kStoredBrickSize Voxels per brick edge, with the apron.
+ */
+const int kStoredBrickSize = kBrickSize + 2 * kBrickApron;
+
+/**
+ * @brief BrickStoreHeader Header of a brick store. It is followed by the
+ * density range (min, max) of every brick, a downsampled overview of the
+ * volume and, at data_offset, the bricks in x, y, z order.
+ */
+struct BrickStoreHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t brick_size;
+  uint32_t apron;
+  int32_t width;
+  int32_t height;
+  int32_t depth;
+  int32_t bricks[3];
+  int32_t overview[3];
+  uint64_t source_key;
+  uint64_t range_offset;
+  uint64_t overview_offset;
+  uint64_t data_offset;
+  double histogram[256];
+};
+
+/**
+ * @brief BrickStore A chunked, memory mapped, on-disk volume. Bricks are read
+ * on demand, so that volumes larger than the host or GPU memory can be
+ * rendered.
+ */
+class BrickStore {
+ public:
+  /**
+   * @brief BrickStore Constructor of the class.
+   */
+  BrickStore();
+
+  /**
+   * @brief ~BrickStore Destructor of the class. Unmaps the file.
+   */
+  ~BrickStore();
+
+  BrickStore(const BrickStore&) = delete;
+  BrickStore& operator=(const BrickStore&) = delete;
+
+  /**
+   * @brief Build Decodes a stack of images one brick layer at a time and
+   * writes its brick store. Only a layer of slices is held in memory.
+   * @param paths The slices of the stack.
+   * @param width Slice width.
+   * @param height Slice height.
+   * @param source_key Key of the stack, see DicomSourceKey.
+   * @param filename Path to the brick store.
+   * @param built_slices Number of slices written so far.
+   * @param cancelled Stops the build when set.
+   * @return Whether the store was written.
+   */
+  static bool Build(const std::vector<boost::filesystem::path>& paths,
+                    int width, int height, uint64_t source_key,
+                    const std::string& filename,
+                    std::atomic<int>* built_slices,
+                    const std::atomic<bool>* cancelled);
+
+  /**
+   * @brief Filename Returns the path of the brick store of a stack.
+   */
+  static std::string Filename(uint64_t source_key);
+
+  /**
+   * @brief Open Maps a brick store and validates its header.
+   * @param filename Path to the brick store.
+   * @return Whether the file is a valid brick store.
+   */
+  bool Open(const std::string& filename);
+
+  /**
+   * @brief Close Unmaps the file, if any.
+   */
+  void Close();
+
+  /**
+   * @brief GetHeader Returns the header of the mapped store.
+   */
+  const BrickStoreHeader& GetHeader() const;
+
+  /**
+   * @brief GetBrickCount Returns the number of bricks.
+   */
+  int GetBrickCount() const;
+
+  /**
+   * @brief GetBrick Returns the kStoredBrickSize^3 voxels of a brick.
+   * @param index Brick index, x + bricks_x * (y + bricks_y * z).
+   */
+  const unsigned char* GetBrick(int index) const;
+
+  /**
+   * @brief GetBrickRange Returns the minimum and maximum density of a brick,
+   * apron included.
+   */
+  const unsigned char* GetBrickRange(int index) const;
+
+  /**
+   * @brief GetOverview Returns the voxels of the downsampled overview.
+   */
+  const unsigned char* GetOverview() const;
+
+ private:
+  const unsigned char* GetBytes() const;
+
+  void* mapping_;
+  size_t mapping_size_;
+};
+
+}  // namespace data_representation
+
+#endif  //  BRICK_STORE_H_
@@ -53,6 +53,11 @@ void Camera::SetViewport() const {
   glViewport(viewport_x_, viewport_y_, viewport_width_, viewport_height_);
 }
 
+void Camera::SetViewportSize(double w, double h) {
+  viewport_width_ = w;
+  viewport_height_ = h;
+}
+
 Eigen::Matrix4f Camera::SetIdentity() const {
   Eigen::Matrix4f identity;
   identity << 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1;
@@ -115,6 +120,13 @@ void Camera::Rotate(double modifier) {
   rotation_y_ += AngleIncrement * modifier;
 }
 
+void Camera::SetPose(double rotation_x, double rotation_y, double distance) {
+  rotation_x_ = std::min(std::max(rotation_x, kMinRotationX), MaxRotationX);
+  rotation_y_ = rotation_y;
+  distance_ =
+      std::min(std::max(distance, kMinCameraDistance), kMaxCameraDistance);
+}
+
 void Camera::UpdateModel(Eigen::Vector3f min, Eigen::Vector3f max) {
   Eigen::Vector3f center = (min + max) / 2.0;
   centering_x_ = -center[0];
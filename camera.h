@@ -146,6 +146,14 @@ class Camera {
    */
   void SetViewport() const;
 
+  /**
+   * @brief SetViewportSize Stores the viewport width and height without
+   * calling glViewport, to render without a GL context.
+   * @param w Viewport width.
+   * @param h Viewport height.
+   */
+  void SetViewportSize(double w, double h);
+
   /**
    * @brief SetIdentity Returns an identity matrix.
    * @return An identity matrix.
@@ -202,6 +210,15 @@ class Camera {
    */
   void Rotate(double modifier);
 
+  /**
+   * @brief SetPose Places the camera at the given rotations and zoom
+   * distance, e.g. to render a fixed sequence of views.
+   * @param rotation_x Rotation around the X axis, clamped as when rotating.
+   * @param rotation_y Rotation around the Y axis.
+   * @param distance Zoom distance, clamped as when zooming.
+   */
+  void SetPose(double rotation_x, double rotation_y, double distance);
+
   /**
    * @brief UpdateModel Updates the intrinsic parameters to compute a modeling
    * transform that centers the bounding box of the model and makes its longest
@@ -0,0 +1,271 @@
+#include <classified_volume.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "./volume_io.h"
+
+namespace data_visualization {
+
+namespace {
+
+/* Ambient term of the Phong shading, it must match raycast.frag */
+const float kAmbient = 0.3f;
+
+/* Normals shorter than this, once unpacked, are of flat regions */
+const float kMinNormalLength = 0.05f;
+
+/* First voxel of a brick, bricks are indexed x + bricks_x * (y + bricks_y *
+ * z) */
+Eigen::Vector3i BrickBegin(int brick, const int* bricks) {
+  return Eigen::Vector3i(brick % bricks[0], (brick / bricks[0]) % bricks[1],
+                         brick / (bricks[0] * bricks[1])) *
+         kClassifiedBrickSize;
+}
+
+}  // namespace
+
+ClassifiedVolume::ClassifiedVolume()
+    : size_(0, 0, 0),
+      bricks_{0, 0, 0},
+      lit_(false),
+      light_(0.0f, 0.0f, 0.0f),
+      light_color_(0.0f, 0.0f, 0.0f),
+      texture_id_(0) {}
+
+ClassifiedVolume::~ClassifiedVolume() { Release(); }
+
+int ClassifiedVolume::Update(GLuint volume_texture, GLuint gradient_texture,
+                             const Eigen::Vector3i& volume_size,
+                             const std::vector<float>& transfer_function,
+                             bool lit, const Eigen::Vector3f& light,
+                             const Eigen::Vector3f& light_color) {
+  bool all = false;
+  if (voxels_.empty() || volume_size != size_) {
+    ReadVolume(volume_texture, volume_size);
+    all = true;
+  }
+  if (lit && gradients_.empty()) {
+    ReadGradients(gradient_texture);
+    all = true;
+  }
+
+  /* The static lighting of every voxel changes with the light */
+  if (texture_id_ == 0 ||
+      transfer_function_.size() != transfer_function.size() || lit != lit_ ||
+      (lit && (light != light_ || light_color != light_color_)))
+    all = true;
+
+  /* Otherwise only the bricks holding the densities that changed are baked
+   * again, the entries are compared in place so that the unchanged frames do
+   * not allocate */
+  const int kSize = transfer_function.size() / 4;
+  int first = 0, last = kSize - 1;
+  if (!all) {
+    while (first < kSize &&
+           std::equal(&transfer_function[4 * first],
+                      &transfer_function[4 * first] + 4,
+                      &transfer_function_[4 * first]))
+      ++first;
+    if (first == kSize) return 0;
+    while (std::equal(&transfer_function[4 * last],
+                      &transfer_function[4 * last] + 4,
+                      &transfer_function_[4 * last]))
+      --last;
+  }
+
+  dirty_.clear();
+  const int kBricks = static_cast<int>(brick_min_.size());
+  for (int i = 0; i < kBricks; ++i) {
+    if (all || (brick_max_[i] >= first && brick_min_[i] <= last))
+      dirty_.push_back(i);
+  }
+
+  Bake(transfer_function, lit, light, light_color);
+  Upload();
+
+  transfer_function_ = transfer_function;
+  lit_ = lit;
+  light_ = light;
+  light_color_ = light_color;
+  return dirty_.size();
+}
+
+void ClassifiedVolume::Invalidate() { voxels_.clear(); }
+
+void ClassifiedVolume::Release() {
+  if (texture_id_ != 0) glDeleteTextures(1, &texture_id_);
+  texture_id_ = 0;
+
+  std::vector<unsigned char>().swap(voxels_);
+  std::vector<unsigned char>().swap(gradients_);
+  std::vector<unsigned char>().swap(texels_);
+  transfer_function_.clear();
+}
+
+GLuint ClassifiedVolume::GetTextureId() const { return texture_id_; }
+
+void ClassifiedVolume::ReadVolume(GLuint volume_texture,
+                                  const Eigen::Vector3i& volume_size) {
+  size_ = volume_size;
+  const size_t kVoxels = static_cast<size_t>(size_[0]) * size_[1] * size_[2];
+  voxels_.resize(kVoxels);
+  texels_.assign(4 * kVoxels, 0);
+  gradients_.clear();
+
+  glBindTexture(GL_TEXTURE_3D, volume_texture);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_UNSIGNED_BYTE, voxels_.data());
+
+  /* The texture is allocated again for the new size */
+  if (texture_id_ != 0) glDeleteTextures(1, &texture_id_);
+  texture_id_ = 0;
+
+  for (int i = 0; i < 3; ++i)
+    bricks_[i] = (size_[i] + kClassifiedBrickSize - 1) / kClassifiedBrickSize;
+  const int kBricks = bricks_[0] * bricks_[1] * bricks_[2];
+  brick_min_.assign(kBricks, 255);
+  brick_max_.assign(kBricks, 0);
+  dirty_.reserve(kBricks);
+
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < kBricks; ++i) {
+    const Eigen::Vector3i kBegin = BrickBegin(i, bricks_);
+    const Eigen::Vector3i kEnd =
+        (kBegin + Eigen::Vector3i::Constant(kClassifiedBrickSize))
+            .cwiseMin(size_);
+    unsigned char lo = 255, hi = 0;
+    for (int z = kBegin[2]; z < kEnd[2]; ++z) {
+      for (int y = kBegin[1]; y < kEnd[1]; ++y) {
+        const unsigned char* row =
+            &voxels_[(static_cast<size_t>(z) * size_[1] + y) * size_[0]];
+        for (int x = kBegin[0]; x < kEnd[0]; ++x) {
+          lo = std::min(lo, row[x]);
+          hi = std::max(hi, row[x]);
+        }
+      }
+    }
+    brick_min_[i] = lo;
+    brick_max_[i] = hi;
+  }
+}
+
+void ClassifiedVolume::ReadGradients(GLuint gradient_texture) {
+  gradients_.resize(4 * voxels_.size());
+  if (gradient_texture != 0) {
+    glBindTexture(GL_TEXTURE_3D, gradient_texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_3D, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                  gradients_.data());
+  } else {
+    data_representation::ComputeGradients(voxels_.data(), size_[0], size_[1],
+                                          size_[2], gradients_.data());
+  }
+}
+
+void ClassifiedVolume::Bake(const std::vector<float>& transfer_function,
+                            bool lit, const Eigen::Vector3f& light,
+                            const Eigen::Vector3f& light_color) {
+  const Eigen::Vector3f kVoxelSize = size_.cast<float>().cwiseInverse();
+  const int kCount = dirty_.size();
+
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < kCount; ++i) {
+    const int kBrick = dirty_[i];
+    const Eigen::Vector3i kBegin = BrickBegin(kBrick, bricks_);
+    const Eigen::Vector3i kEnd =
+        (kBegin + Eigen::Vector3i::Constant(kClassifiedBrickSize))
+            .cwiseMin(size_);
+
+    for (int z = kBegin[2]; z < kEnd[2]; ++z) {
+      for (int y = kBegin[1]; y < kEnd[1]; ++y) {
+        const size_t kRow = (static_cast<size_t>(z) * size_[1] + y) * size_[0];
+        for (int x = kBegin[0]; x < kEnd[0]; ++x) {
+          const float* kEntry = &transfer_function[4 * voxels_[kRow + x]];
+          unsigned char* texel = &texels_[4 * (kRow + x)];
+          const float kAlpha = std::min(kEntry[3], 1.0f);
+          if (kAlpha <= 0.0f) {
+            std::fill_n(texel, 4, 0);
+            continue;
+          }
+
+          Eigen::Vector3f color = Eigen::Vector3f::Map(kEntry);
+          if (lit) {
+            /* Ambient and diffuse, the specular term depends on the view */
+            const unsigned char* kGradient = &gradients_[4 * (kRow + x)];
+            const Eigen::Vector3f kNormal =
+                Eigen::Vector3f(kGradient[0], kGradient[1], kGradient[2]) /
+                    127.5f -
+                Eigen::Vector3f::Ones();
+            const float kLength = kNormal.norm();
+            float diffuse = 0.0f;
+            if (kLength >= kMinNormalLength) {
+              const Eigen::Vector3f kPosition =
+                  (Eigen::Vector3f(x, y, z) + Eigen::Vector3f::Constant(0.5f))
+                      .cwiseProduct(kVoxelSize);
+              diffuse = std::max(
+                  kNormal.dot((light - kPosition).normalized()) / kLength,
+                  0.0f);
+            }
+            color = (color.cwiseProduct(light_color) * (kAmbient + diffuse))
+                        .cwiseMin(1.0f);
+          }
+
+          /* Weighted by the opacity before the interpolation */
+          for (int c = 0; c < 3; ++c)
+            texel[c] = static_cast<unsigned char>(
+                255.0f * kAlpha * std::max(color[c], 0.0f) + 0.5f);
+          texel[3] = static_cast<unsigned char>(255.0f * kAlpha + 0.5f);
+        }
+      }
+    }
+  }
+}
+
+void ClassifiedVolume::Upload() {
+  if (texture_id_ == 0) {
+    glGenTextures(1, &texture_id_);
+    glBindTexture(GL_TEXTURE_3D, texture_id_);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+    if (GLEW_ARB_texture_storage)
+      glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA8, size_[0], size_[1],
+                     size_[2]);
+    else
+      glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, size_[0], size_[1], size_[2],
+                   0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  }
+  glBindTexture(GL_TEXTURE_3D, texture_id_);
+
+  /* Every brick baked, in one upload */
+  if (dirty_.size() == brick_min_.size()) {
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, size_[0], size_[1], size_[2],
+                    GL_RGBA, GL_UNSIGNED_BYTE, texels_.data());
+    return;
+  }
+
+  /* The bricks are read in place from the baked volume */
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, size_[0]);
+  glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, size_[1]);
+  for (const int kBrick : dirty_) {
+    const Eigen::Vector3i kBegin = BrickBegin(kBrick, bricks_);
+    const Eigen::Vector3i kExtent =
+        (kBegin + Eigen::Vector3i::Constant(kClassifiedBrickSize))
+            .cwiseMin(size_) -
+        kBegin;
+    const size_t kOffset =
+        (static_cast<size_t>(kBegin[2]) * size_[1] + kBegin[1]) * size_[0] +
+        kBegin[0];
+    glTexSubImage3D(GL_TEXTURE_3D, 0, kBegin[0], kBegin[1], kBegin[2],
+                    kExtent[0], kExtent[1], kExtent[2], GL_RGBA,
+                    GL_UNSIGNED_BYTE, &texels_[4 * kOffset]);
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,132 @@
+#ifndef CLASSIFIED_VOLUME_H_
+#define CLASSIFIED_VOLUME_H_
+
+#include <GL/glew.h>
+
+#include <eigen3/Eigen/Geometry>
+
+#include <vector>
+
+namespace data_visualization {
+
+/**
+ * @brief kClassifiedBrickSize Voxels per brick edge of a classified volume,
+ * the unit that is baked and uploaded again after a transfer function edit.
+ */
+const int kClassifiedBrickSize = 32;
+
+/**
+ * @brief ClassifiedVolume The color and opacity of every voxel under the
+ * transfer function, baked on the CPU into a GL_RGBA8 3D texture, optionally
+ * with the view independent part of the Phong shading (ambient and diffuse)
+ * of the point light. The colors are weighted by their opacity, so that they
+ * interpolate without bleeding from transparent voxels. The ray marcher then
+ * takes one fetch per sample instead of the density, the transfer function
+ * and the lighting. Only the bricks whose density range holds an entry of the
+ * transfer function that changed are baked and uploaded again, every brick
+ * when the light moves. It needs a copy of the voxels, and of the gradients
+ * when lit, on top of four bytes per voxel in the CPU and the GPU.
+ */
+class ClassifiedVolume {
+ public:
+  /**
+   * @brief ClassifiedVolume Constructor of the class.
+   */
+  ClassifiedVolume();
+
+  /**
+   * @brief ~ClassifiedVolume Destructor of the class. Calls Release.
+   */
+  ~ClassifiedVolume();
+
+  ClassifiedVolume(const ClassifiedVolume&) = delete;
+  ClassifiedVolume& operator=(const ClassifiedVolume&) = delete;
+
+  /**
+   * @brief Update Bakes and uploads the bricks that changed since the last
+   * update. The volume is read back from its texture on the first update
+   * after Invalidate. Requires the GL context to be current.
+   * @param volume_texture The GL_R8 3D texture of the volume.
+   * @param gradient_texture The packed gradients of the volume (see
+   * ComputeGradients), or 0 to compute them. Only read when lit.
+   * @param volume_size Size of the volume, in voxels.
+   * @param transfer_function The transfer function values, rgbargba...
+   * @param lit Whether the ambient and diffuse shading are baked.
+   * @param light Light position, in texture coordinates of the volume.
+   * @param light_color Light color.
+   * @return The number of bricks baked.
+   */
+  int Update(GLuint volume_texture, GLuint gradient_texture,
+             const Eigen::Vector3i& volume_size,
+             const std::vector<float>& transfer_function, bool lit,
+             const Eigen::Vector3f& light, const Eigen::Vector3f& light_color);
+
+  /**
+   * @brief Invalidate Reads the volume back and bakes every brick on the
+   * next Update, e.g. when the content of the volume texture changed.
+   */
+  void Invalidate();
+
+  /**
+   * @brief Release Deletes the texture and the copies of the volume.
+   */
+  void Release();
+
+  /**
+   * @brief GetTextureId Returns the id of the 3D texture, the colors
+   * weighted by the opacity in rgb and the opacity in a.
+   */
+  GLuint GetTextureId() const;
+
+ private:
+  /**
+   * @brief ReadVolume Reads the voxels back from the volume texture and
+   * computes the density range of every brick.
+   */
+  void ReadVolume(GLuint volume_texture, const Eigen::Vector3i& volume_size);
+
+  /**
+   * @brief ReadGradients Reads the gradients back from their texture, or
+   * computes them from the voxels.
+   */
+  void ReadGradients(GLuint gradient_texture);
+
+  /**
+   * @brief Bake Classifies the voxels of the dirty bricks, in parallel.
+   */
+  void Bake(const std::vector<float>& transfer_function, bool lit,
+            const Eigen::Vector3f& light, const Eigen::Vector3f& light_color);
+
+  /**
+   * @brief Upload Uploads the dirty bricks, allocating the texture first.
+   */
+  void Upload();
+
+  Eigen::Vector3i size_;
+  int bricks_[3];
+
+  std::vector<unsigned char> voxels_;
+  std::vector<unsigned char> gradients_;
+
+  /**
+   * @brief texels_ The baked volume, rgba per voxel.
+   */
+  std::vector<unsigned char> texels_;
+
+  /* Density range of every brick, and the bricks to bake */
+  std::vector<unsigned char> brick_min_;
+  std::vector<unsigned char> brick_max_;
+  std::vector<int> dirty_;
+
+  /* Inputs of the last bake */
+  std::vector<float> transfer_function_;
+  bool lit_;
+  Eigen::Vector3f light_;
+  Eigen::Vector3f light_color_;
+
+  GLuint texture_id_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  CLASSIFIED_VOLUME_H_
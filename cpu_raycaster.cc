@@ -0,0 +1,717 @@
+#include <cpu_raycaster.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "./light_volume.h"
+#include "./transfer_function_2d.h"
+#include "./volume_io.h"
+
+namespace data_visualization {
+
+namespace {
+
+/* Rays parallel to a face are nudged to avoid dividing by zero */
+const float kMinRayComponent = 1e-6f;
+
+/* Samples at or under this opacity are skipped, as in the shader */
+const float kSkipAlpha = 0.001f;
+
+/* Rays stop once they are this opaque */
+const float kOpaqueAlpha = 0.95f;
+
+/* Normals shorter than this (flat regions) are zero */
+const float kMinNormalLength = 0.05f;
+
+/**
+ * @brief Tap The two texels and the weight of the second one of a linear
+ * filtered lookup along one axis.
+ */
+struct Tap {
+  int first, second;
+  float weight;
+};
+
+/* Linear filtering of a texture coordinate over n texels, clamped to edge */
+inline Tap LinearTap(float coordinate, int n) {
+  const float kTexel = coordinate * n - 0.5f;
+  const float kFloor = std::floor(kTexel);
+  const int kIndex = static_cast<int>(kFloor);
+  Tap tap;
+  tap.first = std::min(std::max(kIndex, 0), n - 1);
+  tap.second = std::min(std::max(kIndex + 1, 0), n - 1);
+  tap.weight = kTexel - kFloor;
+  return tap;
+}
+
+inline float Lerp(float a, float b, float weight) {
+  return a + (b - a) * weight;
+}
+
+/* Trilinear lookup of the first kChannels channels of a texture of kStride
+ * channels, clamped to edge */
+template <int kStride, int kChannels, typename T>
+inline void SampleTrilinear(const T* data, const int* dims, float x, float y,
+                            float z, float* out) {
+  const Tap kX = LinearTap(x, dims[0]);
+  const Tap kY = LinearTap(y, dims[1]);
+  const Tap kZ = LinearTap(z, dims[2]);
+  const size_t kRow = dims[0];
+  const size_t kSlice = kRow * dims[1];
+  const size_t kCorners[4] = {
+      kZ.first * kSlice + kY.first * kRow, kZ.first * kSlice + kY.second * kRow,
+      kZ.second * kSlice + kY.first * kRow,
+      kZ.second * kSlice + kY.second * kRow};
+
+  for (int c = 0; c < kChannels; ++c) {
+    float rows[4];
+    for (int i = 0; i < 4; ++i)
+      rows[i] = Lerp(data[(kCorners[i] + kX.first) * kStride + c],
+                     data[(kCorners[i] + kX.second) * kStride + c], kX.weight);
+    out[c] = Lerp(Lerp(rows[0], rows[1], kY.weight),
+                  Lerp(rows[2], rows[3], kY.weight), kZ.weight);
+  }
+}
+
+/* Linear lookup of a transfer function of size rgba entries */
+inline void SampleTransferFunction(const float* transfer_function, int size,
+                                   float density, float* rgba) {
+  const Tap kTap = LinearTap(density, size);
+  for (int c = 0; c < 4; ++c)
+    rgba[c] = Lerp(transfer_function[4 * kTap.first + c],
+                   transfer_function[4 * kTap.second + c], kTap.weight);
+}
+
+/* Bilinear lookup of a 2D transfer function of size x size rgba entries, at
+ * the texel centers of the densities and magnitudes as the shader does */
+inline void SampleTransferFunction2D(const float* table, int size,
+                                     float density, float magnitude,
+                                     float* rgba) {
+  const Tap kS = LinearTap((density * 255.0f + 0.5f) / 256.0f, size);
+  const Tap kT = LinearTap((magnitude * 255.0f + 0.5f) / 256.0f, size);
+  const float* kFirst = table + 4 * kT.first * size;
+  const float* kSecond = table + 4 * kT.second * size;
+  for (int c = 0; c < 4; ++c)
+    rgba[c] = Lerp(Lerp(kFirst[4 * kS.first + c], kFirst[4 * kS.second + c],
+                        kS.weight),
+                   Lerp(kSecond[4 * kS.first + c], kSecond[4 * kS.second + c],
+                        kS.weight),
+                   kT.weight);
+}
+
+/* Bilinear lookup of a slice of the light sweep, the light entering through
+ * the sides is not attenuated (border 1) */
+inline float SampleSlice(const float* slice, int width, int height, float x,
+                         float y) {
+  const float kX = x * width - 0.5f;
+  const float kY = y * height - 0.5f;
+  const int kX0 = static_cast<int>(std::floor(kX));
+  const int kY0 = static_cast<int>(std::floor(kY));
+  const float kWeightX = kX - kX0;
+  const float kWeightY = kY - kY0;
+
+  float texels[4];
+  for (int i = 0; i < 4; ++i) {
+    const int kTexelX = kX0 + (i & 1);
+    const int kTexelY = kY0 + (i >> 1);
+    texels[i] = kTexelX < 0 || kTexelX >= width || kTexelY < 0 ||
+                        kTexelY >= height
+                    ? 1.0f
+                    : slice[kTexelY * width + kTexelX];
+  }
+  return Lerp(Lerp(texels[0], texels[1], kWeightX),
+              Lerp(texels[2], texels[3], kWeightX), kWeightY);
+}
+
+/* Ambient, diffuse and specular terms of ComputePhongShading */
+Eigen::Vector3f PhongShading(const Eigen::Vector3f& light_position,
+                             const Eigen::Vector3f& light_color,
+                             const Eigen::Vector3f& position,
+                             const Eigen::Vector3f& normal,
+                             const Eigen::Vector3f& eye,
+                             const Eigen::Vector3f& color) {
+  const Eigen::Vector3f kAmbient = 0.3f * light_color.cwiseProduct(color);
+
+  const Eigen::Vector3f kLight = (light_position - position).normalized();
+  const Eigen::Vector3f kDiffuse =
+      std::max(normal.dot(kLight), 0.0f) * light_color.cwiseProduct(color);
+
+  /* As in the shader, the eye is in model coordinates and the position in
+   * texture coordinates */
+  const Eigen::Vector3f kView = (eye - position).normalized();
+  const Eigen::Vector3f kReflect = 2.0f * normal.dot(kLight) * normal - kLight;
+  const Eigen::Vector3f kSpecular =
+      std::pow(std::max(kView.dot(kReflect), 0.0f), 16.0f) * 0.1f *
+      light_color;
+
+  return (kAmbient + kDiffuse + kSpecular).cwiseMax(0.0f).cwiseMin(1.0f);
+}
+
+}  // namespace
+
+struct CpuRaycaster::Frame {
+  RaycastSettings settings;
+
+  /* Inverse of projection * view * model, and the eye in model coordinates */
+  Eigen::Matrix4f inverse;
+  Eigen::Vector3f eye;
+
+  int width, height;
+  float step_length;
+  int max_steps;
+
+  /* Density range of the volume, normalized */
+  float density_min, density_max;
+};
+
+CpuRaycaster::CpuRaycaster()
+    : data_(nullptr),
+      dims_{0, 0, 0},
+      light_size_{0, 0, 0},
+      light_axes_{0, 1, 2},
+      light_valid_(false),
+      light_position_(0, 0, 0) {}
+
+void CpuRaycaster::SetVolume(const unsigned char* data, int width, int height,
+                             int depth) {
+  data_ = data;
+  dims_[0] = width;
+  dims_[1] = height;
+  dims_[2] = depth;
+
+  gradients_.resize(4 * static_cast<size_t>(width) * height * depth);
+  data_representation::ComputeGradients(data, width, height, depth,
+                                        gradients_.data());
+
+  occupancy_.Init(width, height, depth,
+                  data_representation::kOccupancyCellSize);
+  occupancy_.Accumulate(data, 0, depth);
+  Classify();
+
+  light_valid_ = false;
+}
+
+void CpuRaycaster::SetTransferFunction(
+    const std::vector<float>& transfer_function) {
+  transfer_function_ = transfer_function;
+  Classify();
+}
+
+void CpuRaycaster::SetTransferFunction2D(const std::vector<float>& table) {
+  transfer_function_2d_ = table;
+  if (!table.empty()) {
+    envelope_.resize(4 * kTransferFunction2DSize);
+    TransferFunction2D::ComputeEnvelope(table, 0, kTransferFunction2DSize - 1,
+                                        &envelope_);
+  }
+  Classify();
+}
+
+void CpuRaycaster::Classify() {
+  if (data_ == nullptr) return;
+  if (!transfer_function_2d_.empty())
+    occupancy_.Classify(envelope_);
+  else if (!transfer_function_.empty())
+    occupancy_.Classify(transfer_function_);
+}
+
+void CpuRaycaster::Render(const Eigen::Matrix4f& projection,
+                          const Eigen::Matrix4f& view,
+                          const Eigen::Matrix4f& model,
+                          const RaycastSettings& settings, int width,
+                          int height, std::vector<unsigned char>* image) {
+  image->assign(4 * static_cast<size_t>(width) * height, 255);
+  const bool kCompositing = settings.mode == kComposite;
+  const bool kTransferFunction2D = !transfer_function_2d_.empty();
+  if (data_ == nullptr ||
+      (kCompositing && transfer_function_.empty() && !kTransferFunction2D))
+    return;
+
+  Frame frame;
+  frame.settings = settings;
+  frame.settings.shadows = settings.shadows && !kTransferFunction2D;
+  frame.settings.preintegrated = settings.preintegrated && !kTransferFunction2D;
+
+  if (kCompositing && frame.settings.shadows) {
+    const Eigen::Vector3f kLight =
+        settings.light_position + Eigen::Vector3f::Constant(0.5f);
+    if (!light_valid_ || kLight != light_position_ ||
+        transfer_function_ != light_transfer_function_)
+      SweepLight(kLight);
+  }
+  if (kCompositing && frame.settings.preintegrated)
+    preintegration_table_.Compute(transfer_function_, settings.step_scale);
+
+  const int kMaxSize = *std::max_element(dims_, dims_ + 3);
+  frame.inverse = (projection * view * model).inverse();
+  frame.eye = (view * model).inverse().block<3, 1>(0, 3);
+  frame.width = width;
+  frame.height = height;
+  frame.step_length = settings.step_scale / kMaxSize;
+  /* Enough steps for the diagonal of the volume at the scaled step, the
+   * same cap as raycast.frag */
+  frame.max_steps =
+      static_cast<int>(std::ceil(std::sqrt(3.0f) * kMaxSize /
+                                 settings.step_scale)) +
+      1;
+  unsigned char density_min, density_max;
+  occupancy_.GetDensityRange(&density_min, &density_max);
+  frame.density_min = density_min / 255.0f;
+  frame.density_max = density_max / 255.0f;
+
+  /* Tiles are tasks, so that the threads done with the cheap tiles take
+   * over the ones left instead of waiting for the dense ones */
+  const int kTilesX = (width + kTileSize - 1) / kTileSize;
+  const int kTiles = kTilesX * ((height + kTileSize - 1) / kTileSize);
+#pragma omp parallel
+#pragma omp single
+#pragma omp taskloop grainsize(1)
+  for (int tile = 0; tile < kTiles; ++tile) {
+    const int kBeginX = (tile % kTilesX) * kTileSize;
+    const int kBeginY = (tile / kTilesX) * kTileSize;
+    const int kEndX = std::min(width, kBeginX + kTileSize);
+    const int kEndY = std::min(height, kBeginY + kTileSize);
+    for (int y = kBeginY; y < kEndY; ++y)
+      for (int x = kBeginX; x < kEndX; x += kPacketSize)
+        TracePacket(frame, x, y, std::min(kPacketSize, kEndX - x),
+                    &(*image)[4 * (static_cast<size_t>(y) * width + x)]);
+  }
+}
+
+struct CpuRaycaster::Packet {
+  /* One lane per ray, in texture coordinates, unused lanes stay inactive */
+  alignas(32) float start[3][kPacketSize];
+  alignas(32) float ray[3][kPacketSize];
+  alignas(32) float inv_ray[3][kPacketSize];
+  alignas(32) float position[3][kPacketSize];
+  alignas(32) float color[4][kPacketSize];
+  alignas(32) float frag_color[4][kPacketSize];
+  alignas(32) float t[kPacketSize];
+  alignas(32) float t_exit[kPacketSize];
+  alignas(32) float density[kPacketSize];
+  /* Gradient of the sample, when the 2D transfer function looks it up */
+  alignas(32) float gradient[4][kPacketSize];
+  /* Density of the previous sample, negative if the previous step was
+   * skipped */
+  alignas(32) float front_density[kPacketSize];
+  bool active[kPacketSize];
+  bool sampled[kPacketSize];
+};
+
+void CpuRaycaster::TracePacket(const Frame& frame, int x, int y, int count,
+                               unsigned char* pixels) const {
+  Packet packet;
+  StartPacket(frame, x, y, count, &packet);
+  if (frame.settings.mode == kComposite)
+    Composite(frame, &packet);
+  else
+    Project(frame, &packet);
+
+  /* Blended over the white background as glBlendFunc(GL_SRC_ALPHA,
+   * GL_ONE_MINUS_SRC_ALPHA) does */
+  for (int l = 0; l < count; ++l) {
+    const float kAlpha =
+        std::min(std::max(packet.frag_color[3][l], 0.0f), 1.0f);
+    for (int c = 0; c < 3; ++c) {
+      const float kValue = std::min(
+          std::max(packet.frag_color[c][l] * kAlpha + 1.0f - kAlpha, 0.0f),
+          1.0f);
+      pixels[4 * l + c] = static_cast<unsigned char>(kValue * 255.0f + 0.5f);
+    }
+    pixels[4 * l + 3] = 255;
+  }
+}
+
+void CpuRaycaster::StartPacket(const Frame& frame, int x, int y, int count,
+                               Packet* packet) const {
+  const Eigen::Vector3f kOrigin =
+      frame.eye + Eigen::Vector3f::Constant(0.5f);
+  for (int l = 0; l < kPacketSize; ++l) {
+    for (int c = 0; c < 3; ++c) {
+      packet->start[c][l] = 0.0f;
+      packet->ray[c][l] = packet->inv_ray[c][l] = 1.0f;
+    }
+    for (int c = 0; c < 4; ++c) packet->frag_color[c][l] = 0.0f;
+    packet->t[l] = packet->t_exit[l] = 0.0f;
+    packet->front_density[l] = -1.0f;
+    packet->active[l] = false;
+    if (l >= count) continue;
+
+    /* Ray through the pixel center */
+    const float kNdcX = 2.0f * (x + l + 0.5f) / frame.width - 1.0f;
+    const float kNdcY = 1.0f - 2.0f * (y + 0.5f) / frame.height;
+    const Eigen::Vector4f kNear =
+        frame.inverse * Eigen::Vector4f(kNdcX, kNdcY, -1.0f, 1.0f);
+    const Eigen::Vector4f kFar =
+        frame.inverse * Eigen::Vector4f(kNdcX, kNdcY, 1.0f, 1.0f);
+    const Eigen::Vector3f kRay = (kFar.head<3>() / kFar.w() -
+                                  kNear.head<3>() / kNear.w()).normalized();
+
+    float t_near = -std::numeric_limits<float>::infinity();
+    float t_far = std::numeric_limits<float>::infinity();
+    for (int c = 0; c < 3; ++c) {
+      packet->ray[c][l] = kRay[c];
+      packet->inv_ray[c][l] =
+          1.0f / (std::abs(kRay[c]) < kMinRayComponent ? kMinRayComponent
+                                                       : kRay[c]);
+      const float kT0 = -kOrigin[c] * packet->inv_ray[c][l];
+      const float kT1 = (1.0f - kOrigin[c]) * packet->inv_ray[c][l];
+      t_near = std::max(t_near, std::min(kT0, kT1));
+      t_far = std::min(t_far, std::max(kT0, kT1));
+    }
+
+    /* Only the front faces of the cube are rasterized, so rays starting
+     * inside it are not traced */
+    if (t_near > t_far || t_near < 0.0f) continue;
+
+    /* The shader starts at the entry point, and marches to the exit */
+    packet->t_exit[l] = std::numeric_limits<float>::infinity();
+    for (int c = 0; c < 3; ++c) {
+      packet->start[c][l] = std::min(
+          std::max(kOrigin[c] + t_near * kRay[c], 0.0f), 1.0f);
+      packet->t_exit[l] = std::min(
+          packet->t_exit[l],
+          std::max(-packet->start[c][l] * packet->inv_ray[c][l],
+                   (1.0f - packet->start[c][l]) * packet->inv_ray[c][l]));
+    }
+    packet->active[l] = true;
+  }
+}
+
+int CpuRaycaster::CellOf(const Packet& packet, int lane) const {
+  const int* kCells = occupancy_.GetCells();
+  int cell[3];
+  for (int c = 0; c < 3; ++c) {
+    const float kCellSize =
+        static_cast<float>(occupancy_.GetCellSize()) / dims_[c];
+    cell[c] = std::min(
+        std::max(static_cast<int>(packet.position[c][lane] / kCellSize), 0),
+        kCells[c] - 1);
+  }
+  return cell[0] + kCells[0] * (cell[1] + kCells[1] * cell[2]);
+}
+
+float CpuRaycaster::StepPastCell(const Frame& frame, const Packet& packet,
+                                 int lane, int cell) const {
+  const int* kCells = occupancy_.GetCells();
+  const int kCell[3] = {cell % kCells[0], cell / kCells[0] % kCells[1],
+                        cell / (kCells[0] * kCells[1])};
+  float t_cell = std::numeric_limits<float>::infinity();
+  for (int c = 0; c < 3; ++c) {
+    const float kCellSize =
+        static_cast<float>(occupancy_.GetCellSize()) / dims_[c];
+    t_cell = std::min(
+        t_cell, std::max((kCell[c] * kCellSize - packet.start[c][lane]) *
+                             packet.inv_ray[c][lane],
+                         ((kCell[c] + 1) * kCellSize - packet.start[c][lane]) *
+                             packet.inv_ray[c][lane]));
+  }
+  return frame.step_length * (std::floor(t_cell / frame.step_length) + 1.0f);
+}
+
+void CpuRaycaster::Composite(const Frame& frame, Packet* packet) const {
+  Packet& p = *packet;
+  const RaycastSettings& kSettings = frame.settings;
+  const float kStep = frame.step_length;
+  const int kTransferFunctionSize = transfer_function_.size() / 4;
+  const float* kTable = preintegration_table_.GetTable().data();
+  const bool kTransferFunction2D = !transfer_function_2d_.empty();
+  const Eigen::Vector3f kLight =
+      kSettings.light_position + Eigen::Vector3f::Constant(0.5f);
+
+  for (int i = 0; i < frame.max_steps; ++i) {
+    bool any_active = false;
+    for (int l = 0; l < kPacketSize; ++l) {
+      p.active[l] = p.active[l] && p.t[l] < p.t_exit[l];
+      any_active = any_active || p.active[l];
+    }
+    if (!any_active) break;
+
+#pragma omp simd
+    for (int l = 0; l < kPacketSize; ++l)
+      for (int c = 0; c < 3; ++c)
+        p.position[c][l] = p.start[c][l] + p.t[l] * p.ray[c][l];
+
+    /* Jump to the first step past an empty cell */
+    for (int l = 0; l < kPacketSize; ++l) {
+      p.sampled[l] = p.active[l];
+      if (!p.active[l]) continue;
+
+      const int kCell = CellOf(p, l);
+      if (occupancy_.IsOccupied(kCell)) continue;
+      p.t[l] = StepPastCell(frame, p, l, kCell);
+      p.front_density[l] = -1.0f;
+      p.sampled[l] = false;
+    }
+
+    /* Every lane samples, the lookups are clamped inside the textures */
+#pragma omp simd
+    for (int l = 0; l < kPacketSize; ++l) {
+      SampleTrilinear<1, 1>(data_, dims_, p.position[0][l], p.position[1][l],
+                            p.position[2][l], &p.density[l]);
+      p.density[l] /= 255.0f;
+    }
+
+    /* The gradients looked up by the 2D transfer function also shade */
+    if (kTransferFunction2D) {
+#pragma omp simd
+      for (int l = 0; l < kPacketSize; ++l) {
+        float gradient[4];
+        SampleTrilinear<4, 4>(gradients_.data(), dims_, p.position[0][l],
+                              p.position[1][l], p.position[2][l], gradient);
+        for (int c = 0; c < 4; ++c) p.gradient[c][l] = gradient[c];
+      }
+    }
+
+    /* Color and opacity of the segment that ends at this sample */
+#pragma omp simd
+    for (int l = 0; l < kPacketSize; ++l) {
+      float rgba[4];
+      if (kTransferFunction2D) {
+        SampleTransferFunction2D(transfer_function_2d_.data(),
+                                 kTransferFunction2DSize, p.density[l],
+                                 p.gradient[3][l] / 255.0f, rgba);
+        rgba[3] = 1.0f - std::pow(1.0f - rgba[3], kSettings.step_scale);
+      } else if (kSettings.preintegrated) {
+        const float kFront =
+            p.front_density[l] < 0.0f ? p.density[l] : p.front_density[l];
+        const Tap kBack = LinearTap((p.density[l] * 255.0f + 0.5f) / 256.0f,
+                                    kTransferFunctionSize);
+        const Tap kRow = LinearTap((kFront * 255.0f + 0.5f) / 256.0f,
+                                   kTransferFunctionSize);
+        for (int c = 0; c < 4; ++c) {
+          const float* kFirst = kTable + 4 * kRow.first * kTransferFunctionSize;
+          const float* kSecond =
+              kTable + 4 * kRow.second * kTransferFunctionSize;
+          rgba[c] = Lerp(Lerp(kFirst[4 * kBack.first + c],
+                              kFirst[4 * kBack.second + c], kBack.weight),
+                         Lerp(kSecond[4 * kBack.first + c],
+                              kSecond[4 * kBack.second + c], kBack.weight),
+                         kRow.weight);
+        }
+      } else {
+        SampleTransferFunction(transfer_function_.data(),
+                               kTransferFunctionSize, p.density[l], rgba);
+        rgba[3] = 1.0f - std::pow(1.0f - rgba[3], kSettings.step_scale);
+      }
+      for (int c = 0; c < 4; ++c) p.color[c][l] = rgba[c];
+    }
+
+    /* Shading and compositing diverge, they run lane by lane */
+    for (int l = 0; l < kPacketSize; ++l) {
+      if (!p.sampled[l]) continue;
+      p.front_density[l] = p.density[l];
+
+      /* If the texel is highly transparent, then skip it */
+      if (p.color[3][l] <= kSkipAlpha) {
+        p.t[l] += kStep;
+        continue;
+      }
+
+      const float kPosition[3] = {p.position[0][l], p.position[1][l],
+                                  p.position[2][l]};
+      const float kShadow =
+          kSettings.shadows ? 1.0f - SampleLight(kPosition) : 0.0f;
+
+      Eigen::Vector3f rgb(p.color[0][l], p.color[1][l], p.color[2][l]);
+      if (kSettings.phong) {
+        Eigen::Vector3f normal;
+        if (kTransferFunction2D)
+          normal = Eigen::Vector3f(p.gradient[0][l], p.gradient[1][l],
+                                   p.gradient[2][l]);
+        else
+          SampleTrilinear<4, 3>(gradients_.data(), dims_, kPosition[0],
+                                kPosition[1], kPosition[2], normal.data());
+        normal = normal / 255.0f * 2.0f - Eigen::Vector3f::Ones();
+        const float kLength = normal.norm();
+        normal = kLength < kMinNormalLength ? Eigen::Vector3f::Zero()
+                                            : Eigen::Vector3f(normal / kLength);
+        rgb = PhongShading(kLight, kSettings.light_color,
+                           Eigen::Vector3f(kPosition[0], kPosition[1],
+                                           kPosition[2]),
+                           normal, frame.eye, rgb);
+      }
+
+      /* Compose color and alpha, front to back */
+      const float kWeight = (1.0f - p.frag_color[3][l]) * p.color[3][l];
+      for (int c = 0; c < 3; ++c)
+        p.frag_color[c][l] += (1.0f - kShadow) * kWeight * rgb[c];
+      p.frag_color[3][l] += kWeight;
+
+      p.t[l] += kStep;
+      if (p.frag_color[3][l] >= kOpaqueAlpha) p.active[l] = false;
+    }
+  }
+}
+
+void CpuRaycaster::Project(const Frame& frame, Packet* packet) const {
+  Packet& p = *packet;
+  const RenderMode kMode = frame.settings.mode;
+  const float kStep = frame.step_length;
+
+  /* The maximum, minimum or sum so far, and the number of samples */
+  float value[kPacketSize], count[kPacketSize];
+  for (int l = 0; l < kPacketSize; ++l) {
+    value[l] = kMode == kMinimumIntensity ? 1.0f : 0.0f;
+    count[l] = 0.0f;
+  }
+
+  for (int i = 0; i < frame.max_steps; ++i) {
+    bool any_active = false;
+    for (int l = 0; l < kPacketSize; ++l) {
+      p.active[l] = p.active[l] && p.t[l] < p.t_exit[l];
+      any_active = any_active || p.active[l];
+    }
+    if (!any_active) break;
+
+#pragma omp simd
+    for (int l = 0; l < kPacketSize; ++l)
+      for (int c = 0; c < 3; ++c)
+        p.position[c][l] = p.start[c][l] + p.t[l] * p.ray[c][l];
+
+    /* Skip the cells that cannot change the result */
+    for (int l = 0; l < kPacketSize; ++l) {
+      p.sampled[l] = p.active[l];
+      if (!p.active[l]) continue;
+
+      const int kCell = CellOf(p, l);
+      unsigned char min, max;
+      occupancy_.GetCellRange(kCell, &min, &max);
+      const bool kSkip = kMode == kMaximumIntensity
+                             ? max / 255.0f <= value[l]
+                             : kMode == kMinimumIntensity
+                                   ? min / 255.0f >= value[l]
+                                   : max == 0;
+      if (!kSkip) continue;
+
+      const float kNext = StepPastCell(frame, p, l, kCell);
+      if (kMode == kAverageIntensity) {
+        const float kLast = std::ceil(p.t_exit[l] / kStep) * kStep;
+        count[l] += std::round((std::min(kNext, kLast) - p.t[l]) / kStep);
+      }
+      p.t[l] = kNext;
+      p.sampled[l] = false;
+    }
+
+#pragma omp simd
+    for (int l = 0; l < kPacketSize; ++l) {
+      SampleTrilinear<1, 1>(data_, dims_, p.position[0][l], p.position[1][l],
+                            p.position[2][l], &p.density[l]);
+      p.density[l] /= 255.0f;
+    }
+
+    /* Rays stop once they reach the extreme of the volume */
+    for (int l = 0; l < kPacketSize; ++l) {
+      if (!p.sampled[l]) continue;
+      if (kMode == kMaximumIntensity) {
+        value[l] = std::max(value[l], p.density[l]);
+        if (value[l] >= frame.density_max) p.active[l] = false;
+      } else if (kMode == kMinimumIntensity) {
+        value[l] = std::min(value[l], p.density[l]);
+        if (value[l] <= frame.density_min) p.active[l] = false;
+      } else {
+        value[l] += p.density[l];
+        count[l] += 1.0f;
+      }
+      p.t[l] += kStep;
+    }
+  }
+
+  for (int l = 0; l < kPacketSize; ++l) {
+    if (p.t_exit[l] <= 0.0f) continue;
+    const float kValue = kMode != kAverageIntensity
+                             ? value[l]
+                             : count[l] > 0.0f ? value[l] / count[l] : 0.0f;
+    for (int c = 0; c < 3; ++c) p.frag_color[c][l] = kValue;
+    p.frag_color[3][l] = 1.0f;
+  }
+}
+
+void CpuRaycaster::SweepLight(const Eigen::Vector3f& light) {
+  /* Same slicing as LightVolume::Update */
+  const Eigen::Vector3f kDirection = Eigen::Vector3f::Constant(0.5f) - light;
+  int axis;
+  kDirection.cwiseAbs().maxCoeff(&axis);
+  const bool kForward = kDirection[axis] >= 0.0f;
+  light_axes_[0] = (axis + 1) % 3;
+  light_axes_[1] = (axis + 2) % 3;
+  light_axes_[2] = axis;
+
+  const int kMaxSize = *std::max_element(dims_, dims_ + 3);
+  const int kFactor =
+      std::max(1, (kMaxSize + kLightVolumeSize - 1) / kLightVolumeSize);
+  Eigen::Vector3f light_position;
+  for (int i = 0; i < 3; ++i) {
+    light_size_[i] = (dims_[light_axes_[i]] + kFactor - 1) / kFactor;
+    light_position[i] = light[light_axes_[i]];
+  }
+
+  const int kWidth = light_size_[0], kHeight = light_size_[1];
+  const int kDepth = light_size_[2];
+  const size_t kSliceSize = static_cast<size_t>(kWidth) * kHeight;
+  const float kLayerStep = (kForward ? 1.0f : -1.0f) / kDepth;
+  const float kSamplesPerUnit = kMaxSize / kShadowSampleSpacing;
+  const int kTransferFunctionSize = transfer_function_.size() / 4;
+  transmittance_.resize(kSliceSize * kDepth);
+
+  /* The light reaches the first slice unattenuated */
+  std::vector<float> previous(kSliceSize, 1.0f);
+  for (int i = 0; i < kDepth; ++i) {
+    const int kLayer = kForward ? i : kDepth - 1 - i;
+    float* slice = &transmittance_[kLayer * kSliceSize];
+
+#pragma omp parallel for
+    for (int py = 0; py < kHeight; ++py) {
+      for (int px = 0; px < kWidth; ++px) {
+        const Eigen::Vector3f kPosition((px + 0.5f) / kWidth,
+                                        (py + 0.5f) / kHeight,
+                                        (kLayer + 0.5f) / kDepth);
+        const Eigen::Vector3f kToPosition = kPosition - light_position;
+
+        /* Slices that are not past the light receive all of it */
+        const float kSlicesFromLight = kToPosition.z() / kLayerStep;
+        if (kSlicesFromLight < 1.0f) {
+          slice[py * kWidth + px] = 1.0f;
+          continue;
+        }
+
+        /* Follow the light ray back to the previous slice */
+        const Eigen::Vector3f kPrevious =
+            kPosition - kToPosition / kSlicesFromLight;
+        const float kPreviousTransmittance = SampleSlice(
+            previous.data(), kWidth, kHeight, kPrevious.x(), kPrevious.y());
+
+        /* Correct the opacity for the length of the ray between slices */
+        float volume_position[3], density, rgba[4];
+        for (int c = 0; c < 3; ++c)
+          volume_position[light_axes_[c]] = kPosition[c];
+        SampleTrilinear<1, 1>(data_, dims_, volume_position[0],
+                              volume_position[1], volume_position[2],
+                              &density);
+        SampleTransferFunction(transfer_function_.data(),
+                               kTransferFunctionSize, density / 255.0f, rgba);
+        const float kPathLength = kToPosition.norm() / kSlicesFromLight;
+        const float kAlpha =
+            1.0f - std::pow(1.0f - rgba[3], kPathLength * kSamplesPerUnit);
+
+        slice[py * kWidth + px] = kPreviousTransmittance * (1.0f - kAlpha);
+      }
+    }
+    std::copy(slice, slice + kSliceSize, previous.begin());
+  }
+
+  light_valid_ = true;
+  light_position_ = light;
+  light_transfer_function_ = transfer_function_;
+}
+
+float CpuRaycaster::SampleLight(const float* position) const {
+  float transmittance;
+  SampleTrilinear<1, 1>(transmittance_.data(), light_size_,
+                        position[light_axes_[0]], position[light_axes_[1]],
+                        position[light_axes_[2]], &transmittance);
+  return transmittance;
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,207 @@
+#ifndef CPU_RAYCASTER_H_
+#define CPU_RAYCASTER_H_
+
+#include <eigen3/Eigen/Geometry>
+
+#include <vector>
+
+#include "./occupancy_grid.h"
+#include "./preintegration_table.h"
+
+namespace data_visualization {
+
+/**
+ * @brief kTileSize Pixels per tile edge, a tile is the unit of work of a
+ * thread.
+ */
+const int kTileSize = 16;
+
+/**
+ * @brief kPacketSize Horizontally adjacent rays of a tile row traced
+ * together, one SIMD lane each.
+ */
+const int kPacketSize = 8;
+
+/**
+ * @brief RenderMode How the samples of a ray are combined. The projection
+ * modes show the density along the ray, without the transfer function or the
+ * shading. GLWidget builds the matching variant of shaders/raycast.frag.
+ */
+enum RenderMode {
+  kComposite = 0,
+  kMaximumIntensity = 1,
+  kMinimumIntensity = 2,
+  kAverageIntensity = 3
+};
+
+/**
+ * @brief RaycastSettings The shading options of a frame, the same as the
+ * features of the ray casting shader.
+ */
+struct RaycastSettings {
+  RenderMode mode = kComposite;
+  /* Light position in model coordinates, and color */
+  Eigen::Vector3f light_position = Eigen::Vector3f(1, 1, 1);
+  Eigen::Vector3f light_color = Eigen::Vector3f(1, 1, 1);
+  bool phong = true;
+  bool shadows = true;
+  bool preintegrated = false;
+  /* Step length, in texels of the longest edge of the volume */
+  float step_scale = 1.0f;
+};
+
+/**
+ * @brief CpuRaycaster Renders a volume on the CPU with the semantics of
+ * shaders/raycast.frag: front to back compositing of opacity corrected (or
+ * pre-integrated) samples, Phong shading from precomputed gradients, shadows
+ * from a light volume swept like LightVolume does, and empty space skipping,
+ * over a white background, or the projection modes. The image is split in
+ * tiles that are run as OpenMP tasks, so that idle threads take the remaining
+ * tiles, and every tile row is traced in packets of kPacketSize rays.
+ */
+class CpuRaycaster {
+ public:
+  /**
+   * @brief CpuRaycaster Constructor of the class.
+   */
+  CpuRaycaster();
+
+  CpuRaycaster(const CpuRaycaster&) = delete;
+  CpuRaycaster& operator=(const CpuRaycaster&) = delete;
+
+  /**
+   * @brief SetVolume Sets the voxels to render, and computes their gradients
+   * and occupancy grid. The voxels are not copied.
+   * @param data The voxels, width * height * depth bytes, they must outlive
+   * the renderer or the next call.
+   */
+  void SetVolume(const unsigned char* data, int width, int height, int depth);
+
+  /**
+   * @brief SetTransferFunction Sets the transfer function, the occupancy is
+   * classified again if the opacity changed.
+   * @param transfer_function The transfer function values, rgbargba...
+   */
+  void SetTransferFunction(const std::vector<float>& transfer_function);
+
+  /**
+   * @brief SetTransferFunction2D Sets the 2D transfer function, which the
+   * compositing uses instead of the transfer function, as the
+   * TRANSFER_FUNCTION_2D variant of the shader: without pre-integration or
+   * shadows. The occupancy is classified by its envelope.
+   * @param table The entries rgba, rows by gradient magnitude (see
+   * TransferFunction2D), or empty to use the transfer function again.
+   */
+  void SetTransferFunction2D(const std::vector<float>& table);
+
+  /**
+   * @brief Render Renders a frame. The light volume and the pre-integration
+   * table are computed again only when their inputs changed.
+   * @param projection Projection matrix.
+   * @param view View matrix.
+   * @param model Model matrix of the [-0.5, 0.5] cube holding the volume.
+   * @param settings The shading options.
+   * @param width Image width.
+   * @param height Image height.
+   * @param image Destination of width * height RGBA pixels, top row first.
+   */
+  void Render(const Eigen::Matrix4f& projection, const Eigen::Matrix4f& view,
+              const Eigen::Matrix4f& model, const RaycastSettings& settings,
+              int width, int height, std::vector<unsigned char>* image);
+
+ private:
+  /**
+   * @brief Frame The inputs of a frame shared by all of its rays.
+   */
+  struct Frame;
+
+  /**
+   * @brief Packet The state of the rays of a packet, one lane per ray.
+   */
+  struct Packet;
+
+  /**
+   * @brief TracePacket Traces the rays of count adjacent pixels of a row.
+   * @param pixels Destination of the RGBA pixels.
+   */
+  void TracePacket(const Frame& frame, int x, int y, int count,
+                   unsigned char* pixels) const;
+
+  /**
+   * @brief StartPacket Sets up the rays of count adjacent pixels of a row,
+   * from their entry into the volume.
+   */
+  void StartPacket(const Frame& frame, int x, int y, int count,
+                   Packet* packet) const;
+
+  /**
+   * @brief Composite Marches a packet compositing front to back.
+   */
+  void Composite(const Frame& frame, Packet* packet) const;
+
+  /**
+   * @brief Project Marches a packet in one of the projection modes, skipping
+   * the cells whose range cannot change the result.
+   */
+  void Project(const Frame& frame, Packet* packet) const;
+
+  /**
+   * @brief Classify Classifies the occupancy with the transfer function in
+   * use.
+   */
+  void Classify();
+
+  /**
+   * @brief CellOf Returns the occupancy cell holding the position of a lane.
+   */
+  int CellOf(const Packet& packet, int lane) const;
+
+  /**
+   * @brief StepPastCell Returns the distance of the first step of a lane past
+   * a cell.
+   */
+  float StepPastCell(const Frame& frame, const Packet& packet, int lane,
+                     int cell) const;
+
+  /**
+   * @brief SweepLight Computes the transmittance from the light (in texture
+   * coordinates) to the light volume, slice by slice.
+   */
+  void SweepLight(const Eigen::Vector3f& light);
+
+  /**
+   * @brief SampleLight Transmittance at a position in texture coordinates.
+   */
+  float SampleLight(const float* position) const;
+
+  const unsigned char* data_;
+  int dims_[3];
+
+  /**
+   * @brief gradients_ Packed gradients, see ComputeGradients.
+   */
+  std::vector<unsigned char> gradients_;
+
+  data_representation::OccupancyGrid occupancy_;
+  PreintegrationTable preintegration_table_;
+  std::vector<float> transfer_function_;
+  std::vector<float> transfer_function_2d_;
+  std::vector<float> envelope_;
+
+  /**
+   * @brief transmittance_ The light volume, its axes are the volume axes
+   * light_axes_, in the same layout as the LightVolume texture.
+   */
+  std::vector<float> transmittance_;
+  int light_size_[3];
+  int light_axes_[3];
+
+  /* Inputs of the last sweep */
+  bool light_valid_;
+  Eigen::Vector3f light_position_;
+  std::vector<float> light_transfer_function_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  CPU_RAYCASTER_H_
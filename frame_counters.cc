@@ -0,0 +1,111 @@
+#include <frame_counters.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local size_t gl_objects = 0;
+thread_local size_t allocations = 0;
+
+}  // namespace
+
+#ifdef VOLRENDAPP_FRAME_COUNTERS
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  void *memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == nullptr) throw std::bad_alloc();
+  return memory;
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete[](void *memory) noexcept { std::free(memory); }
+
+/* glGenTextures is exported by the GL library instead of loaded by GLEW */
+extern "C" {
+
+void __real_glGenTextures(GLsizei n, GLuint *textures);
+
+void __wrap_glGenTextures(GLsizei n, GLuint *textures) {
+  gl_objects += n;
+  __real_glGenTextures(n, textures);
+}
+
+}  // extern "C"
+
+namespace {
+
+/**
+ * @brief CountedGen Counts the names generated through a glGen* entry point
+ * loaded by GLEW, all of them share the signature of glGenBuffers.
+ */
+template <PFNGLGENBUFFERSPROC *kEntry>
+struct CountedGen {
+  static void GLAPIENTRY Gen(GLsizei n, GLuint *names) {
+    gl_objects += n;
+    real(n, names);
+  }
+
+  static void Install() {
+    if (*kEntry == nullptr || *kEntry == Gen) return;
+    real = *kEntry;
+    *kEntry = Gen;
+  }
+
+  static PFNGLGENBUFFERSPROC real;
+};
+
+template <PFNGLGENBUFFERSPROC *kEntry>
+PFNGLGENBUFFERSPROC CountedGen<kEntry>::real = nullptr;
+
+PFNGLCREATEPROGRAMPROC real_create_program = nullptr;
+PFNGLCREATESHADERPROC real_create_shader = nullptr;
+
+GLuint GLAPIENTRY CountedCreateProgram() {
+  ++gl_objects;
+  return real_create_program();
+}
+
+GLuint GLAPIENTRY CountedCreateShader(GLenum type) {
+  ++gl_objects;
+  return real_create_shader(type);
+}
+
+}  // namespace
+
+#endif
+
+namespace data_visualization {
+
+void InstallFrameCounters() {
+#ifdef VOLRENDAPP_FRAME_COUNTERS
+  CountedGen<&__glewGenBuffers>::Install();
+  CountedGen<&__glewGenVertexArrays>::Install();
+  CountedGen<&__glewGenFramebuffers>::Install();
+  CountedGen<&__glewGenRenderbuffers>::Install();
+  CountedGen<&__glewGenQueries>::Install();
+  CountedGen<&__glewGenSamplers>::Install();
+
+  if (__glewCreateProgram != CountedCreateProgram) {
+    real_create_program = __glewCreateProgram;
+    __glewCreateProgram = CountedCreateProgram;
+  }
+  if (__glewCreateShader != CountedCreateShader) {
+    real_create_shader = __glewCreateShader;
+    __glewCreateShader = CountedCreateShader;
+  }
+#endif
+}
+
+FrameCounters GetFrameCounters() {
+  FrameCounters counters;
+  counters.gl_objects = gl_objects;
+  counters.allocations = allocations;
+  return counters;
+}
+
+}  // namespace data_visualization
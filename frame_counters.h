@@ -0,0 +1,37 @@
+#ifndef FRAME_COUNTERS_H_
+#define FRAME_COUNTERS_H_
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+namespace data_visualization {
+
+/**
+ * @brief FrameCounters Number of GL objects created and of heap allocations
+ * made by a thread, so that the frames can check that they create nothing.
+ * They are only counted when VOLRENDAPP_FRAME_COUNTERS is defined (debug
+ * builds, which also link with -Wl,--wrap=glGenTextures), otherwise they
+ * stay 0.
+ */
+struct FrameCounters {
+  size_t gl_objects = 0;
+  size_t allocations = 0;
+};
+
+/**
+ * @brief InstallFrameCounters Starts counting the GL objects created, by
+ * wrapping the entry points loaded by GLEW. Textures are counted by the
+ * linker wrap of glGenTextures, and allocations through operator new.
+ * Requires glewInit to have been called.
+ */
+void InstallFrameCounters();
+
+/**
+ * @brief GetFrameCounters Returns the totals of the calling thread.
+ */
+FrameCounters GetFrameCounters();
+
+}  // namespace data_visualization
+
+#endif  //  FRAME_COUNTERS_H_
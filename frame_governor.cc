@@ -0,0 +1,68 @@
+#include <frame_governor.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace data_visualization {
+
+namespace {
+
+/* Weight of a new frame in the estimate of the cost, low enough that a
+ * single slow frame does not halve the resolution */
+const float kSmoothing = 0.25f;
+
+/* The step is lengthened alone down to this quality, a longer step costs
+ * less detail than a smaller target */
+const float kStepOnlyQuality = 0.5f;
+
+}  // namespace
+
+FrameGovernor::FrameGovernor()
+    : budget_(kDefaultFrameBudget),
+      cost_(0.0f),
+      resolution_scale_(1.0f),
+      step_scale_(1.0f) {}
+
+void FrameGovernor::SetBudget(float milliseconds) {
+  budget_ = std::max(milliseconds, 1.0f);
+}
+
+float FrameGovernor::GetBudget() const { return budget_; }
+
+void FrameGovernor::Update(float milliseconds, float quality) {
+  if (!(milliseconds > 0.0f) || !(quality > 0.0f)) return;
+
+  const float kCost = milliseconds / quality;
+  cost_ = cost_ == 0.0f ? kCost : cost_ + kSmoothing * (kCost - cost_);
+
+  const float kMinQuality =
+      GetQuality(kMinResolutionScale, kMaxGovernorStepScale);
+  const float kQuality = std::min(std::max(budget_ / cost_, kMinQuality), 1.0f);
+  if (kQuality >= kStepOnlyQuality) {
+    step_scale_ = 1.0f / kQuality;
+    resolution_scale_ = 1.0f;
+  } else {
+    /* The rest of the quality, resolution^2 / step, is split equally */
+    step_scale_ = std::min(
+        1.0f / (kStepOnlyQuality * std::sqrt(kQuality / kStepOnlyQuality)),
+        kMaxGovernorStepScale);
+    resolution_scale_ =
+        std::max(std::sqrt(kQuality * step_scale_), kMinResolutionScale);
+  }
+}
+
+void FrameGovernor::Reset() {
+  cost_ = 0.0f;
+  resolution_scale_ = 1.0f;
+  step_scale_ = 1.0f;
+}
+
+float FrameGovernor::GetResolutionScale() const { return resolution_scale_; }
+
+float FrameGovernor::GetStepScale() const { return step_scale_; }
+
+float FrameGovernor::GetQuality(float resolution_scale, float step_scale) {
+  return resolution_scale * resolution_scale / step_scale;
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,94 @@
+#ifndef FRAME_GOVERNOR_H_
+#define FRAME_GOVERNOR_H_
+
+namespace data_visualization {
+
+/**
+ * @brief kDefaultFrameBudget Frame time kept by the governor by default, in
+ * milliseconds.
+ */
+const int kDefaultFrameBudget = 33;
+
+/**
+ * @brief kMinResolutionScale kMaxGovernorStepScale How far the governor
+ * lowers the resolution of the render target, per axis, and lengthens the
+ * ray step.
+ */
+const float kMinResolutionScale = 0.25f;
+const float kMaxGovernorStepScale = 4.0f;
+
+/**
+ * @brief FrameGovernor Picks the resolution and the ray step of the frames
+ * rendered during an interaction so that they keep within a frame time
+ * budget. Their cost is modelled as proportional to the quality, the number
+ * of pixels times the samples per ray relative to a full frame, so that every
+ * measured frame, whatever its quality, estimates the time of a full one. The
+ * estimate is smoothed over the recent frames, and the quality that fits the
+ * budget is spent on a longer step first, up to twice as long, and then
+ * equally on both.
+ */
+class FrameGovernor {
+ public:
+  /**
+   * @brief FrameGovernor Constructor of the class, at full quality.
+   */
+  FrameGovernor();
+
+  /**
+   * @brief SetBudget Sets the frame time to keep.
+   * @param milliseconds The budget, in milliseconds.
+   */
+  void SetBudget(float milliseconds);
+
+  /**
+   * @brief GetBudget Returns the frame time kept, in milliseconds.
+   */
+  float GetBudget() const;
+
+  /**
+   * @brief Update Adds the time of a frame and picks the quality of the next
+   * ones.
+   * @param milliseconds The time of the frame.
+   * @param quality The quality it was rendered with, see GetQuality.
+   */
+  void Update(float milliseconds, float quality);
+
+  /**
+   * @brief Reset Forgets the measured frames, back to full quality.
+   */
+  void Reset();
+
+  /**
+   * @brief GetResolutionScale Returns the scale of the render target size,
+   * per axis, in [kMinResolutionScale, 1].
+   */
+  float GetResolutionScale() const;
+
+  /**
+   * @brief GetStepScale Returns the scale of the ray step, in
+   * [1, kMaxGovernorStepScale].
+   */
+  float GetStepScale() const;
+
+  /**
+   * @brief GetQuality Returns the relative cost of a frame rendered with a
+   * resolution and a step scale, resolution squared over the step.
+   */
+  static float GetQuality(float resolution_scale, float step_scale);
+
+ private:
+  float budget_;
+
+  /**
+   * @brief cost_ Smoothed time of a full quality frame, in milliseconds, 0
+   * until a frame is measured.
+   */
+  float cost_;
+
+  float resolution_scale_;
+  float step_scale_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  FRAME_GOVERNOR_H_
@@ -0,0 +1,198 @@
+#include <frame_profiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace data_visualization {
+
+namespace {
+
+/* Nesting depth of the sections reserved up front */
+const size_t kMaxSpans = 16;
+
+const float kNoTime = std::numeric_limits<float>::quiet_NaN();
+
+}  // namespace
+
+FrameProfiler::FrameProfiler(const std::vector<ProfilerSection> &sections)
+    : sections_(sections),
+      cpu_(kProfilerHistory * sections.size(), kNoTime),
+      gpu_(kProfilerHistory * sections.size(), kNoTime),
+      frames_(0),
+      current_(sections.size(), kNoTime),
+      query_frame_{-1, -1},
+      slot_(0) {
+  spans_.reserve(kMaxSpans);
+  for (int i = 0; i < 2; ++i) queried_[i].assign(sections.size(), 0);
+}
+
+FrameProfiler::~FrameProfiler() { Release(); }
+
+void FrameProfiler::Init() {
+  if (!queries_[0].empty() || !GLEW_ARB_timer_query) return;
+
+  for (int i = 0; i < 2; ++i) {
+    queries_[i].resize(sections_.size());
+    glGenQueries(queries_[i].size(), queries_[i].data());
+  }
+}
+
+void FrameProfiler::Release() {
+  for (int i = 0; i < 2; ++i) {
+    if (!queries_[i].empty())
+      glDeleteQueries(queries_[i].size(), queries_[i].data());
+    queries_[i].clear();
+    queried_[i].assign(sections_.size(), 0);
+  }
+}
+
+void FrameProfiler::Begin(int section) {
+  Span span;
+  span.section = section;
+  span.nested = 0.0;
+  span.query = sections_[section].gpu && !queries_[slot_].empty() &&
+               !queried_[slot_][section];
+  if (span.query) glBeginQuery(GL_TIME_ELAPSED, queries_[slot_][section]);
+  span.start = Clock::now();
+  spans_.push_back(span);
+}
+
+void FrameProfiler::End(int section) {
+  if (spans_.empty() || spans_.back().section != section) return;
+
+  const Span kSpan = spans_.back();
+  spans_.pop_back();
+  const double kTime =
+      std::chrono::duration<double, std::milli>(Clock::now() - kSpan.start)
+          .count();
+  if (kSpan.query) {
+    glEndQuery(GL_TIME_ELAPSED);
+    queried_[slot_][section] = 1;
+  }
+  if (!spans_.empty()) spans_.back().nested += kTime;
+
+  if (std::isnan(current_[section])) current_[section] = 0.0f;
+  current_[section] += kTime - kSpan.nested;
+}
+
+void FrameProfiler::EndFrame() {
+  const size_t kRow = (frames_ % kProfilerHistory) * sections_.size();
+  std::copy(current_.begin(), current_.end(), cpu_.begin() + kRow);
+  std::fill(gpu_.begin() + kRow, gpu_.begin() + kRow + sections_.size(),
+            kNoTime);
+  std::fill(current_.begin(), current_.end(), kNoTime);
+  query_frame_[slot_] = frames_;
+  ++frames_;
+
+  /* The next frame reuses the queries of the previous one */
+  slot_ = 1 - slot_;
+  ReadQueries();
+}
+
+void FrameProfiler::ReadQueries() {
+  const long long kFrame = query_frame_[slot_];
+  /* Too late, its row was recorded over */
+  const bool kKept = kFrame >= 0 && frames_ - kFrame <= kProfilerHistory;
+
+  for (size_t i = 0; i < queried_[slot_].size(); ++i) {
+    if (!queried_[slot_][i]) continue;
+    queried_[slot_][i] = 0;
+
+    /* A late result is dropped rather than waited for */
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(queries_[slot_][i], GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (available != GL_TRUE || !kKept) continue;
+
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(queries_[slot_][i], GL_QUERY_RESULT, &nanoseconds);
+    gpu_[(kFrame % kProfilerHistory) * sections_.size() + i] =
+        nanoseconds * 1e-6;
+  }
+}
+
+int FrameProfiler::GetSectionCount() const { return sections_.size(); }
+
+const std::string &FrameProfiler::GetSectionName(int section) const {
+  return sections_[section].name;
+}
+
+FrameProfiler::Statistics FrameProfiler::GetCpuStatistics(
+    int section) const {
+  return Compute(cpu_, section);
+}
+
+FrameProfiler::Statistics FrameProfiler::GetGpuStatistics(
+    int section) const {
+  return Compute(gpu_, section);
+}
+
+long long FrameProfiler::GetFrameCount() const { return frames_; }
+
+float FrameProfiler::GetFrameTime(long long frame, bool gpu) const {
+  if (frame < 0 || frame >= frames_ || frames_ - frame > kProfilerHistory)
+    return kNoTime;
+
+  const std::vector<float> &history = gpu ? gpu_ : cpu_;
+  const size_t kRow = (frame % kProfilerHistory) * sections_.size();
+  float time = kNoTime;
+  for (size_t i = 0; i < sections_.size(); ++i) {
+    if (std::isnan(history[kRow + i])) continue;
+    time = std::isnan(time) ? history[kRow + i] : time + history[kRow + i];
+  }
+  return time;
+}
+
+FrameProfiler::Statistics FrameProfiler::Compute(
+    const std::vector<float> &history, int section) const {
+  std::vector<float> times;
+  for (size_t i = section; i < history.size(); i += sections_.size())
+    if (!std::isnan(history[i])) times.push_back(history[i]);
+
+  Statistics statistics;
+  statistics.frames = times.size();
+  if (times.empty()) return statistics;
+
+  double sum = 0.0;
+  for (float time : times) sum += time;
+  statistics.average = sum / times.size();
+  statistics.min = *std::min_element(times.begin(), times.end());
+
+  /* Nearest rank */
+  const size_t kRank = std::ceil(0.99 * times.size()) - 1;
+  std::nth_element(times.begin(), times.begin() + kRank, times.end());
+  statistics.p99 = times[kRank];
+  return statistics;
+}
+
+bool FrameProfiler::WriteCsv(const std::string &filename) const {
+  std::ofstream file(filename.c_str());
+  if (!file.is_open()) return false;
+
+  file << "frame";
+  for (const ProfilerSection &section : sections_) {
+    file << "," << section.name << " cpu";
+    if (section.gpu) file << "," << section.name << " gpu";
+  }
+  file << "\n";
+
+  const long long kFirst = std::max(0LL, frames_ - kProfilerHistory);
+  for (long long frame = kFirst; frame < frames_; ++frame) {
+    const size_t kRow = (frame % kProfilerHistory) * sections_.size();
+    file << frame;
+    for (size_t i = 0; i < sections_.size(); ++i) {
+      file << ",";
+      if (!std::isnan(cpu_[kRow + i])) file << cpu_[kRow + i];
+      if (!sections_[i].gpu) continue;
+      file << ",";
+      if (!std::isnan(gpu_[kRow + i])) file << gpu_[kRow + i];
+    }
+    file << "\n";
+  }
+
+  return file.good();
+}
+
+}  // namespace data_visualization
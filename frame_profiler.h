@@ -0,0 +1,195 @@
+#ifndef FRAME_PROFILER_H_
+#define FRAME_PROFILER_H_
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace data_visualization {
+
+/**
+ * @brief kProfilerHistory Frames kept for the statistics and the CSV.
+ */
+const int kProfilerHistory = 512;
+
+/**
+ * @brief ProfilerSection A span of work timed every frame.
+ */
+struct ProfilerSection {
+  std::string name;
+
+  /* Whether its GL commands are timed too, GPU sections must not nest */
+  bool gpu;
+};
+
+/**
+ * @brief FrameProfiler Times the sections of every frame, on the CPU with a
+ * steady clock and, for the GPU sections, with GL_TIME_ELAPSED queries. The
+ * queries are double buffered: those of a frame are read when the next frame
+ * ends, if their results are available, so that the pipeline never stalls,
+ * and a frame whose results are late has no GPU times. The CPU time of a
+ * section excludes the sections nested in it, and the times of a section
+ * that runs several times in a frame are added (its GPU time is that of its
+ * first run). The last kProfilerHistory frames are kept, and recording does
+ * not allocate.
+ */
+class FrameProfiler {
+ public:
+  /**
+   * @brief Statistics Times of a section over the kept frames where it ran,
+   * in milliseconds.
+   */
+  struct Statistics {
+    int frames = 0;
+    float min = 0.0f;
+    float average = 0.0f;
+    float p99 = 0.0f;
+  };
+
+  /**
+   * @brief FrameProfiler Constructor of the class.
+   * @param sections The sections, identified by their index from now on.
+   */
+  explicit FrameProfiler(const std::vector<ProfilerSection> &sections);
+
+  /**
+   * @brief ~FrameProfiler Destructor of the class. Calls Release.
+   */
+  ~FrameProfiler();
+
+  FrameProfiler(const FrameProfiler &) = delete;
+  FrameProfiler &operator=(const FrameProfiler &) = delete;
+
+  /**
+   * @brief Init Creates the queries, until then only the CPU is timed.
+   * Requires the GL context to be current.
+   */
+  void Init();
+
+  /**
+   * @brief Release Deletes the queries.
+   */
+  void Release();
+
+  /**
+   * @brief Begin Starts timing a section.
+   */
+  void Begin(int section);
+
+  /**
+   * @brief End Stops timing a section, the last one begun.
+   */
+  void End(int section);
+
+  /**
+   * @brief EndFrame Closes the frame, made of the sections timed since the
+   * previous one, and reads the GPU times of the previous frame.
+   */
+  void EndFrame();
+
+  /**
+   * @brief GetSectionCount Returns the number of sections.
+   */
+  int GetSectionCount() const;
+
+  /**
+   * @brief GetSectionName Returns the name of a section.
+   */
+  const std::string &GetSectionName(int section) const;
+
+  /**
+   * @brief GetCpuStatistics Returns the CPU times of a section.
+   */
+  Statistics GetCpuStatistics(int section) const;
+
+  /**
+   * @brief GetGpuStatistics Returns the GPU times of a section, no frames
+   * for CPU sections.
+   */
+  Statistics GetGpuStatistics(int section) const;
+
+  /**
+   * @brief GetFrameCount Returns the number of frames ended.
+   */
+  long long GetFrameCount() const;
+
+  /**
+   * @brief GetFrameTime Returns the CPU or GPU time of a kept frame, the sum
+   * of its sections, in milliseconds, or NaN when none has a time. The GPU
+   * times of a frame are read when the next one ends.
+   */
+  float GetFrameTime(long long frame, bool gpu) const;
+
+  /**
+   * @brief WriteCsv Writes the kept frames to a CSV file, one row per frame
+   * and the CPU and GPU milliseconds of every section, empty where the
+   * section did not run or its GPU time was not available.
+   * @return Whether the file could be written.
+   */
+  bool WriteCsv(const std::string &filename) const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  /**
+   * @brief Span A section being timed.
+   */
+  struct Span {
+    int section;
+    Clock::time_point start;
+    /* CPU time of the sections nested in it */
+    double nested;
+    /* Whether it began a query */
+    bool query;
+  };
+
+  /**
+   * @brief Compute Returns the statistics of a column of the history.
+   */
+  Statistics Compute(const std::vector<float> &history, int section) const;
+
+  /**
+   * @brief ReadQueries Reads the GPU times of the frame that used the
+   * current query slot.
+   */
+  void ReadQueries();
+
+  std::vector<ProfilerSection> sections_;
+
+  /**
+   * @brief cpu_ gpu_ Milliseconds of the kept frames, kProfilerHistory rows
+   * of one column per section, NaN where the section has no time.
+   */
+  std::vector<float> cpu_;
+  std::vector<float> gpu_;
+
+  /**
+   * @brief frames_ Number of frames ended.
+   */
+  long long frames_;
+
+  /**
+   * @brief current_ CPU times of the frame being recorded.
+   */
+  std::vector<float> current_;
+
+  /**
+   * @brief spans_ The sections being timed, innermost last.
+   */
+  std::vector<Span> spans_;
+
+  /**
+   * @brief queries_ Two slots of one query per section, the current frame
+   * uses one while the results of the previous one arrive in the other.
+   */
+  std::vector<GLuint> queries_[2];
+  std::vector<char> queried_[2];
+  long long query_frame_[2];
+  int slot_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  FRAME_PROFILER_H_
@@ -2,11 +2,28 @@
 
 #include <glwidget.h>
 
-#include <fstream>
+#include <QFont>
+#include <QGuiApplication>
+#include <QImage>
+#include <QScreen>
+#include <QWindow>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <tuple>
 
+#include "./brick_cache.h"
+#include "./frame_counters.h"
+#include "./occupancy_grid.h"
 #include "./volume.h"
 #include "./volume_io.h"
 
@@ -22,38 +39,150 @@ const char kFragmentShaderFile[] = "../shaders/raycast.frag";
 const char kVertexShaderPointsFile[] = "../shaders/point.vert";
 const char kFragmentShaderPointsFile[] = "../shaders/point.frag";
 
-const int kVertexAttributeIdx = 0;
-const int kNormalAttributeIdx = 1;
-
-bool ReadFile(const std::string filename, std::string *shader_source) {
-  std::ifstream infile(filename.c_str());
-
-  if (!infile.is_open() || !infile.good()) {
-    std::cerr << "Error " + filename + " not found." << std::endl;
-    return false;
-  }
-
-  std::stringstream stream;
-  stream << infile.rdbuf();
-  infile.close();
-
-  *shader_source = stream.str();
-  return true;
-}
+const char kVertexShaderMeshFile[] = "../shaders/mesh.vert";
+const char kFragmentShaderMeshFile[] = "../shaders/mesh.frag";
+
+const char kVertexShaderLightFile[] = "../shaders/light_volume.vert";
+const char kFragmentShaderLightFile[] = "../shaders/light_volume.frag";
+
+const char kVertexShaderReprojectFile[] = "../shaders/reproject.vert";
+const char kFragmentShaderReprojectFile[] = "../shaders/reproject.frag";
+
+const int kLoaderPollInterval = 10;
+const int kProgramPollInterval = 10;
+
+/* Frames per second when the screen does not report its refresh rate */
+const double kDefaultRefreshRate = 60.0;
+
+/* Frames rendering the same state before it is steady, drivers compile
+ * their own variants of the programs on the first draws */
+const int kWarmupFrames = 2;
+
+/* GPU memory budget of a volume in megabytes, larger volumes are bricked */
+const size_t kDefaultBrickBudget = 512;
+
+/* Features and uniforms of the isosurface shader */
+const std::vector<std::string> kMeshFeatures = {"PHONG"};
+enum MeshUniform { kVoxelToModelUniform, kSurfaceColorUniform };
+const data_visualization::ProgramInterface kMeshInterface = {
+    {"voxel_to_model", "surface_color"}, {}, {"Frame"}};
+
+/* The light point is drawn at the light position of the Frame block */
+const data_visualization::ProgramInterface kPointsInterface = {
+    {}, {}, {"Frame"}};
+
+/* The previous frame is drawn as a point per pixel */
+enum ReprojectUniform { kReprojectionUniform };
+const data_visualization::ProgramInterface kReprojectInterface = {
+    {"reprojection"}, {{"previous_color", 0}, {"previous_depth", 1}}, {}};
+
+/* Sections of the profiler, in the order of kProfilerSections */
+enum ProfilerSectionIndex {
+  kPaintSection,
+  kEventsSection,
+  kTransferFunctionSection,
+  kLightVolumeSection,
+  kPreintegrationSection,
+  kClassificationSection,
+  kBricksSection,
+  kReprojectionSection,
+  kRaycastSection,
+  kIsosurfaceSection,
+  kLightPointSection
+};
+const std::vector<data_visualization::ProfilerSection> kProfilerSections = {
+    {"paintGL", false},       {"events", false},
+    {"transfer function", true}, {"light volume", true},
+    {"preintegration", true}, {"classification", true},
+    {"bricks", true},         {"reprojection", true},
+    {"ray cast", true},       {"isosurface", true},
+    {"light point", true}};
+
+/* Passes averaged by the progressive mode once the first coarse one is
+ * replaced, and how much longer the step of the coarse pass is */
+const int kProgressivePasses = 16;
+const float kCoarseStepScale = 4.0f;
+
+/* The jitter of consecutive passes, by the golden ratio, stays evenly spread
+ * over the step whatever the number of passes */
+const float kGoldenRatioConjugate = 0.618034f;
+
+/* Time from the last change of an interaction to the full quality frame,
+ * in milliseconds, longer than the gaps between the events of a drag */
+const int kSettleTime = 250;
+
+/* Color of the isosurface where the transfer function is black */
+const float kDefaultSurfaceColor[3] = {0.9f, 0.85f, 0.75f};
 
 }  // namespace
 
 GLWidget::GLWidget(QWidget *parent)
-    : QGLWidget(parent), initialized_(false), width_(0.0), height_(0.0) {
+    : QGLWidget(parent),
+      program_(kVertexShaderFile, kFragmentShaderFile,
+               data_visualization::kRaycastFeatures,
+               data_visualization::kRaycastInterface),
+      program_points_(kVertexShaderPointsFile, kFragmentShaderPointsFile, {},
+                      kPointsInterface),
+      program_light_(kVertexShaderLightFile, kFragmentShaderLightFile),
+      program_mesh_(kVertexShaderMeshFile, kFragmentShaderMeshFile,
+                    kMeshFeatures, kMeshInterface),
+      program_reproject_(kVertexShaderReprojectFile,
+                         kFragmentShaderReprojectFile, {},
+                         kReprojectInterface),
+      profiler_(kProfilerSections),
+      brick_budget_(kDefaultBrickBudget << 20),
+      initialized_(false),
+      width_(0.0),
+      height_(0.0) {
   setFocusPolicy(Qt::StrongFocus);
 
+  const char *budget = std::getenv("VOLRENDAPP_BRICK_BUDGET_MB");
+  if (budget != nullptr && std::atoi(budget) > 0)
+    brick_budget_ = static_cast<size_t>(std::atoi(budget)) << 20;
+
   light_position_ = glm::vec3(1, 1, 1);
   light_color_ = glm::vec3(1, 1, 1);
+
+  connect(&loader_timer_, SIGNAL(timeout()), this, SLOT(PollLoader()));
+  connect(&program_timer_, SIGNAL(timeout()), this, SLOT(PollPrograms()));
+
+  frame_timer_.setSingleShot(true);
+  frame_timer_.setTimerType(Qt::PreciseTimer);
+  connect(&frame_timer_, SIGNAL(timeout()), this, SLOT(updateGL()));
+  frame_clock_.start();
+
+  settle_timer_.setSingleShot(true);
+  connect(&settle_timer_, SIGNAL(timeout()), this, SLOT(updateGL()));
 }
 
-GLWidget::~GLWidget() {}
+GLWidget::~GLWidget() {
+  /* Textures and staging buffers are released with the context current */
+  makeCurrent();
+  loader_.Cancel();
+  light_volume_.Release();
+  preintegration_table_.Release();
+  classified_volume_.Release();
+  accumulation_.Release();
+  scaled_target_.Release();
+  reprojection_.Release();
+  transfer_function_texture_.Release();
+  transfer_function_2d_.Release();
+  isosurface_mesh_.reset();
+  program_.Release();
+  program_points_.Release();
+  program_light_.Release();
+  program_mesh_.Release();
+  program_reproject_.Release();
+  profiler_.Release();
+  if (frame_uniforms_ != 0) glDeleteBuffers(1, &frame_uniforms_);
+  if (points_vao_ != 0) glDeleteVertexArrays(1, &points_vao_);
+  loading_vol_.reset();
+  previous_vol_.reset();
+  vol_.reset();
+}
 
 bool GLWidget::LoadVolume(const QString &path) {
+  makeCurrent();
   std::unique_ptr<data_representation::Volume> vol =
       std::make_unique<data_representation::Volume>();
 
@@ -61,6 +190,8 @@ bool GLWidget::LoadVolume(const QString &path) {
                                          vol.get())) {
     vol_.reset(vol.release());
     camera_.UpdateModel(cube_->min_, cube_->max_);
+    isosurface_dirty_ = true;
+    classified_volume_.Invalidate();
 
     return true;
   }
@@ -68,110 +199,327 @@ bool GLWidget::LoadVolume(const QString &path) {
   return false;
 }
 
+void GLWidget::LoadVolumeAsync(const QString &path) {
+  if (loader_timer_.isActive()) CancelLoad();
+
+  makeCurrent();
+  loading_vol_ = std::make_unique<data_representation::Volume>();
+  loader_.Start(path.toUtf8().constData(), loading_vol_.get(),
+                brick_budget_);
+  loader_timer_.start(kLoaderPollInterval);
+}
+
+void GLWidget::SetBrickBudget(size_t bytes) { brick_budget_ = bytes; }
+
+void GLWidget::PollPrograms() {
+  makeCurrent();
+  bool changed = program_.Poll();
+  changed |= program_points_.Poll();
+  changed |= program_mesh_.Poll();
+  changed |= program_reproject_.Poll();
+  if (program_light_.Poll()) {
+    light_volume_.Invalidate();
+    changed = true;
+  }
+
+  if (!program_.IsPending() && !program_points_.IsPending() &&
+      !program_light_.IsPending() && !program_mesh_.IsPending() &&
+      !program_reproject_.IsPending())
+    program_timer_.stop();
+  if (changed) ScheduleFrame();
+}
+
+void GLWidget::CancelLoad() {
+  if (!loader_timer_.isActive()) return;
+
+  makeCurrent();
+  loader_.Cancel();
+  PollLoader();
+}
+
+void GLWidget::PollLoader() {
+  makeCurrent();
+  const data_representation::VolumeLoader::State kState = loader_.Poll();
+
+  if (kState == data_representation::VolumeLoader::kLoading ||
+      kState == data_representation::VolumeLoader::kFinished) {
+    /* The new volume is displayed as soon as it holds a slab */
+    if (loading_vol_ != nullptr && loader_.HasData()) {
+      previous_vol_ = std::move(vol_);
+      vol_ = std::move(loading_vol_);
+      camera_.UpdateModel(cube_->min_, cube_->max_);
+      isosurface_dirty_ = true;
+      classified_volume_.Invalidate();
+    }
+  }
+
+  if (kState == data_representation::VolumeLoader::kLoading) {
+    emit LoadProgress(static_cast<int>(100 * loader_.GetProgress()));
+    if (vol_ != nullptr && loading_vol_ == nullptr) {
+      /* The slabs uploaded since the last poll cast shadows too */
+      light_volume_.Invalidate();
+      ScheduleFrame();
+    }
+    return;
+  }
+
+  loader_timer_.stop();
+  isosurface_dirty_ = true;
+  classified_volume_.Invalidate();
+
+  if (kState == data_representation::VolumeLoader::kFinished) {
+    previous_vol_.reset();
+    emit LoadProgress(100);
+    emit LoadFinished(true);
+  } else {
+    /* Failed or cancelled, the partial volume is dropped */
+    if (loading_vol_ == nullptr) vol_ = std::move(previous_vol_);
+    loading_vol_.reset();
+    previous_vol_.reset();
+    emit LoadFinished(false);
+  }
+
+  ScheduleFrame();
+}
+
 std::vector<double>& GLWidget::GetVolumeHistogram(){
     if (vol_ != nullptr) return vol_->histogram_;
 }
 
+const std::vector<double> &GLWidget::GetVolumeJointHistogram() const {
+  static const std::vector<double> kNoHistogram;
+  return vol_ != nullptr ? vol_->joint_histogram_ : kNoHistogram;
+}
+
 void GLWidget::SetTransferFunction() {
+    SetTransferFunction(0, data_visualization::kTransferFunctionEntries - 1);
+}
 
-    glBindTexture(GL_TEXTURE_1D, transfer_function_texture_id_);
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32F, transfer_function_values_.size()/4, 0, GL_RGBA, GL_FLOAT, &transfer_function_values_[0]);
+void GLWidget::SetTransferFunction(int first, int last) {
+    /* The transfer function widget calls this for every curve it redraws,
+     * the next frame uploads all of their changes at once */
+    transfer_function_texture_.MarkDirty(first, last);
+    ScheduleFrame();
+}
 
-    /*
-     * Perform this check since the transfer function widget could flood the glwidget with updateGL requests
-     * as the graphs are dragged around
-    */
-    if (last_render_timestamp_ + 50 < QDateTime::currentMSecsSinceEpoch()){
-        updateGL();
-    }
+void GLWidget::SetTransferFunction2D() {
+    ScheduleFrame();
+}
 
+void GLWidget::UploadTransferFunction() {
+  /* The 2D transfer function is only rasterized while it is used */
+  const bool kDirty2D =
+      calc_transfer_function_2d_ && transfer_function_2d_.IsDirty();
+  if (!transfer_function_texture_.IsDirty() && !kDirty2D) return;
+
+  profiler_.Begin(kTransferFunctionSection);
+  if (transfer_function_texture_.IsDirty() &&
+      transfer_function_texture_.Update(transfer_function_.GetValues()))
+    ++transfer_function_version_;
+  if (kDirty2D && transfer_function_2d_.Update()) ++transfer_function_version_;
+  profiler_.End(kTransferFunctionSection);
+}
+
+void GLWidget::ScheduleFrame() {
+  /* Rendered by the frame already scheduled */
+  if (frame_timer_.isActive()) {
+    ++coalesced_frames_;
+    return;
+  }
+
+  const QWindow *kWindow = window()->windowHandle();
+  const QScreen *kScreen = kWindow != nullptr
+                               ? kWindow->screen()
+                               : QGuiApplication::primaryScreen();
+  double refresh_rate = kDefaultRefreshRate;
+  if (kScreen != nullptr && kScreen->refreshRate() > 0.0)
+    refresh_rate = kScreen->refreshRate();
+
+  /* Right away if a refresh period passed since the last frame */
+  const qint64 kPeriod = 1000.0 / refresh_rate;
+  frame_timer_.start(std::max<qint64>(0, kPeriod - frame_clock_.elapsed()));
 }
 
 void GLWidget::LightPosXValueChanged(double arg) {
     light_position_.x = arg;
-    updateGL();
+    ScheduleFrame();
 }
 
 void GLWidget::LightPosYValueChanged(double arg){
     light_position_.y = arg;
-    updateGL();
+    ScheduleFrame();
 }
 void GLWidget::LightPosZValueChanged(double arg){
     light_position_.z = arg;
-    updateGL();
+    ScheduleFrame();
 }
 
 void GLWidget::LightColorXValueChanged(double arg){
     light_color_.x = arg;
-    updateGL();
+    ScheduleFrame();
 }
 void GLWidget::LightColorYValueChanged(double arg){
     light_color_.y = arg;
-    updateGL();
+    ScheduleFrame();
 }
 void GLWidget::LightColorZValueChanged(double arg){
     light_color_.z = arg;
-    updateGL();
+    ScheduleFrame();
 }
 
 void GLWidget::SetPhongShadingCalc(bool arg){
     calc_phong_ = arg;
-    updateGL();
+    ScheduleFrame();
 }
 
 void GLWidget::SetShadowsCalc(bool arg){
     calc_shadow_ = arg;
-    updateGL();
+    ScheduleFrame();
+}
+
+void GLWidget::SetPreintegrationCalc(bool arg){
+    calc_preintegration_ = arg;
+    ScheduleFrame();
+}
+
+void GLWidget::SetStepScale(double arg){
+    step_scale_ = arg;
+    ScheduleFrame();
+}
+
+void GLWidget::SetRenderMode(int arg){
+    render_mode_ = static_cast<data_visualization::RenderMode>(arg);
+    ScheduleFrame();
+}
+
+void GLWidget::SetTransferFunctionFormat(int arg){
+    transfer_function_texture_.SetFormat(
+        static_cast<data_visualization::TransferFunctionFormat>(arg));
+    ScheduleFrame();
+}
+
+void GLWidget::SetTransferFunction2DCalc(bool arg){
+    calc_transfer_function_2d_ = arg;
+    ScheduleFrame();
+}
+
+void GLWidget::SetPreclassifiedCalc(bool arg){
+    calc_preclassified_ = arg;
+    /* The baked volume and the copies of the voxels are only kept while in
+     * use */
+    if (!arg) {
+      makeCurrent();
+      classified_volume_.Release();
+    }
+    ScheduleFrame();
+}
+
+void GLWidget::SetProgressiveCalc(bool arg){
+    calc_progressive_ = arg;
+    if (!arg) {
+      makeCurrent();
+      accumulation_.Release();
+    }
+    ScheduleFrame();
+}
+
+void GLWidget::SetGovernorCalc(bool arg){
+    calc_governor_ = arg;
+    if (!arg) {
+      makeCurrent();
+      scaled_target_.Release();
+      governor_.Reset();
+      settle_timer_.stop();
+    }
+    ScheduleFrame();
+}
+
+void GLWidget::SetFrameBudget(int arg){
+    governor_.SetBudget(arg);
+    ScheduleFrame();
+}
+
+void GLWidget::SetReprojectionCalc(bool arg){
+    calc_reprojection_ = arg;
+    if (!arg) {
+      makeCurrent();
+      reprojection_.Release();
+      reprojection_valid_ = false;
+    }
+    ScheduleFrame();
+}
+
+void GLWidget::SetProfilerOverlay(bool arg){
+    show_profiler_ = arg;
+    ScheduleFrame();
+}
+
+void GLWidget::SetIsosurfaceCalc(bool arg){
+    calc_isosurface_ = arg;
+    ScheduleFrame();
+}
+
+void GLWidget::SetIsoValue(int arg){
+    iso_value_ = arg;
+    isosurface_dirty_ = true;
+    if (calc_isosurface_) ScheduleFrame();
+}
+
+bool GLWidget::ExportIsosurface(const QString &filename) {
+  makeCurrent();
+  if (!UpdateIsosurface()) return false;
+  return data_representation::WritePly(filename.toUtf8().constData(),
+                                       isosurface_);
+}
+
+bool GLWidget::ExportProfile(const QString &filename) const {
+  return profiler_.WriteCsv(filename.toUtf8().constData());
+}
+
+bool GLWidget::event(QEvent *event) {
+  /* The frames painted while handling the event are not counted */
+  profiler_.Begin(kEventsSection);
+  const bool kHandled = QGLWidget::event(event);
+  profiler_.End(kEventsSection);
+  return kHandled;
 }
 
 void GLWidget::initializeGL() {
   glewInit();
+  data_visualization::InstallFrameCounters();
+  profiler_.Init();
 
   glEnable(GL_NORMALIZE);
   glEnable(GL_CULL_FACE);
   glCullFace(GL_BACK);
   glEnable(GL_DEPTH_TEST);
 
-  std::string vertex_shader, fragment_shader;
-  bool res = ReadFile(kVertexShaderFile, &vertex_shader) &&
-             ReadFile(kFragmentShaderFile, &fragment_shader);
-
-  std::string vertex_shader_point, fragment_shader_point;
-  res = ReadFile(kVertexShaderPointsFile, &vertex_shader_point) &&
-             ReadFile(kFragmentShaderPointsFile, &fragment_shader_point);
+  /* Reloads link in the driver threads, when it has them */
+  if (GLEW_ARB_parallel_shader_compile) glMaxShaderCompilerThreadsARB(~0u);
 
-  if (!res) exit(0);
+  /* The programs are built on first use, a missing shader only disables
+   * what it draws */
+  if (!program_.Load() || !program_points_.Load() || !program_light_.Load() ||
+      !program_mesh_.Load() || !program_reproject_.Load())
+    std::cerr << "Some shaders could not be read." << std::endl;
 
   cube_ = std::make_unique<data_representation::Cube>();
-  program_ = std::make_unique<QOpenGLShaderProgram>();
-  program_->addShaderFromSourceCode(QOpenGLShader::Vertex,
-                                    vertex_shader.c_str());
-  program_->addShaderFromSourceCode(QOpenGLShader::Fragment,
-                                    fragment_shader.c_str());
-  program_->bindAttributeLocation("vertex", kVertexAttributeIdx);
-  program_->bindAttributeLocation("normal", kNormalAttributeIdx);
-  program_->link();
-
-  /* Initialize transfer function to zeros */
-  transfer_function_values_ = std::vector<float>(256 * 4, 0.0f);
-  glGenTextures(1, &transfer_function_texture_id_);
-  glBindTexture(GL_TEXTURE_1D, transfer_function_texture_id_);
-  /* Set border style to clamp */
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  /* Initialize point rendering shader */
-  program_points_ = std::make_unique<QOpenGLShaderProgram>();
-  program_points_->addShaderFromSourceCode(QOpenGLShader::Vertex, vertex_shader_point.c_str());
-  program_points_->addShaderFromSourceCode(QOpenGLShader::Fragment, fragment_shader_point.c_str());
-  program_points_->bindAttributeLocation("vertex", kVertexAttributeIdx);
-  program_points_->link();
+
+  /* The texture of the transfer function is allocated and filled by the
+   * first frame */
+
   glEnable(GL_PROGRAM_POINT_SIZE);
 
+  /* Updated with a single upload per frame */
+  glGenBuffers(1, &frame_uniforms_);
+  glBindBuffer(GL_UNIFORM_BUFFER, frame_uniforms_);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(data_visualization::FrameBlock),
+               nullptr, GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, data_visualization::kFrameBinding,
+                   frame_uniforms_);
+
+  /* The light point has no vertex attributes */
   glGenVertexArrays(1, &points_vao_);
-  glBindVertexArray(0);
 
   initialized_ = true;
 }
@@ -192,14 +540,14 @@ void GLWidget::mousePressEvent(QMouseEvent *event) {
   if (event->button() == Qt::RightButton) {
     camera_.StartZooming(event->x(), event->y());
   }
-  updateGL();
+  ScheduleFrame();
 }
 
 void GLWidget::mouseMoveEvent(QMouseEvent *event) {
   camera_.SetRotationX(event->y());
   camera_.SetRotationY(event->x());
   camera_.SafeZoom(event->y());
-  updateGL();
+  ScheduleFrame();
 }
 
 void GLWidget::mouseReleaseEvent(QMouseEvent *event) {
@@ -209,7 +557,7 @@ void GLWidget::mouseReleaseEvent(QMouseEvent *event) {
   if (event->button() == Qt::RightButton) {
     camera_.StopZooming(event->x(), event->y());
   }
-  updateGL();
+  ScheduleFrame();
 }
 
 void GLWidget::keyPressEvent(QKeyEvent *event) {
@@ -225,113 +573,603 @@ void GLWidget::keyPressEvent(QKeyEvent *event) {
   if (event->key() == Qt::Key_A) camera_.Rotate(-1);
   if (event->key() == Qt::Key_D) camera_.Rotate(1);
 
+  /* The current programs are used until the new ones link */
   if (event->key() == Qt::Key_R) {
-    std::string vertex_shader, fragment_shader;
-    bool res = ReadFile(kVertexShaderFile, &vertex_shader) &&
-               ReadFile(kFragmentShaderFile, &fragment_shader);
-
-    std::string vertex_shader_point, fragment_shader_point;
-    res = ReadFile(kVertexShaderPointsFile, &vertex_shader_point) &&
-               ReadFile(kFragmentShaderPointsFile, &fragment_shader_point);
-
-    if (!res) exit(0);
-
-    program_ = std::make_unique<QOpenGLShaderProgram>();
-    program_->addShaderFromSourceCode(QOpenGLShader::Vertex,
-                                      vertex_shader.c_str());
-    program_->addShaderFromSourceCode(QOpenGLShader::Fragment,
-                                      fragment_shader.c_str());
-    program_->bindAttributeLocation("vertex", kVertexAttributeIdx);
-    program_->bindAttributeLocation("normal", kNormalAttributeIdx);
-    program_->link();
-
-    program_points_ = std::make_unique<QOpenGLShaderProgram>();
-    program_points_->addShaderFromSourceCode(QOpenGLShader::Vertex, vertex_shader_point.c_str());
-    program_points_->addShaderFromSourceCode(QOpenGLShader::Fragment, fragment_shader_point.c_str());
-    program_points_->bindAttributeLocation("vertex", kVertexAttributeIdx);
-    program_points_->link();
+    makeCurrent();
+    program_.Reload();
+    program_points_.Reload();
+    program_light_.Reload();
+    program_mesh_.Reload();
+    program_reproject_.Reload();
+    program_timer_.start(kProgramPollInterval);
   }
 
-  updateGL();
+  if (event->key() == Qt::Key_C) {
+    CompareCpuRender();
+    return;
+  }
+
+  ScheduleFrame();
+}
+
+bool GLWidget::ReadVoxels(std::vector<unsigned char> *voxels) {
+  if (vol_ == nullptr || vol_->GetBrickCache() != nullptr ||
+      loader_timer_.isActive())
+    return false;
+
+  /* The volume keeps its voxels in the texture only */
+  makeCurrent();
+  voxels->resize(static_cast<size_t>(vol_->width_) * vol_->height_ *
+                 vol_->depth_);
+  glBindTexture(GL_TEXTURE_3D, vol_->GetTextureId());
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_UNSIGNED_BYTE, voxels->data());
+  return true;
+}
+
+void GLWidget::CompareCpuRender() {
+  std::vector<unsigned char> voxels;
+  if (!ReadVoxels(&voxels)) {
+    std::cerr << "The CPU renderer needs a volume loaded in core."
+              << std::endl;
+    return;
+  }
+
+  const int kWidth = width_, kHeight = height_;
+  typedef std::chrono::steady_clock Clock;
+  auto Milliseconds = [](Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+  };
+
+  /* The first frame also builds the light volume and the tables */
+  glFinish();
+  paintGL();
+  glFinish();
+  Clock::time_point start = Clock::now();
+  paintGL();
+  glFinish();
+  const double kGpuTime = Milliseconds(start);
+  std::vector<unsigned char> gpu(4 * static_cast<size_t>(kWidth) * kHeight);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, kWidth, kHeight, GL_RGBA, GL_UNSIGNED_BYTE, gpu.data());
+
+  start = Clock::now();
+  data_visualization::CpuRaycaster raycaster;
+  raycaster.SetVolume(voxels.data(), vol_->width_, vol_->height_,
+                      vol_->depth_);
+  raycaster.SetTransferFunction(transfer_function_.GetValues());
+  if (RaycastVariant() & data_visualization::kTransferFunction2DFeature)
+    raycaster.SetTransferFunction2D(transfer_function_2d_.GetTable());
+  const double kSetupTime = Milliseconds(start);
+
+  data_visualization::RaycastSettings settings;
+  settings.light_position =
+      Eigen::Vector3f(light_position_.x, light_position_.y, light_position_.z);
+  settings.light_color =
+      Eigen::Vector3f(light_color_.x, light_color_.y, light_color_.z);
+  settings.phong = calc_phong_;
+  settings.shadows = calc_shadow_;
+  settings.preintegrated = calc_preintegration_;
+  settings.step_scale = step_scale_;
+  settings.mode = render_mode_;
+
+  camera_.SetViewport();
+  const Eigen::Matrix4f kProjection = camera_.SetProjection();
+  const Eigen::Matrix4f kView = camera_.SetView();
+  const Eigen::Matrix4f kModel = camera_.SetModel();
+  std::vector<unsigned char> cpu;
+  start = Clock::now();
+  raycaster.Render(kProjection, kView, kModel, settings, kWidth, kHeight,
+                   &cpu);
+  const double kFirstCpuTime = Milliseconds(start);
+  start = Clock::now();
+  raycaster.Render(kProjection, kView, kModel, settings, kWidth, kHeight,
+                   &cpu);
+  const double kCpuTime = Milliseconds(start);
+
+  /* The GPU rows are bottom up, the light point is only drawn by the GPU */
+  const QImage kGpuImage =
+      QImage(gpu.data(), kWidth, kHeight, QImage::Format_RGBA8888).mirrored();
+  const QImage kCpuImage(cpu.data(), kWidth, kHeight, QImage::Format_RGBA8888);
+  double error = 0.0;
+  int max_error = 0;
+  for (int y = 0; y < kHeight; ++y) {
+    const uchar *gpu_row = kGpuImage.constScanLine(y);
+    const uchar *cpu_row = kCpuImage.constScanLine(y);
+    for (int i = 0; i < 4 * kWidth; ++i) {
+      if (i % 4 == 3) continue;
+      const int kError = std::abs(gpu_row[i] - cpu_row[i]);
+      error += kError;
+      max_error = std::max(max_error, kError);
+    }
+  }
+  kGpuImage.save("gpu_render.png");
+  kCpuImage.save("cpu_render.png");
+
+  std::cout << "GPU: " << kGpuTime << " ms (" << 1000.0 / kGpuTime
+            << " fps)" << std::endl
+            << "CPU: " << kCpuTime << " ms (" << 1000.0 / kCpuTime
+            << " fps), setup " << kSetupTime << " ms, first frame "
+            << kFirstCpuTime << " ms" << std::endl
+            << "Mean error " << error / (3.0 * kWidth * kHeight)
+            << ", max error " << max_error << std::endl;
+
+  ScheduleFrame();
+}
+
+bool GLWidget::UpdateIsosurface() {
+  if (!isosurface_dirty_) return isosurface_mesh_ != nullptr;
+
+  /* Extracted again once the volume is loaded in core */
+  isosurface_mesh_.reset();
+  std::vector<unsigned char> voxels;
+  if (!ReadVoxels(&voxels)) return false;
+
+  /* Timed by the profiler, in the isosurface section of paintGL */
+  data_representation::OccupancyGrid *ranges = vol_->GetOccupancyGrid();
+  data_representation::OccupancyGrid volume_ranges;
+  if (ranges == nullptr) {
+    volume_ranges.Init(vol_->width_, vol_->height_, vol_->depth_,
+                       data_representation::kOccupancyCellSize);
+    volume_ranges.Accumulate(voxels.data(), 0, vol_->depth_);
+    ranges = &volume_ranges;
+  }
+  data_representation::ExtractIsosurface(voxels.data(), vol_->width_,
+                                         vol_->height_, vol_->depth_, *ranges,
+                                         iso_value_, &isosurface_);
+  isosurface_mesh_ = std::make_unique<data_representation::Mesh>(isosurface_);
+  isosurface_dirty_ = false;
+
+  return true;
+}
+
+void GLWidget::RenderIsosurface() {
+  /* Voxel centers are at the texel centers of the [-0.5, 0.5] cube */
+  const Eigen::Vector3f kSize(vol_->width_, vol_->height_, vol_->depth_);
+  Eigen::Affine3f voxel_to_model = Eigen::Affine3f::Identity();
+  voxel_to_model.translate(Eigen::Vector3f::Constant(-0.5f) +
+                           kSize.cwiseInverse() * 0.5f);
+  voxel_to_model.scale(kSize.cwiseInverse());
+
+  Eigen::Vector3f color =
+      Eigen::Vector3f::Map(&transfer_function_.GetValues()[4 * iso_value_]);
+  if (color.isZero()) color = Eigen::Vector3f::Map(kDefaultSurfaceColor);
+
+  const data_visualization::ShaderVariants::Program &kProgram =
+      program_mesh_.Get(calc_phong_ ? 1 : 0);
+  if (kProgram.id == 0) return;
+
+  glUseProgram(kProgram.id);
+  glUniformMatrix4fv(kProgram.uniforms[kVoxelToModelUniform], 1, GL_FALSE,
+                     voxel_to_model.matrix().data());
+  glUniform3fv(kProgram.uniforms[kSurfaceColorUniform], 1, color.data());
+
+  /* Surfaces cut by the volume bounds are open */
+  glDisable(GL_CULL_FACE);
+  isosurface_mesh_->Render();
+  glEnable(GL_CULL_FACE);
+}
+
+unsigned int GLWidget::RaycastVariant() const {
+  data_visualization::RaycastOptions options;
+  options.mode = render_mode_;
+  options.phong = calc_phong_;
+  options.shadows = calc_shadow_;
+  options.preintegrated = calc_preintegration_;
+  options.transfer_function_2d = calc_transfer_function_2d_;
+  /* Volumes being loaded are classified per sample, their texture is not
+   * complete */
+  options.preclassified = calc_preclassified_ && !loader_timer_.isActive();
+  options.jittered = calc_progressive_;
+  if (vol_ != nullptr) {
+    options.bricked = vol_->GetBrickCache() != nullptr;
+    options.skip_empty = vol_->GetOccupancyGrid() != nullptr;
+    options.precomputed_gradients = vol_->GetGradientTextureId() != 0;
+  }
+  return data_visualization::GetRaycastVariant(options);
+}
+
+bool GLWidget::RenderVolume(const Eigen::Matrix4f &view,
+                            const Eigen::Matrix4f &model, bool reprojected) {
+  const unsigned int kVariant =
+      RaycastVariant() |
+      (reprojected ? data_visualization::kReprojectedFeature : 0);
+  const data_visualization::ShaderVariants::Program &kProgram =
+      program_.Get(kVariant);
+  const GLuint kLightProgram = program_light_.Get(0).id;
+  if (vol_ == nullptr || kProgram.id == 0) return false;
+
+  /* Everything visible under the 2D transfer function is visible under its
+   * envelope */
+  const std::vector<float> &kClassification =
+      (kVariant & data_visualization::kTransferFunction2DFeature)
+          ? transfer_function_2d_.GetEnvelope()
+          : transfer_function_.GetValues();
+
+  /* The updates bind their own textures, so they come before the textures
+   * of the ray casting are bound */
+
+  /* Swept again only when the volume, light or transfer function change */
+  if ((kVariant & data_visualization::kShadowsFeature) && kLightProgram != 0) {
+    profiler_.Begin(kLightVolumeSection);
+    light_volume_.Update(
+        kLightProgram, vol_->GetTextureId(),
+        Eigen::Vector3i(vol_->width_, vol_->height_, vol_->depth_),
+        transfer_function_texture_.GetTextureId(),
+        transfer_function_.GetValues(),
+        Eigen::Vector3f(light_position_.x, light_position_.y,
+                        light_position_.z) +
+            Eigen::Vector3f::Constant(0.5f));
+    profiler_.End(kLightVolumeSection);
+  }
+
+  /* Only the bricks holding the densities that changed are baked again, and
+   * every brick when the baked light changed */
+  if (kVariant & data_visualization::kPreclassifiedFeature) {
+    profiler_.Begin(kClassificationSection);
+    classified_volume_.Update(
+        vol_->GetTextureId(), vol_->GetGradientTextureId(),
+        Eigen::Vector3i(vol_->width_, vol_->height_, vol_->depth_),
+        transfer_function_.GetValues(), calc_phong_,
+        Eigen::Vector3f(light_position_.x, light_position_.y,
+                        light_position_.z) +
+            Eigen::Vector3f::Constant(0.5f),
+        Eigen::Vector3f(light_color_.x, light_color_.y, light_color_.z));
+    profiler_.End(kClassificationSection);
+  }
+
+  /* The table is only integrated again where the transfer function or the
+   * step changed */
+  if (kVariant & data_visualization::kPreintegratedFeature) {
+    profiler_.Begin(kPreintegrationSection);
+    preintegration_table_.Update(transfer_function_.GetValues(), step_scale_);
+    profiler_.End(kPreintegrationSection);
+  }
+
+  bool bricks_missing = false;
+  data_representation::BrickCache *bricks = vol_->GetBrickCache();
+  if (bricks != nullptr) {
+    /* The cube is rendered in [-0.5, 0.5], textures span [0, 1] */
+    profiler_.Begin(kBricksSection);
+    const Eigen::Matrix4f kInverse = (view * model).inverse();
+    const Eigen::Vector3f kEye =
+        kInverse.block<3, 1>(0, 3) + Eigen::Vector3f::Constant(0.5f);
+    bricks_missing = bricks->Update(kEye, kClassification);
+    profiler_.End(kBricksSection);
+  }
+
+  /* The occupancy is only classified again when the opacity changed */
+  profiler_.Begin(kRaycastSection);
+  data_representation::OccupancyGrid *occupancy = vol_->GetOccupancyGrid();
+  if (occupancy != nullptr) occupancy->Update(kClassification);
+
+  data_visualization::RaycastInputs inputs;
+  inputs.volume = vol_->GetTextureId();
+  inputs.volume_size =
+      Eigen::Vector3i(vol_->width_, vol_->height_, vol_->depth_);
+  inputs.transfer_function = transfer_function_texture_.GetTextureId();
+  if (bricks != nullptr) {
+    inputs.brick_atlas = bricks->GetAtlasTextureId();
+    inputs.page_table = bricks->GetPageTableTextureId();
+  }
+  inputs.occupancy = occupancy;
+  inputs.gradients = vol_->GetGradientTextureId();
+  inputs.light_volume = light_volume_.GetTextureId();
+  inputs.light_axes = light_volume_.GetAxes();
+  inputs.preintegration_table = preintegration_table_.GetTextureId();
+  inputs.transfer_function_2d = transfer_function_2d_.GetTextureId();
+  inputs.classified_volume = classified_volume_.GetTextureId();
+  inputs.jitter = std::fmod(progressive_pass_ * kGoldenRatioConjugate, 1.0f);
+  inputs.reprojected_color = reprojection_.GetReprojectedColorId();
+  inputs.reprojected_depth = reprojection_.GetReprojectedDepthId();
+  inputs.reprojection_parity = frames_ % 2;
+  data_visualization::RenderRaycast(kProgram, kVariant, inputs, cube_.get());
+
+  profiler_.End(kRaycastSection);
+  return bricks_missing;
 }
 
 void GLWidget::paintGL() {
+  /* Whatever triggered it, this frame renders the scheduled changes */
+  frame_timer_.stop();
+  frame_clock_.restart();
+  ++frames_;
+
+  profiler_.Begin(kPaintSection);
   glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   if (initialized_) {
+    const data_visualization::FrameCounters kCounters =
+        data_visualization::GetFrameCounters();
+    UploadTransferFunction();
+    FrameState state = CurrentFrameState();
+
     camera_.SetViewport();
 
     Eigen::Matrix4f projection = camera_.SetProjection();
     Eigen::Matrix4f view = camera_.SetView();
     Eigen::Matrix4f model = camera_.SetModel();
 
-    program_->bind();
-    GLuint projection_location = program_->uniformLocation("projection");
-    glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
-
-    GLuint view_location = program_->uniformLocation("view");
-    glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
-
-    GLuint model_location = program_->uniformLocation("model");
-    glUniformMatrix4fv(model_location, 1, GL_FALSE, model.data());
+    /* Every program reads the matrices and the light from the Frame block */
+    data_visualization::FrameBlock frame = {};
+    std::copy_n(projection.data(), 16, frame.projection);
+    std::copy_n(view.data(), 16, frame.view);
+    std::copy_n(model.data(), 16, frame.model);
+    std::copy_n(&light_position_[0], 3, frame.light_position);
+    std::copy_n(&light_color_[0], 3, frame.light_color);
+    frame.step_scale = step_scale_;
+
+    /* The frames where the state or the uniforms change, or a load or a
+     * program is pending, are those of an interaction. The resolution the
+     * governor picked for the previous frame is not a change */
+    state.scaled = last_frame_state_.scaled;
+    const bool kSameState = state == last_frame_state_ &&
+                            !loader_timer_.isActive() &&
+                            !program_timer_.isActive();
+    const bool kChanged =
+        !kSameState ||
+        std::memcmp(&frame, &last_frame_block_, sizeof(frame)) != 0;
+
+    /* Or only the camera moved, the view and the model matrices */
+    const size_t kLightOffset =
+        offsetof(data_visualization::FrameBlock, light_position);
+    const bool kCameraOnly =
+        kSameState &&
+        std::memcmp(frame.projection, last_frame_block_.projection,
+                    sizeof(frame.projection)) == 0 &&
+        std::memcmp(reinterpret_cast<const char *>(&frame) + kLightOffset,
+                    reinterpret_cast<const char *>(&last_frame_block_) +
+                        kLightOffset,
+                    sizeof(frame) - kLightOffset) == 0;
+    last_frame_block_ = frame;
+
+    /* The progressive mode ray casts one jittered pass into the average per
+     * frame until it converges, and then only displays it. Any change
+     * restarts the passes, the first one with a coarse step, but for the
+     * pre-integrated variants whose table is integrated for the full step */
+    const bool kProgressive = calc_progressive_ && !calc_isosurface_;
+    const int kFirstFinePass =
+        (state.raycast_variant & data_visualization::kPreintegratedFeature)
+            ? 0
+            : 1;
+    if (kProgressive) {
+      if (accumulation_.Resize(width_, height_) || kChanged)
+        progressive_pass_ = 0;
+      if (progressive_pass_ < kFirstFinePass)
+        frame.step_scale *= kCoarseStepScale;
+    }
+    const bool kRender =
+        !kProgressive ||
+        progressive_pass_ < kFirstFinePass + kProgressivePasses;
+
+    /* The governor renders the frames of an interaction, until kSettleTime
+     * after its last change, at the resolution and step that fit the budget,
+     * and then one frame at full quality. The progressive mode has its own
+     * coarse first frame */
+    const bool kGoverned = calc_governor_ && !kProgressive;
+    const long long kProfilerFrame = profiler_.GetFrameCount();
+    float resolution_scale = 1.0f, governor_step_scale = 1.0f;
+    if (kGoverned) {
+      /* The GPU times of the frame before the previous one are the latest,
+       * and a frame takes at least its CPU time */
+      if (kProfilerFrame >= 2 && frame_quality_[kProfilerFrame % 2] > 0.0f) {
+        const float kGpuTime =
+            profiler_.GetFrameTime(kProfilerFrame - 2, true);
+        const float kCpuTime =
+            profiler_.GetFrameTime(kProfilerFrame - 2, false);
+        governor_.Update(std::isnan(kGpuTime) ? kCpuTime
+                                              : std::max(kGpuTime, kCpuTime),
+                         frame_quality_[kProfilerFrame % 2]);
+      }
+      scaled_target_.Resize(width_, height_);
+
+      /* The timer is restarted after the frame check */
+      if (kChanged || settle_timer_.isActive()) {
+        resolution_scale = governor_.GetResolutionScale();
+        if (!(state.raycast_variant &
+              data_visualization::kPreintegratedFeature))
+          governor_step_scale = governor_.GetStepScale();
+        frame.step_scale *= governor_step_scale;
+      }
+    }
+    state.scaled = resolution_scale < 1.0f;
+    frame_quality_[kProfilerFrame % 2] =
+        kGoverned ? data_visualization::FrameGovernor::GetQuality(
+                        resolution_scale, governor_step_scale)
+                  : 0.0f;
+
+    /* The reprojection mode reuses the previous frame where only the camera
+     * moved, for the pixels it still covers, in half of them every frame.
+     * The frames of the other modes, and those scaled down, start again */
+    const bool kReprojection = calc_reprojection_ && !kProgressive &&
+                               !calc_isosurface_ && !state.scaled;
+    const Eigen::Matrix4f kViewProjection = projection * view * model;
+    if (!kReprojection || !kCameraOnly) reprojection_valid_ = false;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_uniforms_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+
+    if (kGoverned) scaled_target_.Bind(resolution_scale);
+
+    if (kReprojection) {
+      if (reprojection_.Resize(width_, height_)) reprojection_valid_ = false;
+
+      profiler_.Begin(kReprojectionSection);
+      const data_visualization::ShaderVariants::Program &kReprojectProgram =
+          program_reproject_.Get(0);
+      const bool kValid = reprojection_valid_ && kReprojectProgram.id != 0;
+      if (kValid) {
+        const Eigen::Matrix4f kMatrix =
+            kViewProjection * reprojection_view_projection_.inverse();
+        glUseProgram(kReprojectProgram.id);
+        glUniformMatrix4fv(kReprojectProgram.uniforms[kReprojectionUniform],
+                           1, GL_FALSE, kMatrix.data());
+        glBindVertexArray(points_vao_);
+      }
+      reprojection_.Reproject(kValid);
+      if (kValid) glBindVertexArray(0);
+      profiler_.End(kReprojectionSection);
+
+      reprojection_.Bind();
+    }
 
-    GLuint LPOS_location = program_->uniformLocation("LPOS");
-    glUniform3fv(LPOS_location, 1, &light_position_[0]);
+    /* The coarse pass, and then the first full step one, replace the
+     * average */
+    if (kProgressive && kRender)
+      accumulation_.BeginPass(
+          1.0f / std::max(progressive_pass_ - kFirstFinePass + 1, 1));
+
+    bool surface = false;
+    if (calc_isosurface_) {
+      profiler_.Begin(kIsosurfaceSection);
+      surface = UpdateIsosurface();
+      if (surface) RenderIsosurface();
+      profiler_.End(kIsosurfaceSection);
+    }
 
-    GLuint LCOL_location = program_->uniformLocation("LCOL");
-    glUniform3fv(LCOL_location, 1, &light_color_[0]);
+    bool bricks_missing = false;
+    if (kRender) {
+      /* Bricked volumes are ray cast instead */
+      if (!surface) bricks_missing = RenderVolume(view, model, kReprojection);
+
+      /* Draw light point */
+      const GLuint kPointProgram = program_points_.Get(0).id;
+      if (kPointProgram != 0) {
+        profiler_.Begin(kLightPointSection);
+        glUseProgram(kPointProgram);
+        glBindVertexArray(points_vao_);
+        glDrawArrays(GL_POINTS, 0, 1);
+        glBindVertexArray(0);
+        profiler_.End(kLightPointSection);
+      }
+    }
 
-    GLuint calc_phong = program_->uniformLocation("calc_phong");
-    glUniform1i(calc_phong, calc_phong_);
+    if (kProgressive) {
+      if (kRender) {
+        accumulation_.EndPass();
+        /* Restarted once the bricks in view are resident */
+        progressive_pass_ = bricks_missing ? 0 : progressive_pass_ + 1;
+      }
+      accumulation_.Display();
+    }
 
-    GLuint calc_shadow = program_->uniformLocation("calc_shadow");
-    glUniform1i(calc_shadow, calc_shadow_);
+    if (kReprojection) {
+      reprojection_.Display();
+      /* The overview of the bricks not resident yet is not reused */
+      reprojection_valid_ = !bricks_missing;
+      reprojection_view_projection_ = kViewProjection;
+    }
 
-    if (vol_ != nullptr) {
-      glEnable(GL_BLEND);
-      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (kGoverned) scaled_target_.Display();
 
-      glActiveTexture(GL_TEXTURE0);
-      glBindTexture(GL_TEXTURE_3D, vol_->GetTextureId());
+    CheckFrameCounters(state, kCounters);
 
-      GLint volume = program_->uniformLocation("volume");
-      glUniform1i(volume, 0);
-    }
+    /* Drawn by Qt, which allocates, so after the check */
+    if (show_profiler_) RenderProfilerOverlay();
 
-    /* Set transfer function */
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_1D, transfer_function_texture_id_);
-    GLint TF_location = program_->uniformLocation("transfer_function");
-    glUniform1i(TF_location, 1);
+    /* Keep rendering until the bricks in view are resident, and refining
+     * the progressive average while nothing changes. Starting a timer
+     * allocates, so the timers start after the check, the settling of the
+     * governor too */
+    if (bricks_missing ||
+        (kProgressive &&
+         progressive_pass_ < kFirstFinePass + kProgressivePasses))
+      ScheduleFrame();
+    if (kGoverned && kChanged) settle_timer_.start(kSettleTime);
+  }
 
-    cube_->Render();
+  profiler_.End(kPaintSection);
+  profiler_.EndFrame();
+}
 
-    glDisable(GL_BLEND);
+void GLWidget::RenderProfilerOverlay() {
+  /* renderText draws with the fixed function pipeline */
+  glUseProgram(0);
+  glDisable(GL_DEPTH_TEST);
+  glColor3f(0.0f, 0.0f, 0.0f);
+  QFont font("Monospace", 9);
+  font.setStyleHint(QFont::TypeWriter);
+
+  const int kLineHeight = 14;
+  char line[128];
+  std::snprintf(line, sizeof(line), "%-18s %-26s %s", "ms", "cpu min/avg/p99",
+                "gpu min/avg/p99");
+  renderText(kLineHeight, kLineHeight, line, font);
+
+  int row = 2;
+  for (int i = 0; i < profiler_.GetSectionCount(); ++i) {
+    const data_visualization::FrameProfiler::Statistics kCpu =
+        profiler_.GetCpuStatistics(i);
+    const data_visualization::FrameProfiler::Statistics kGpu =
+        profiler_.GetGpuStatistics(i);
+    if (kCpu.frames == 0) continue;
+
+    const int kLength = std::snprintf(
+        line, sizeof(line), "%-18s %8.2f %8.2f %8.2f",
+        profiler_.GetSectionName(i).c_str(), kCpu.min, kCpu.average, kCpu.p99);
+    if (kGpu.frames > 0)
+      std::snprintf(line + kLength, sizeof(line) - kLength,
+                    " %8.2f %8.2f %8.2f", kGpu.min, kGpu.average, kGpu.p99);
+    renderText(kLineHeight, row++ * kLineHeight, line, font);
+  }
 
-    /* Draw light point */
-    program_points_->bind();
-    projection_location = program_points_->uniformLocation("projection");
-    glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
+  /* Requests merged into a scheduled frame instead of rendering their own */
+  std::snprintf(line, sizeof(line),
+                "%lld frames, %lld redundant frames skipped", frames_,
+                coalesced_frames_);
+  renderText(kLineHeight, ++row * kLineHeight, line, font);
 
-    view_location = program_points_->uniformLocation("view");
-    glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
+  glEnable(GL_DEPTH_TEST);
+}
 
-    model_location = program_points_->uniformLocation("model");
-    glUniformMatrix4fv(model_location, 1, GL_FALSE, model.data());
+bool GLWidget::FrameState::operator==(const FrameState &other) const {
+  auto tie = [](const FrameState &frame) {
+    return std::tie(frame.volume, frame.isosurface, frame.raycast_variant,
+                    frame.mesh_variant, frame.iso_value, frame.step_scale,
+                    frame.transfer_function_version, frame.progressive,
+                    frame.governor, frame.scaled, frame.reprojection,
+                    frame.width, frame.height);
+  };
+  return tie(*this) == tie(other);
+}
 
-    glBindVertexArray(points_vao_);
-    GLuint point_vbo;
-    GLfloat light_vertices[] = {light_position_.x, light_position_.y, light_position_.z};
-    glGenBuffers(1, &point_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, point_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(light_vertices), light_vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-    glDrawArrays(GL_POINTS, 0, 1);
-    glDeleteBuffers(1, &point_vbo);
-    glBindVertexArray(0);
+GLWidget::FrameState GLWidget::CurrentFrameState() const {
+  FrameState state;
+  state.volume = vol_.get();
+  state.isosurface = calc_isosurface_;
+  state.raycast_variant = RaycastVariant();
+  state.mesh_variant = calc_phong_ ? 1 : 0;
+  state.iso_value = iso_value_;
+  state.step_scale = step_scale_;
+  state.transfer_function_version = transfer_function_version_;
+  state.progressive = calc_progressive_;
+  state.governor = calc_governor_;
+  state.reprojection = calc_reprojection_;
+  state.width = width_;
+  state.height = height_;
+  return state;
+}
 
-    last_render_timestamp_ = QDateTime::currentMSecsSinceEpoch();
-  }
+void GLWidget::CheckFrameCounters(
+    const FrameState &state, const data_visualization::FrameCounters &start) {
+  /* Loads, new programs, transfer functions, surfaces and sizes legitimately
+   * create and allocate */
+  if (state == last_frame_state_ && !loader_timer_.isActive() &&
+      !program_timer_.isActive())
+    ++steady_frames_;
+  else
+    steady_frames_ = 0;
+  last_frame_state_ = state;
+  if (steady_frames_ < kWarmupFrames) return;
+
+  const data_visualization::FrameCounters kEnd =
+      data_visualization::GetFrameCounters();
+  const size_t kObjects = kEnd.gl_objects - start.gl_objects;
+  const size_t kAllocations = kEnd.allocations - start.allocations;
+  if (kObjects != 0 || kAllocations != 0)
+    std::cerr << "Steady frame created " << kObjects << " GL objects and made "
+              << kAllocations << " allocations." << std::endl;
+  assert(kObjects == 0 && kAllocations == 0);
 }
@@ -6,17 +6,35 @@
 #include <GL/glew.h>
 #include <QGLWidget>
 #include <QMouseEvent>
-#include <QOpenGLShaderProgram>
 #include <QString>
-#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTimer>
 
 #include <glm/glm.hpp>
 
 #include <memory>
 
+#include "./accumulation_buffer.h"
 #include "./camera.h"
+#include "./classified_volume.h"
+#include "./cpu_raycaster.h"
 #include "./cube.h"
+#include "./frame_counters.h"
+#include "./frame_governor.h"
+#include "./frame_profiler.h"
+#include "./isosurface.h"
+#include "./light_volume.h"
+#include "./mesh.h"
+#include "./preintegration_table.h"
+#include "./raycast_program.h"
+#include "./render_target.h"
+#include "./reprojection_buffer.h"
+#include "./shader_variants.h"
+#include "./transfer_function.h"
+#include "./transfer_function_2d.h"
+#include "./transfer_function_texture.h"
 #include "./volume.h"
+#include "./volume_loader.h"
 
 class GLWidget : public QGLWidget {
   Q_OBJECT
@@ -32,6 +50,24 @@ class GLWidget : public QGLWidget {
    */
   bool LoadVolume(const QString &filename);
 
+  /**
+   * @brief LoadVolumeAsync Starts loading a volume model in the background.
+   * The current volume is rendered until the first slab of the new one is
+   * uploaded, then the new one is displayed while it loads. Progress is
+   * reported by LoadProgress and the end of the load by LoadFinished.
+   * @param filename Path to the stack of images composing the volume model.
+   */
+  void LoadVolumeAsync(const QString &filename);
+
+  /**
+   * @brief SetBrickBudget Sets the GPU memory budget of the volumes loaded
+   * from now on. Larger volumes are rendered out-of-core, streaming their
+   * bricks on demand. Defaults to kDefaultBrickBudget megabytes, or to the
+   * VOLRENDAPP_BRICK_BUDGET_MB environment variable.
+   * @param bytes Budget in bytes.
+   */
+  void SetBrickBudget(size_t bytes);
+
   /**
    * @brief
    * @return
@@ -39,17 +75,65 @@ class GLWidget : public QGLWidget {
   std::vector<double>& GetVolumeHistogram();
 
   /**
-    Holds the transfer function values, 256 * 4, rgbargba...
+   * @brief GetVolumeJointHistogram Returns the normalized joint histogram of
+   * the densities and gradient magnitudes of the volume, empty if there is
+   * no volume or it has no gradients.
+   */
+  const std::vector<double>& GetVolumeJointHistogram() const;
+
+  /**
+    Holds the transfer function curves and values, 256 * 4, rgbargba...
+  */
+  data_visualization::TransferFunction transfer_function_;
+
+  /**
+    Incremented every time the transfer function is sent to the GPU
   */
-  std::vector<float> transfer_function_values_;
+  unsigned int transfer_function_version_ = 0;
 
   /**
-    Sends the transfer function data to the GPU, will call updateGL
-    if enough time has passed since the last call
+    Marks the transfer function values changed, they are sent to the GPU
+    once by the next frame however many times it is called before
   */
   void SetTransferFunction();
 
+  /**
+    Same, when only the entries [first, last] changed, only those are sent
+  */
+  void SetTransferFunction(int first, int last);
+
+  /**
+    Holds the regions of the 2D transfer function, by density and gradient
+    magnitude, used instead of the curves when enabled
+  */
+  data_visualization::TransferFunction2D transfer_function_2d_;
+
+  /**
+    Marks the regions of the 2D transfer function changed, the entries under
+    them are rasterized and sent to the GPU by the next frame
+  */
+  void SetTransferFunction2D();
+
+  /**
+   * @brief ExportIsosurface Writes the isosurface at the current iso value to
+   * a binary PLY file, in voxel coordinates.
+   * @return Whether the surface could be extracted and written.
+   */
+  bool ExportIsosurface(const QString &filename);
+
+  /**
+   * @brief ExportProfile Writes the times of the last frames to a CSV file
+   * (see FrameProfiler::WriteCsv).
+   * @return Whether the file could be written.
+   */
+  bool ExportProfile(const QString &filename) const;
+
  protected:
+  /**
+   * @brief event Handles the events of the widget, profiling their time.
+   */
+  bool event(QEvent *event);
+
   /**
    * @brief initializeGL Initializes OpenGL variables and loads, compiles and
    * links shaders.
@@ -70,18 +154,229 @@ class GLWidget : public QGLWidget {
 
  private:
   /**
-   * @brief program_ A basic shader program.
+   * @brief CompareCpuRender Renders the current view on the GPU and with the
+   * CPU ray caster, reports the time of both and their difference, and saves
+   * both images (gpu_render.png, cpu_render.png).
+   */
+  void CompareCpuRender();
+
+  /**
+   * @brief ReadVoxels Reads the voxels of the volume back from its texture,
+   * if the volume is loaded in core.
+   * @return Whether the volume could be read.
+   */
+  bool ReadVoxels(std::vector<unsigned char> *voxels);
+
+  /**
+   * @brief UpdateIsosurface Extracts and uploads the isosurface again if the
+   * volume or the iso value changed.
+   * @return Whether there is a surface to render.
+   */
+  bool UpdateIsosurface();
+
+  /**
+   * @brief RenderIsosurface Rasterizes the isosurface, in place of the ray
+   * casting.
+   */
+  void RenderIsosurface();
+
+  /**
+   * @brief RaycastVariant Returns the features of the ray casting program
+   * for the volume and the current options.
+   */
+  unsigned int RaycastVariant() const;
+
+  /**
+   * @brief RenderVolume Ray casts the volume.
+   * @param reprojected Whether the pixels reuse the reprojected frame, and
+   * the frame is rendered into the reprojection buffer.
+   * @return Whether bricks in view are not resident yet.
+   */
+  bool RenderVolume(const Eigen::Matrix4f &view, const Eigen::Matrix4f &model,
+                    bool reprojected);
+
+  /**
+   * @brief FrameState What a frame renders, besides the view and the light.
+   * A frame that renders the same as the previous one is in steady state.
+   */
+  struct FrameState {
+    const data_representation::Volume *volume = nullptr;
+    bool isosurface = false;
+    unsigned int raycast_variant = 0;
+    unsigned int mesh_variant = 0;
+    int iso_value = 0;
+    float step_scale = 0.0f;
+    unsigned int transfer_function_version = 0;
+    bool progressive = false;
+    bool governor = false;
+    bool scaled = false;
+    bool reprojection = false;
+    int width = 0;
+    int height = 0;
+
+    bool operator==(const FrameState &other) const;
+  };
+
+  /**
+   * @brief CurrentFrameState Returns what the next frame renders.
+   */
+  FrameState CurrentFrameState() const;
+
+  /**
+   * @brief CheckFrameCounters Asserts that a steady state frame created no
+   * GL objects and made no heap allocations. They are only counted by debug
+   * builds (see FrameCounters).
+   * @param state What the frame rendered.
+   * @param start The counters before the frame.
+   */
+  void CheckFrameCounters(const FrameState &state,
+                          const data_visualization::FrameCounters &start);
+
+  /**
+   * @brief RenderProfilerOverlay Draws the statistics of the profiler and of
+   * the frame scheduling over the frame.
+   */
+  void RenderProfilerOverlay();
+
+  /**
+   * @brief UploadTransferFunction Sends the transfer function to the GPU if
+   * it changed since the last frame.
+   */
+  void UploadTransferFunction();
+
+  /**
+   * @brief program_ The ray casting programs, one per combination of
+   * features.
    */
-  std::unique_ptr<QOpenGLShaderProgram> program_;
+  data_visualization::ShaderVariants program_;
 
   /**
    * @brief program_ A basic point rendering shader program.
    */
-  std::unique_ptr<QOpenGLShaderProgram> program_points_;
+  data_visualization::ShaderVariants program_points_;
   /**
     The VAO for the point rendering pipeline
   */
-  GLuint points_vao_;
+  GLuint points_vao_ = 0;
+
+  /**
+   * @brief frame_uniforms_ Buffer of the Frame uniform block, the matrices
+   * and the light shared by the programs.
+   */
+  GLuint frame_uniforms_ = 0;
+
+  /**
+   * @brief last_frame_state_ What the previous frame rendered.
+   */
+  FrameState last_frame_state_;
+
+  /**
+   * @brief steady_frames_ Frames since the state changed.
+   */
+  int steady_frames_ = 0;
+
+  /**
+   * @brief program_light_ Shader program that sweeps the light volume.
+   */
+  data_visualization::ShaderVariants program_light_;
+
+  /**
+   * @brief program_mesh_ Shader program that shades the isosurface.
+   */
+  data_visualization::ShaderVariants program_mesh_;
+
+  /**
+   * @brief program_reproject_ Shader program that draws the previous frame
+   * into the view of the next one.
+   */
+  data_visualization::ShaderVariants program_reproject_;
+
+  /**
+   * @brief profiler_ Times the passes of the frames, the transfer function
+   * uploads and the event handling.
+   */
+  data_visualization::FrameProfiler profiler_;
+
+  /**
+   * @brief program_timer_ Polls the programs being linked after a reload.
+   */
+  QTimer program_timer_;
+
+  /**
+   * @brief light_volume_ Light reaching every texel, used for the shadows.
+   */
+  data_visualization::LightVolume light_volume_;
+
+  /**
+   * @brief preintegration_table_ Segment colors for larger steps.
+   */
+  data_visualization::PreintegrationTable preintegration_table_;
+
+  /**
+   * @brief classified_volume_ Colors of the voxels baked from the transfer
+   * function, used by the pre-classified mode.
+   */
+  data_visualization::ClassifiedVolume classified_volume_;
+
+  /**
+   * @brief accumulation_ Average of the passes of the progressive mode.
+   */
+  data_visualization::AccumulationBuffer accumulation_;
+
+  /**
+   * @brief last_frame_block_ The uniforms of the previous frame, with the
+   * full step. The frames where they change are those of an interaction.
+   */
+  data_visualization::FrameBlock last_frame_block_ = {};
+
+  /**
+   * @brief progressive_pass_ The next pass of the progressive mode, the
+   * passes restart from zero after any change.
+   */
+  int progressive_pass_ = 0;
+
+  /**
+   * @brief governor_ Picks the resolution and the step of the frames of an
+   * interaction from the GPU times of the previous frames.
+   */
+  data_visualization::FrameGovernor governor_;
+
+  /**
+   * @brief scaled_target_ The frames of an interaction are rendered into a
+   * corner of it and upsampled, while the governor is on.
+   */
+  data_visualization::RenderTarget scaled_target_;
+
+  /**
+   * @brief frame_quality_ The quality of the last two frames, see
+   * FrameGovernor::GetQuality, 0 for the frames not governed. The GPU times
+   * of a frame are read when the next one ends.
+   */
+  float frame_quality_[2] = {0.0f, 0.0f};
+
+  /**
+   * @brief settle_timer_ Runs from the last change of an interaction for
+   * kSettleTime, and then renders the frame at full quality.
+   */
+  QTimer settle_timer_;
+
+  /**
+   * @brief reprojection_ The frames of the reprojection mode, and the
+   * previous one reprojected.
+   */
+  data_visualization::ReprojectionBuffer reprojection_;
+
+  /**
+   * @brief reprojection_view_projection_ The projection, view and model
+   * matrices of the frame in the reprojection buffer.
+   */
+  Eigen::Matrix4f reprojection_view_projection_;
+
+  /**
+   * @brief reprojection_valid_ Whether the frame in the reprojection buffer
+   * can be reused, only the camera may have changed since.
+   */
+  bool reprojection_valid_ = false;
 
 
   /**
@@ -94,11 +389,47 @@ class GLWidget : public QGLWidget {
    */
   std::unique_ptr<data_representation::Cube> cube_;
 
+  /**
+   * @brief isosurface_ The isosurface of the volume, in voxel coordinates.
+   */
+  data_representation::TriangleMesh isosurface_;
+
+  /**
+   * @brief isosurface_mesh_ The isosurface uploaded for rendering.
+   */
+  std::unique_ptr<data_representation::Mesh> isosurface_mesh_;
+
   /**
    * @brief mesh_ Data structure representing a volume.
    */
   std::unique_ptr<data_representation::Volume> vol_;
 
+  /**
+   * @brief loader_ Loads volumes in the background.
+   */
+  data_representation::VolumeLoader loader_;
+
+  /**
+   * @brief loader_timer_ Polls the loader while a volume is being loaded.
+   */
+  QTimer loader_timer_;
+
+  /**
+   * @brief loading_vol_ The volume being loaded, until it is displayed.
+   */
+  std::unique_ptr<data_representation::Volume> loading_vol_;
+
+  /**
+   * @brief previous_vol_ The volume displayed before the current load, kept to
+   * be restored if the load fails or is cancelled.
+   */
+  std::unique_ptr<data_representation::Volume> previous_vol_;
+
+  /**
+   * @brief brick_budget_ GPU memory budget of a volume, in bytes.
+   */
+  size_t brick_budget_;
+
   /**
    * @brief initialized_ Whether the widget has finished initializations.
    */
@@ -125,14 +456,28 @@ class GLWidget : public QGLWidget {
   glm::vec3 light_color_;
 
   /**
-    The texture id for the transfer function
+    The texture of the transfer function, and the entries changed since it
+    was last uploaded
   */
-  GLuint transfer_function_texture_id_;
+  data_visualization::TransferFunctionTexture transfer_function_texture_;
 
   /**
-    The timestamp for the last render
-  */
-  qint64 last_render_timestamp_;
+   * @brief frame_timer_ Renders the scheduled frame, at most once per display
+   * refresh.
+   */
+  QTimer frame_timer_;
+
+  /**
+   * @brief frame_clock_ Time since the last frame was rendered.
+   */
+  QElapsedTimer frame_clock_;
+
+  /**
+   * @brief frames_ Frames rendered, and frame requests merged into a frame
+   * already scheduled, each one a frame that was not rendered.
+   */
+  long long frames_ = 0;
+  long long coalesced_frames_ = 0;
 
   /**
     Hold wether to perform phong and shadow calculations
@@ -140,13 +485,106 @@ class GLWidget : public QGLWidget {
   bool calc_phong_ = true;
   bool calc_shadow_ = true;
 
+  /**
+    Hold wether to use the pre-integrated transfer function, and the step
+    length in texels
+  */
+  bool calc_preintegration_ = false;
+  float step_scale_ = 1.0f;
+
+  /**
+    Hold wether to classify by density and gradient magnitude, with the 2D
+    transfer function, when the volume has precomputed gradients
+  */
+  bool calc_transfer_function_2d_ = false;
+
+  /**
+    Hold wether to sample the colors baked into the classified volume instead
+    of classifying every sample, for volumes held in a single texture
+  */
+  bool calc_preclassified_ = false;
+
+  /**
+    Hold wether to refine the image with jittered passes while nothing
+    changes, instead of ray casting every frame at the full step
+  */
+  bool calc_progressive_ = false;
+
+  /**
+    Hold wether to lower the resolution and lengthen the step of the frames
+    of an interaction to keep within the frame time budget
+  */
+  bool calc_governor_ = false;
+
+  /**
+    Hold wether to reuse the previous frame, reprojected, for half of the
+    pixels while only the camera moves
+  */
+  bool calc_reprojection_ = false;
+
+  /**
+    How the samples are combined, compositing or one of the projections
+  */
+  data_visualization::RenderMode render_mode_ =
+      data_visualization::kComposite;
+
+  /**
+    Hold wether to rasterize the isosurface instead of ray casting, its iso
+    value, and wether it must be extracted again
+  */
+  bool calc_isosurface_ = false;
+  int iso_value_ = 128;
+  bool isosurface_dirty_ = true;
+
+  /**
+    Hold wether to draw the profiler overlay
+  */
+  bool show_profiler_ = false;
+
  protected slots:
   /**
    * @brief paintGL Function that handles rendering the scene.
    */
   void paintGL();
 
+ private slots:
+  /**
+   * @brief PollLoader Uploads the slabs decoded in the background and swaps
+   * the volumes.
+   */
+  void PollLoader();
+
+  /**
+   * @brief PollPrograms Swaps the programs that finished linking after a
+   * reload.
+   */
+  void PollPrograms();
+
+ signals:
+  /**
+   * @brief LoadProgress Reports the progress of a background load.
+   * @param percent Percentage of the volume uploaded.
+   */
+  void LoadProgress(int percent);
+
+  /**
+   * @brief LoadFinished Reports the end of a background load.
+   * @param success Whether the volume was loaded.
+   */
+  void LoadFinished(bool success);
+
 public slots:
+  /**
+   * @brief ScheduleFrame Marks the view changed. The changes that arrive
+   * before the next display refresh are rendered together, by one frame.
+   */
+  void ScheduleFrame();
+
+  /**
+   * @brief CancelLoad Cancels the background load, if any, and restores the
+   * previous volume.
+   */
+  void CancelLoad();
 
     void LightPosXValueChanged(double arg);
     void LightPosYValueChanged(double arg);
@@ -159,6 +597,23 @@ public slots:
     void SetPhongShadingCalc(bool arg);
     void SetShadowsCalc(bool arg);
 
+    void SetPreintegrationCalc(bool arg);
+    void SetStepScale(double arg);
+
+    void SetRenderMode(int arg);
+    void SetTransferFunctionFormat(int arg);
+    void SetTransferFunction2DCalc(bool arg);
+    void SetPreclassifiedCalc(bool arg);
+    void SetProgressiveCalc(bool arg);
+    void SetGovernorCalc(bool arg);
+    void SetFrameBudget(int arg);
+    void SetReprojectionCalc(bool arg);
+
+    void SetProfilerOverlay(bool arg);
+
+    void SetIsosurfaceCalc(bool arg);
+    void SetIsoValue(int arg);
+
 };
 
 #endif  //  GLWIDGET_H_
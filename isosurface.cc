@@ -0,0 +1,309 @@
+#include <isosurface.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <unordered_map>
+
+namespace data_representation {
+
+namespace {
+
+/* Corner c of a cube is the voxel (x, y, z) + (c & 1, (c >> 1) & 1, c >> 2) */
+const int kCornerOffsets[8][3] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0},
+                                  {1, 1, 0}, {0, 0, 1}, {1, 0, 1},
+                                  {0, 1, 1}, {1, 1, 1}};
+
+/* Lower and upper corner of every edge, edge e is along the axis e / 4 */
+const int kEdgeCorners[12][2] = {{0, 1}, {2, 3}, {4, 5}, {6, 7},
+                                 {0, 2}, {1, 3}, {4, 6}, {5, 7},
+                                 {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+
+/* Corners of every face of a cube, in cyclic order */
+const int kFaceCorners[6][4] = {{0, 2, 6, 4}, {1, 3, 7, 5}, {0, 1, 5, 4},
+                                {2, 3, 7, 6}, {0, 1, 3, 2}, {4, 5, 7, 6}};
+
+/* Triangles of a cube, as edges, -1 terminated */
+const int kMaxCaseEdges = 16;
+
+/**
+ * @brief CaseTable The triangles of each of the 256 inside / outside
+ * configurations of the corners of a cube.
+ */
+struct CaseTable {
+  signed char edges[256][kMaxCaseEdges];
+};
+
+int EdgeBetween(int a, int b) {
+  for (int e = 0; e < 12; ++e)
+    if ((kEdgeCorners[e][0] == a && kEdgeCorners[e][1] == b) ||
+        (kEdgeCorners[e][0] == b && kEdgeCorners[e][1] == a))
+      return e;
+  return -1;
+}
+
+/**
+ * @brief BuildCase Polygonizes a configuration. On every face, each run of
+ * inside corners is cut off by a segment between the two crossed edges that
+ * bound it, so the two diagonal configurations of a face are separated the
+ * same way by both cubes sharing it. The segments close into loops, which are
+ * oriented towards the outside corners and triangulated as fans.
+ */
+void BuildCase(int mask, signed char *edges) {
+  int neighbours[12][2];
+  int degree[12] = {0};
+  for (int f = 0; f < 6; ++f) {
+    const int *corners = kFaceCorners[f];
+    for (int k = 0; k < 4; ++k) {
+      const int kPrevious = (k + 3) % 4;
+      if (!(mask >> corners[k] & 1) || (mask >> corners[kPrevious] & 1))
+        continue;
+      int last = k;
+      while (mask >> corners[(last + 1) % 4] & 1) last = (last + 1) % 4;
+      const int kEnter = EdgeBetween(corners[kPrevious], corners[k]);
+      const int kLeave = EdgeBetween(corners[last], corners[(last + 1) % 4]);
+      neighbours[kEnter][degree[kEnter]++] = kLeave;
+      neighbours[kLeave][degree[kLeave]++] = kEnter;
+    }
+  }
+
+  int count = 0;
+  bool visited[12] = {false};
+  for (int start = 0; start < 12; ++start) {
+    if (degree[start] == 0 || visited[start]) continue;
+
+    int loop[12], length = 0;
+    for (int e = start, previous = -1; !visited[e];) {
+      visited[e] = true;
+      loop[length++] = e;
+      const int kNext =
+          neighbours[e][0] != previous ? neighbours[e][0] : neighbours[e][1];
+      previous = e;
+      e = kNext;
+    }
+
+    /* Newell normal of the loop through the edge midpoints, against the
+     * directions from the inside to the outside corners */
+    double midpoints[12][3];
+    for (int i = 0; i < length; ++i) {
+      const int *corners = kEdgeCorners[loop[i]];
+      for (int c = 0; c < 3; ++c)
+        midpoints[i][c] = 0.5 * (kCornerOffsets[corners[0]][c] +
+                                 kCornerOffsets[corners[1]][c]);
+    }
+    double normal[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < length; ++i) {
+      const double *p = midpoints[i];
+      const double *q = midpoints[(i + 1) % length];
+      normal[0] += (p[1] - q[1]) * (p[2] + q[2]);
+      normal[1] += (p[2] - q[2]) * (p[0] + q[0]);
+      normal[2] += (p[0] - q[0]) * (p[1] + q[1]);
+    }
+    double facing = 0.0;
+    for (int i = 0; i < length; ++i) {
+      const double kSign = mask >> kEdgeCorners[loop[i]][0] & 1 ? 1.0 : -1.0;
+      facing += kSign * normal[loop[i] / 4];
+    }
+    if (facing < 0.0) std::reverse(loop, loop + length);
+
+    for (int i = 1; i + 1 < length; ++i) {
+      edges[count++] = loop[0];
+      edges[count++] = loop[i];
+      edges[count++] = loop[i + 1];
+    }
+  }
+  std::fill(edges + count, edges + kMaxCaseEdges, -1);
+}
+
+const CaseTable &GetCaseTable() {
+  static const CaseTable kTable = [] {
+    CaseTable table;
+    for (int mask = 0; mask < 256; ++mask) BuildCase(mask, table.edges[mask]);
+    return table;
+  }();
+  return kTable;
+}
+
+/**
+ * @brief Block The part of the mesh of a cell, with its own vertex indices.
+ */
+struct Block {
+  std::vector<float> vertices;
+  std::vector<float> normals;
+  std::vector<unsigned int> faces;
+
+  /* Edge of every vertex, and whether other cells may share it */
+  std::vector<uint64_t> edges;
+  std::vector<char> shared;
+};
+
+}  // namespace
+
+void ExtractIsosurface(const unsigned char *data, int width, int height,
+                       int depth, const OccupancyGrid &ranges, float iso,
+                       TriangleMesh *mesh) {
+  const CaseTable &kCases = GetCaseTable();
+  const int kDims[3] = {width, height, depth};
+  const int *kCells = ranges.GetCells();
+  const int kCellSize = ranges.GetCellSize();
+  const size_t kSliceSize = static_cast<size_t>(width) * height;
+
+  auto Voxel = [&](int x, int y, int z) {
+    return data[z * kSliceSize + static_cast<size_t>(y) * width + x];
+  };
+
+  /* Central differences, one sided on the borders, towards lower densities */
+  auto Gradient = [&](const int *voxel, float *gradient) {
+    for (int c = 0; c < 3; ++c) {
+      int low[3] = {voxel[0], voxel[1], voxel[2]};
+      int high[3] = {voxel[0], voxel[1], voxel[2]};
+      low[c] = std::max(0, voxel[c] - 1);
+      high[c] = std::min(kDims[c] - 1, voxel[c] + 1);
+      gradient[c] = high[c] > low[c]
+                        ? (Voxel(low[0], low[1], low[2]) -
+                           Voxel(high[0], high[1], high[2])) /
+                              static_cast<float>(high[c] - low[c])
+                        : 0.0f;
+    }
+  };
+
+  std::vector<Block> blocks(ranges.GetCellCount());
+
+#pragma omp parallel for schedule(dynamic)
+  for (int cell = 0; cell < ranges.GetCellCount(); ++cell) {
+    unsigned char min, max;
+    ranges.GetCellRange(cell, &min, &max);
+    if (min > max || max < iso || min >= iso) continue;
+
+    const int kCell[3] = {cell % kCells[0], cell / kCells[0] % kCells[1],
+                          cell / (kCells[0] * kCells[1])};
+    int begin[3], end[3];
+    for (int c = 0; c < 3; ++c) {
+      begin[c] = kCell[c] * kCellSize;
+      end[c] = std::min(begin[c] + kCellSize, kDims[c] - 1);
+    }
+
+    Block &block = blocks[cell];
+    std::unordered_map<uint64_t, unsigned int> indices;
+    for (int z = begin[2]; z < end[2]; ++z) {
+      for (int y = begin[1]; y < end[1]; ++y) {
+        for (int x = begin[0]; x < end[0]; ++x) {
+          unsigned char values[8];
+          int mask = 0;
+          for (int i = 0; i < 8; ++i) {
+            values[i] = Voxel(x + kCornerOffsets[i][0],
+                              y + kCornerOffsets[i][1],
+                              z + kCornerOffsets[i][2]);
+            if (values[i] >= iso) mask |= 1 << i;
+          }
+
+          const signed char *edges = kCases.edges[mask];
+          for (int i = 0; i < kMaxCaseEdges && edges[i] >= 0; ++i) {
+            const int kEdge = edges[i];
+            const int kAxis = kEdge / 4;
+            const int kLow = kEdgeCorners[kEdge][0];
+            const int kHigh = kEdgeCorners[kEdge][1];
+            const int kStart[3] = {x + kCornerOffsets[kLow][0],
+                                   y + kCornerOffsets[kLow][1],
+                                   z + kCornerOffsets[kLow][2]};
+            const uint64_t kKey =
+                3 * (kStart[2] * kSliceSize +
+                     static_cast<uint64_t>(kStart[1]) * width + kStart[0]) +
+                kAxis;
+
+            auto inserted = indices.emplace(kKey, block.edges.size());
+            block.faces.push_back(inserted.first->second);
+            if (!inserted.second) continue;
+
+            const float kT = (iso - values[kLow]) /
+                             static_cast<float>(values[kHigh] - values[kLow]);
+            int end_voxel[3] = {kStart[0], kStart[1], kStart[2]};
+            ++end_voxel[kAxis];
+            float low_gradient[3], high_gradient[3], normal[3];
+            Gradient(kStart, low_gradient);
+            Gradient(end_voxel, high_gradient);
+            for (int c = 0; c < 3; ++c) {
+              block.vertices.push_back(kStart[c] + (c == kAxis ? kT : 0.0f));
+              normal[c] = low_gradient[c] +
+                          kT * (high_gradient[c] - low_gradient[c]);
+            }
+            const float kLength = std::sqrt(normal[0] * normal[0] +
+                                            normal[1] * normal[1] +
+                                            normal[2] * normal[2]);
+            for (int c = 0; c < 3; ++c)
+              block.normals.push_back(kLength > 0.0f ? normal[c] / kLength
+                                                     : 0.0f);
+
+            /* The cubes around an edge lie in other cells when the edge is
+             * on a cell boundary across its axis */
+            bool shared = false;
+            for (int c = 0; c < 3; ++c)
+              if (c != kAxis && kStart[c] % kCellSize == 0) shared = true;
+            block.edges.push_back(kKey);
+            block.shared.push_back(shared);
+          }
+        }
+      }
+    }
+  }
+
+  /* Only the vertices on cell boundaries need to be looked up */
+  mesh->vertices.clear();
+  mesh->normals.clear();
+  mesh->faces.clear();
+  std::unordered_map<uint64_t, unsigned int> shared_indices;
+  std::vector<unsigned int> remap;
+  for (const Block &block : blocks) {
+    remap.resize(block.edges.size());
+    for (size_t i = 0; i < block.edges.size(); ++i) {
+      const unsigned int kIndex = mesh->vertices.size() / 3;
+      if (block.shared[i]) {
+        auto inserted = shared_indices.emplace(block.edges[i], kIndex);
+        remap[i] = inserted.first->second;
+        if (!inserted.second) continue;
+      } else {
+        remap[i] = kIndex;
+      }
+      mesh->vertices.insert(mesh->vertices.end(), &block.vertices[3 * i],
+                            &block.vertices[3 * i] + 3);
+      mesh->normals.insert(mesh->normals.end(), &block.normals[3 * i],
+                           &block.normals[3 * i] + 3);
+    }
+    for (unsigned int index : block.faces) mesh->faces.push_back(remap[index]);
+  }
+}
+
+bool WritePly(const std::string &filename, const TriangleMesh &mesh) {
+  std::ofstream out(filename.c_str(), std::ios::binary);
+  if (!out.is_open()) return false;
+
+  const size_t kVertexCount = mesh.vertices.size() / 3;
+  const size_t kFaceCount = mesh.faces.size() / 3;
+  out << "ply\n"
+      << "format binary_little_endian 1.0\n"
+      << "element vertex " << kVertexCount << "\n"
+      << "property float x\nproperty float y\nproperty float z\n"
+      << "property float nx\nproperty float ny\nproperty float nz\n"
+      << "element face " << kFaceCount << "\n"
+      << "property list uchar int vertex_indices\n"
+      << "end_header\n";
+
+  for (size_t i = 0; i < kVertexCount; ++i) {
+    out.write(reinterpret_cast<const char *>(&mesh.vertices[3 * i]),
+              3 * sizeof(float));
+    out.write(reinterpret_cast<const char *>(&mesh.normals[3 * i]),
+              3 * sizeof(float));
+  }
+
+  const unsigned char kCorners = 3;
+  for (size_t i = 0; i < kFaceCount; ++i) {
+    out.write(reinterpret_cast<const char *>(&kCorners), 1);
+    out.write(reinterpret_cast<const char *>(&mesh.faces[3 * i]),
+              3 * sizeof(unsigned int));
+  }
+
+  return out.good();
+}
+
+}  // namespace data_representation
@@ -0,0 +1,52 @@
+#ifndef ISOSURFACE_H_
+#define ISOSURFACE_H_
+
+#include <string>
+#include <vector>
+
+#include "./occupancy_grid.h"
+
+namespace data_representation {
+
+/**
+ * @brief TriangleMesh An indexed triangle mesh in voxel coordinates, the
+ * voxel (x, y, z) being at (x, y, z). Triangles are counter clockwise seen
+ * from the side of the lower densities, where the normals point to.
+ */
+struct TriangleMesh {
+  /* Positions and unit normals, xyzxyz... */
+  std::vector<float> vertices;
+  std::vector<float> normals;
+
+  /* Three vertex indices per triangle */
+  std::vector<unsigned int> faces;
+};
+
+/**
+ * @brief ExtractIsosurface Extracts the isosurface of a volume with marching
+ * cubes. The volume is split in the cells of an occupancy grid, which are
+ * polygonized concurrently, skipping the cells whose range does not cross the
+ * iso value. Every vertex lies on an edge of the voxel grid, and the vertices
+ * of an edge shared by several cells are merged by hashing the edge index, so
+ * that the mesh is watertight. Normals come from the gradient by central
+ * differences.
+ * @param data The voxels, width * height * depth bytes.
+ * @param ranges The occupancy grid of the volume, with its ranges
+ * accumulated.
+ * @param iso The iso value, densities at or above it are inside the surface.
+ * @param mesh The resulting mesh.
+ */
+void ExtractIsosurface(const unsigned char *data, int width, int height,
+                       int depth, const OccupancyGrid &ranges, float iso,
+                       TriangleMesh *mesh);
+
+/**
+ * @brief WritePly Writes a mesh to a binary (little endian) PLY file, with
+ * vertex normals.
+ * @return Whether the file could be written.
+ */
+bool WritePly(const std::string &filename, const TriangleMesh &mesh);
+
+}  // namespace data_representation
+
+#endif  //  ISOSURFACE_H_
@@ -0,0 +1,175 @@
+#include <light_volume.h>
+
+#include <algorithm>
+
+namespace data_visualization {
+
+LightVolume::LightVolume()
+    : texture_id_(0),
+      slices_{0, 0},
+      framebuffer_(0),
+      vao_(0),
+      size_(0, 0, 0),
+      axes_{1, 0, 0, 0, 1, 0, 0, 0, 1},
+      valid_(false),
+      volume_texture_(0),
+      volume_size_(0, 0, 0),
+      light_(0, 0, 0) {}
+
+LightVolume::~LightVolume() { Release(); }
+
+bool LightVolume::Update(GLuint program, GLuint volume_texture,
+                         const Eigen::Vector3i& volume_size,
+                         GLuint transfer_function_texture,
+                         const std::vector<float>& transfer_function,
+                         const Eigen::Vector3f& light) {
+  if (valid_ && volume_texture == volume_texture_ &&
+      volume_size == volume_size_ && light == light_ &&
+      transfer_function == transfer_function_)
+    return false;
+
+  /* The sweep moves away from the light along its dominant axis, which
+   * becomes the z axis of the light volume */
+  const Eigen::Vector3f kDirection = Eigen::Vector3f::Constant(0.5f) - light;
+  int axis;
+  kDirection.cwiseAbs().maxCoeff(&axis);
+  const int kAxes[3] = {(axis + 1) % 3, (axis + 2) % 3, axis};
+  const bool kForward = kDirection[axis] >= 0.0f;
+
+  const int kFactor = std::max(
+      1, (volume_size.maxCoeff() + kLightVolumeSize - 1) / kLightVolumeSize);
+  Eigen::Vector3i size;
+  Eigen::Vector3f light_position;
+  std::fill(axes_, axes_ + 9, 0.0f);
+  for (int i = 0; i < 3; ++i) {
+    size[i] = (volume_size[kAxes[i]] + kFactor - 1) / kFactor;
+    light_position[i] = light[kAxes[i]];
+    axes_[kAxes[i] * 3 + i] = 1.0f;
+  }
+  if (texture_id_ == 0 || size != size_) Allocate(size);
+
+  GLint viewport[4], framebuffer;
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+  const GLboolean kDepthTest = glIsEnabled(GL_DEPTH_TEST);
+  const GLboolean kBlend = glIsEnabled(GL_BLEND);
+  const GLboolean kCullFace = glIsEnabled(GL_CULL_FACE);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_BLEND);
+  glDisable(GL_CULL_FACE);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glViewport(0, 0, size_.x(), size_.y());
+
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "volume"), 0);
+  glUniform1i(glGetUniformLocation(program, "transfer_function"), 1);
+  glUniform1i(glGetUniformLocation(program, "previous"), 2);
+  glUniformMatrix3fv(glGetUniformLocation(program, "axes"), 1, GL_FALSE,
+                     axes_);
+  glUniform3fv(glGetUniformLocation(program, "light_position"), 1,
+               light_position.data());
+  glUniform1f(glGetUniformLocation(program, "layer_step"),
+              (kForward ? 1.0f : -1.0f) / size_.z());
+  glUniform1f(glGetUniformLocation(program, "samples_per_unit"),
+              volume_size.maxCoeff() / kShadowSampleSpacing);
+  const GLint kLayerLocation = glGetUniformLocation(program, "layer");
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_3D, volume_texture);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_1D, transfer_function_texture);
+
+  /* The light reaches the first slice unattenuated */
+  const GLfloat kOpaque[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         slices_[1], 0);
+  glClearBufferfv(GL_COLOR, 0, kOpaque);
+
+  /* Every slice is rendered into one 2D texture, reading the previous one
+   * from the other, then copied into its layer of the light volume */
+  glActiveTexture(GL_TEXTURE2);
+  glBindVertexArray(vao_);
+  int current = 0;
+  for (int i = 0; i < size_.z(); ++i) {
+    const int kLayer = kForward ? i : size_.z() - 1 - i;
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, slices_[current], 0);
+    glBindTexture(GL_TEXTURE_2D, slices_[1 - current]);
+    glUniform1f(kLayerLocation, (kLayer + 0.5f) / size_.z());
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindTexture(GL_TEXTURE_3D, texture_id_);
+    glCopyTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, kLayer, 0, 0, size_.x(),
+                        size_.y());
+    current = 1 - current;
+  }
+  glBindVertexArray(0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  if (kDepthTest) glEnable(GL_DEPTH_TEST);
+  if (kBlend) glEnable(GL_BLEND);
+  if (kCullFace) glEnable(GL_CULL_FACE);
+
+  valid_ = true;
+  volume_texture_ = volume_texture;
+  volume_size_ = volume_size;
+  transfer_function_ = transfer_function;
+  light_ = light;
+
+  return true;
+}
+
+void LightVolume::Invalidate() { valid_ = false; }
+
+void LightVolume::Release() {
+  if (texture_id_ != 0) glDeleteTextures(1, &texture_id_);
+  if (slices_[0] != 0) glDeleteTextures(2, slices_);
+  if (framebuffer_ != 0) glDeleteFramebuffers(1, &framebuffer_);
+  if (vao_ != 0) glDeleteVertexArrays(1, &vao_);
+  texture_id_ = 0;
+  slices_[0] = slices_[1] = 0;
+  framebuffer_ = 0;
+  vao_ = 0;
+  valid_ = false;
+}
+
+GLuint LightVolume::GetTextureId() const { return texture_id_; }
+
+const GLfloat* LightVolume::GetAxes() const { return axes_; }
+
+void LightVolume::Allocate(const Eigen::Vector3i& size) {
+  Release();
+  size_ = size;
+
+  /* Half floats, the transmittance is multiplied once per slice */
+  glGenTextures(1, &texture_id_);
+  glBindTexture(GL_TEXTURE_3D, texture_id_);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, size.x(), size.y(), size.z(), 0,
+               GL_RED, GL_FLOAT, nullptr);
+
+  /* Light entering through the sides of the volume is not attenuated */
+  const GLfloat kBorder[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  glGenTextures(2, slices_);
+  for (int i = 0; i < 2; ++i) {
+    glBindTexture(GL_TEXTURE_2D, slices_[i]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, kBorder);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, size.x(), size.y(), 0, GL_RED,
+                 GL_FLOAT, nullptr);
+  }
+
+  glGenFramebuffers(1, &framebuffer_);
+  glGenVertexArrays(1, &vao_);
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,113 @@
+#ifndef LIGHT_VOLUME_H_
+#define LIGHT_VOLUME_H_
+
+#include <GL/glew.h>
+
+#include <eigen3/Eigen/Geometry>
+
+#include <vector>
+
+namespace data_visualization {
+
+/**
+ * @brief kLightVolumeSize Voxels along the longest edge of a light volume.
+ */
+const int kLightVolumeSize = 256;
+
+/**
+ * @brief kShadowSampleSpacing Texels of the longest volume edge per opacity
+ * sample of the light rays, the opacity of a slice is corrected to this scale.
+ */
+const float kShadowSampleSpacing = 10.0f;
+
+/**
+ * @brief LightVolume Transmittance from the point light to every voxel of a
+ * volume. It is computed on the GPU by sweeping slice by slice away from the
+ * light along the dominant axis of the light direction, attenuating the light
+ * that reached the previous slice by the opacity of the current one. The
+ * slices are stored along the z axis of the texture, so the texture axes are
+ * a permutation of the volume ones (see GetAxes).
+ */
+class LightVolume {
+ public:
+  /**
+   * @brief LightVolume Constructor of the class.
+   */
+  LightVolume();
+
+  /**
+   * @brief ~LightVolume Destructor of the class. Calls Release.
+   */
+  ~LightVolume();
+
+  LightVolume(const LightVolume&) = delete;
+  LightVolume& operator=(const LightVolume&) = delete;
+
+  /**
+   * @brief Update Sweeps the volume again if the volume, the light or the
+   * transfer function changed since the last sweep, or if Invalidate was
+   * called. Requires the GL context to be current.
+   * @param program The sweep shader program (light_volume.vert/frag).
+   * @param volume_texture The 3D texture of the volume.
+   * @param volume_size Size of the volume, in voxels.
+   * @param transfer_function_texture The 1D transfer function texture.
+   * @param transfer_function The transfer function values, rgbargba...
+   * @param light Light position, in texture coordinates of the volume.
+   * @return Whether the volume was swept.
+   */
+  bool Update(GLuint program, GLuint volume_texture,
+              const Eigen::Vector3i& volume_size,
+              GLuint transfer_function_texture,
+              const std::vector<float>& transfer_function,
+              const Eigen::Vector3f& light);
+
+  /**
+   * @brief Invalidate Forces a sweep on the next Update, e.g. when the
+   * content of the volume texture changed.
+   */
+  void Invalidate();
+
+  /**
+   * @brief Release Deletes the textures and the framebuffer.
+   */
+  void Release();
+
+  /**
+   * @brief GetTextureId Returns the id of the 3D transmittance texture.
+   */
+  GLuint GetTextureId() const;
+
+  /**
+   * @brief GetAxes Returns the permutation matrix that maps volume texture
+   * coordinates to light volume texture coordinates, column major.
+   */
+  const GLfloat* GetAxes() const;
+
+ private:
+  /**
+   * @brief Allocate Creates the textures for a light volume size.
+   */
+  void Allocate(const Eigen::Vector3i& size);
+
+  GLuint texture_id_;
+  GLuint slices_[2];
+  GLuint framebuffer_;
+  GLuint vao_;
+
+  /**
+   * @brief size_ Size of the light volume texture, slices along z.
+   */
+  Eigen::Vector3i size_;
+  GLfloat axes_[9];
+
+  /* Inputs of the last sweep */
+  bool valid_;
+  GLuint volume_texture_;
+  Eigen::Vector3i volume_size_;
+  std::vector<float> transfer_function_;
+  Eigen::Vector3f light_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  LIGHT_VOLUME_H_
@@ -18,6 +18,11 @@ MainWindow::MainWindow(QWidget *parent)
   ui_->setupUi(this);
 
   tf_widget_ = new TFWidget(ui_->glwidget);
+
+  connect(ui_->glwidget, SIGNAL(LoadProgress(int)), this,
+          SLOT(LoadProgress(int)));
+  connect(ui_->glwidget, SIGNAL(LoadFinished(bool)), this,
+          SLOT(LoadFinished(bool)));
 }
 
 MainWindow::~MainWindow() {
@@ -41,11 +46,60 @@ void MainWindow::on_actionLoad_triggered() {
   QString filename = QFileDialog::getExistingDirectory(
       this, "Choose a directory.", ".", QFileDialog::Option::ShowDirsOnly);
   if (!filename.isNull()) {
-    if (!ui_->glwidget->LoadVolume(filename)){
-      QMessageBox::warning(this, tr("Error"), tr("The selected volume could not be opened."));
-    }else{
-        tf_widget_->SetHistogram(ui_->glwidget->GetVolumeHistogram());
+    /* A load in progress is cancelled first */
+    if (progress_dialog_ != nullptr) {
+      progress_dialog_->cancel();
+      ui_->glwidget->CancelLoad();
     }
+
+    /* The dialog is not modal, the volume can be explored while it loads */
+    progress_dialog_ = new QProgressDialog(tr("Loading volume..."),
+                                           tr("Cancel"), 0, 100, this);
+    progress_dialog_->setWindowModality(Qt::NonModal);
+    progress_dialog_->setMinimumDuration(0);
+    connect(progress_dialog_, SIGNAL(canceled()), ui_->glwidget,
+            SLOT(CancelLoad()));
+
+    ui_->glwidget->LoadVolumeAsync(filename);
+  }
+}
+
+void MainWindow::on_actionExportIsosurface_triggered() {
+  QString filename = QFileDialog::getSaveFileName(
+      this, "Export the isosurface.", "isosurface.ply", "PLY meshes (*.ply)");
+  if (!filename.isNull() && !ui_->glwidget->ExportIsosurface(filename)) {
+    QMessageBox::warning(this, tr("Error"),
+                         tr("The isosurface could not be exported, the "
+                            "volume must be fully loaded in core."));
+  }
+}
+
+void MainWindow::on_actionExportProfile_triggered() {
+  QString filename = QFileDialog::getSaveFileName(
+      this, "Export the frame profile.", "profile.csv", "CSV files (*.csv)");
+  if (!filename.isNull() && !ui_->glwidget->ExportProfile(filename)) {
+    QMessageBox::warning(this, tr("Error"),
+                         tr("The profile could not be written."));
+  }
+}
+
+void MainWindow::LoadProgress(int percent) {
+  if (progress_dialog_ != nullptr) progress_dialog_->setValue(percent);
+}
+
+void MainWindow::LoadFinished(bool success) {
+  const bool kCancelled =
+      progress_dialog_ != nullptr && progress_dialog_->wasCanceled();
+  if (progress_dialog_ != nullptr) {
+    progress_dialog_->deleteLater();
+    progress_dialog_ = nullptr;
+  }
+
+  if (success) {
+    tf_widget_->SetHistogram(ui_->glwidget->GetVolumeHistogram());
+    tf_widget_->SetJointHistogram(ui_->glwidget->GetVolumeJointHistogram());
+  } else if (!kCancelled) {
+    QMessageBox::warning(this, tr("Error"), tr("The selected volume could not be opened."));
   }
 }
 
@@ -5,6 +5,7 @@
 
 #include <QMainWindow>
 #include <QCloseEvent>
+#include <QProgressDialog>
 
 #include "TFWidget.hpp"
 
@@ -36,14 +37,43 @@ class MainWindow : public QMainWindow {
    */
   void on_actionLoad_triggered();
 
+  /**
+   * @brief on_actionExportIsosurface_triggered Opens a file dialog to save
+   * the isosurface as a PLY mesh.
+   */
+  void on_actionExportIsosurface_triggered();
+
+  /**
+   * @brief on_actionExportProfile_triggered Opens a file dialog to save the
+   * times of the last frames as a CSV file.
+   */
+  void on_actionExportProfile_triggered();
+
   /**
    * @brief button_transfer_function Opens the transfer function editing tool
    */
   void button_transfer_function();
 
+  /**
+   * @brief LoadProgress Updates the progress dialog of the current load.
+   */
+  void LoadProgress(int percent);
+
+  /**
+   * @brief LoadFinished Closes the progress dialog and updates the histogram,
+   * or reports the error.
+   */
+  void LoadFinished(bool success);
+
 private:
   Ui::MainWindow *ui_;
 
+  /**
+   * @brief progress_dialog_ Progress of the current load, it allows
+   * cancelling it.
+   */
+  QProgressDialog * progress_dialog_ = nullptr;
+
     TFWidget * tf_widget_;
 };
 
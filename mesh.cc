@@ -0,0 +1,54 @@
+#include <mesh.h>
+
+namespace data_representation {
+
+Mesh::Mesh(const TriangleMesh &mesh)
+    : element_count_(mesh.faces.size()),
+      vertex_count_(mesh.vertices.size() / 3) {
+  glGenVertexArrays(1, &vao_id_);
+  glBindVertexArray(vao_id_);
+
+  glGenBuffers(1, &vbo_id_);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_id_);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * mesh.vertices.size(),
+               mesh.vertices.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+  glEnableVertexAttribArray(0);
+
+  glGenBuffers(1, &normals_id_);
+  glBindBuffer(GL_ARRAY_BUFFER, normals_id_);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * mesh.normals.size(),
+               mesh.normals.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+  glEnableVertexAttribArray(1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  glGenBuffers(1, &faces_id_);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, faces_id_);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh.faces.size(),
+               mesh.faces.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+Mesh::~Mesh() {
+  glDeleteBuffers(1, &vbo_id_);
+  glDeleteBuffers(1, &normals_id_);
+  glDeleteVertexArrays(1, &vao_id_);
+  glDeleteBuffers(1, &faces_id_);
+}
+
+void Mesh::Render() {
+  if (element_count_ == 0) return;
+
+  glBindVertexArray(vao_id_);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, faces_id_);
+  glDrawRangeElements(GL_TRIANGLES, 0, vertex_count_ - 1, element_count_,
+                      GL_UNSIGNED_INT, reinterpret_cast<GLvoid *>(0));
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+}
+
+}  // namespace data_representation
@@ -0,0 +1,69 @@
+#ifndef MESH_H_
+#define MESH_H_
+
+#include <GL/glew.h>
+
+#include "./isosurface.h"
+
+namespace data_representation {
+
+/**
+ * @brief Mesh A triangle mesh uploaded for rasterization, positions at
+ * attribute 0 and normals at attribute 1.
+ */
+class Mesh {
+ public:
+  /**
+   * @brief Mesh Constructor of the class. Uploads the mesh, requires the GL
+   * context to be current.
+   */
+  explicit Mesh(const TriangleMesh &mesh);
+
+  /**
+   * @brief ~Mesh Destructor of the class.
+   */
+  ~Mesh();
+
+  Mesh(const Mesh &) = delete;
+  Mesh &operator=(const Mesh &) = delete;
+
+  /**
+   * @brief Render Renders the mesh.
+   */
+  void Render();
+
+ private:
+  /**
+   * @brief element_count_ Number of rendered elements (indices).
+   */
+  int element_count_;
+
+  /**
+   * @brief vertex_count_ Number of vertices.
+   */
+  int vertex_count_;
+
+  /**
+   * @brief vao_id_ Vertex Array id.
+   */
+  GLuint vao_id_;
+
+  /**
+   * @brief vbo_id_ Vertex Buffer Object id, of the positions.
+   */
+  GLuint vbo_id_;
+
+  /**
+   * @brief normals_id_ Vertex Buffer Object id, of the normals.
+   */
+  GLuint normals_id_;
+
+  /**
+   * @brief faces_id_ Face Indices Array id.
+   */
+  GLuint faces_id_;
+};
+
+}  // namespace data_representation
+
+#endif  //  MESH_H_
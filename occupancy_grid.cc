@@ -0,0 +1,207 @@
+#include <occupancy_grid.h>
+
+#include <algorithm>
+
+namespace data_representation {
+
+namespace {
+
+/* Densities of the cell ranges, one per byte value */
+const int kDensityCount = 256;
+
+}  // namespace
+
+OccupancyGrid::OccupancyGrid()
+    : dims_{0, 0, 0},
+      cells_{0, 0, 0},
+      cell_size_(1),
+      texture_id_(0),
+      range_texture_id_(0),
+      ranges_dirty_(true) {}
+
+OccupancyGrid::~OccupancyGrid() { Release(); }
+
+void OccupancyGrid::Init(int width, int height, int depth, int cell_size) {
+  const int kDims[3] = {width, height, depth};
+  for (int i = 0; i < 3; ++i) {
+    dims_[i] = kDims[i];
+    cells_[i] = (kDims[i] + cell_size - 1) / cell_size;
+  }
+  cell_size_ = cell_size;
+
+  /* Empty cells have min > max */
+  min_.assign(GetCellCount(), 255);
+  max_.assign(GetCellCount(), 0);
+  occupied_.assign(GetCellCount(), 0);
+  opaque_.clear();
+  count_.assign(kDensityCount + 1, 0);
+  ranges_dirty_ = true;
+}
+
+void OccupancyGrid::Accumulate(const unsigned char* data, int z, int slices) {
+  const int kRows = slices * dims_[1];
+  ranges_dirty_ = true;
+
+  /* Range of every row within the x extent of every cell */
+  std::vector<unsigned char> row_min(static_cast<size_t>(kRows) * cells_[0]);
+  std::vector<unsigned char> row_max(row_min.size());
+
+#pragma omp parallel for
+  for (int row = 0; row < kRows; ++row) {
+    const unsigned char* line = data + static_cast<size_t>(row) * dims_[0];
+    for (int cx = 0; cx < cells_[0]; ++cx) {
+      const int kBegin = std::max(0, cx * cell_size_ - 1);
+      const int kEnd = std::min(dims_[0], (cx + 1) * cell_size_ + 1);
+      unsigned char lo = 255, hi = 0;
+      for (int x = kBegin; x < kEnd; ++x) {
+        lo = std::min(lo, line[x]);
+        hi = std::max(hi, line[x]);
+      }
+      row_min[static_cast<size_t>(row) * cells_[0] + cx] = lo;
+      row_max[static_cast<size_t>(row) * cells_[0] + cx] = hi;
+    }
+  }
+
+  /* Every thread owns a row of cells, a slice widens the one or two cells
+   * whose extent covers it */
+#pragma omp parallel for
+  for (int cy = 0; cy < cells_[1]; ++cy) {
+    const int kBeginY = std::max(0, cy * cell_size_ - 1);
+    const int kEndY = std::min(dims_[1], (cy + 1) * cell_size_ + 1);
+    for (int s = 0; s < slices; ++s) {
+      const int kZ = z + s;
+      const int kFirstCell = std::max(0, (kZ - 1) / cell_size_);
+      const int kLastCell = std::min(cells_[2] - 1, (kZ + 1) / cell_size_);
+      for (int cz = kFirstCell; cz <= kLastCell; ++cz) {
+        const size_t kCellRow =
+            (static_cast<size_t>(cz) * cells_[1] + cy) * cells_[0];
+        for (int y = kBeginY; y < kEndY; ++y) {
+          const size_t kRow = (static_cast<size_t>(s) * dims_[1] + y) *
+                              cells_[0];
+          for (int cx = 0; cx < cells_[0]; ++cx) {
+            min_[kCellRow + cx] = std::min(min_[kCellRow + cx],
+                                           row_min[kRow + cx]);
+            max_[kCellRow + cx] = std::max(max_[kCellRow + cx],
+                                           row_max[kRow + cx]);
+          }
+        }
+      }
+    }
+  }
+}
+
+void OccupancyGrid::SetCellRange(int cell, unsigned char min,
+                                 unsigned char max) {
+  min_[cell] = min;
+  max_[cell] = max;
+  ranges_dirty_ = true;
+}
+
+bool OccupancyGrid::Classify(const std::vector<float>& transfer_function) {
+  const int kDensities = transfer_function.size() / 4;
+  auto opaque = [&transfer_function](int density) -> char {
+    return transfer_function[4 * density + 3] > kTransparentAlpha;
+  };
+
+  /* Only the cells overlapping the densities that changed are visited, they
+   * are compared in place so that the unchanged frames do not allocate */
+  int first = 0, last = kDensities - 1;
+  if (opaque_.size() == static_cast<size_t>(kDensities)) {
+    while (first < kDensities && opaque(first) == opaque_[first]) ++first;
+    if (first == kDensities) return false;
+    while (opaque(last) == opaque_[last]) --last;
+  } else {
+    /* The counts are sized in Init, for a transfer function per density */
+    opaque_.resize(kDensities);
+    count_.resize(kDensities + 1);
+  }
+  for (int i = first; i <= last; ++i) opaque_[i] = opaque(i);
+
+  /* count_[i] is the number of non transparent densities below i */
+  for (int i = 0; i < kDensities; ++i) count_[i + 1] = count_[i] + opaque_[i];
+
+  const int kCells = GetCellCount();
+#pragma omp parallel for
+  for (int i = 0; i < kCells; ++i) {
+    if (min_[i] > max_[i] || max_[i] < first || min_[i] > last) continue;
+    occupied_[i] = count_[max_[i] + 1] > count_[min_[i]] ? 255 : 0;
+  }
+
+  return true;
+}
+
+bool OccupancyGrid::Update(const std::vector<float>& transfer_function) {
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if (ranges_dirty_ || range_texture_id_ == 0) {
+    std::vector<unsigned char> ranges(2 * min_.size());
+    for (size_t i = 0; i < min_.size(); ++i) {
+      ranges[2 * i] = min_[i];
+      ranges[2 * i + 1] = max_[i];
+    }
+
+    if (range_texture_id_ == 0) glGenTextures(1, &range_texture_id_);
+    glBindTexture(GL_TEXTURE_3D, range_texture_id_);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RG8, cells_[0], cells_[1], cells_[2], 0,
+                 GL_RG, GL_UNSIGNED_BYTE, ranges.data());
+    ranges_dirty_ = false;
+  }
+
+  if (!Classify(transfer_function) && texture_id_ != 0) return false;
+
+  if (texture_id_ == 0) {
+    glGenTextures(1, &texture_id_);
+    glBindTexture(GL_TEXTURE_3D, texture_id_);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, cells_[0], cells_[1], cells_[2], 0,
+                 GL_RED, GL_UNSIGNED_BYTE, occupied_.data());
+  } else {
+    glBindTexture(GL_TEXTURE_3D, texture_id_);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, cells_[0], cells_[1],
+                    cells_[2], GL_RED, GL_UNSIGNED_BYTE, occupied_.data());
+  }
+
+  return true;
+}
+
+void OccupancyGrid::Release() {
+  if (texture_id_ != 0) glDeleteTextures(1, &texture_id_);
+  if (range_texture_id_ != 0) glDeleteTextures(1, &range_texture_id_);
+  texture_id_ = 0;
+  range_texture_id_ = 0;
+}
+
+GLuint OccupancyGrid::GetTextureId() const { return texture_id_; }
+
+GLuint OccupancyGrid::GetRangeTextureId() const { return range_texture_id_; }
+
+int OccupancyGrid::GetCellSize() const { return cell_size_; }
+
+int OccupancyGrid::GetCellCount() const {
+  return cells_[0] * cells_[1] * cells_[2];
+}
+
+const int* OccupancyGrid::GetCells() const { return cells_; }
+
+bool OccupancyGrid::IsOccupied(int cell) const { return occupied_[cell] != 0; }
+
+void OccupancyGrid::GetCellRange(int cell, unsigned char* min,
+                                 unsigned char* max) const {
+  *min = min_[cell];
+  *max = max_[cell];
+}
+
+void OccupancyGrid::GetDensityRange(unsigned char* min,
+                                    unsigned char* max) const {
+  *min = 255;
+  *max = 0;
+  for (size_t i = 0; i < min_.size(); ++i) {
+    if (min_[i] > max_[i]) continue;
+    *min = std::min(*min, min_[i]);
+    *max = std::max(*max, max_[i]);
+  }
+}
+
+}  // namespace data_representation
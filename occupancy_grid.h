@@ -0,0 +1,173 @@
+#ifndef OCCUPANCY_GRID_H_
+#define OCCUPANCY_GRID_H_
+
+#include <GL/glew.h>
+
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief kOccupancyCellSize Voxels per cell edge of the occupancy grid of a
+ * volume stored in a single texture.
+ */
+const int kOccupancyCellSize = 16;
+
+/**
+ * @brief kTransparentAlpha Opacity at or under which a transfer function
+ * entry contributes nothing, the ray marcher skips such samples.
+ */
+const float kTransparentAlpha = 0.001f;
+
+/**
+ * @brief OccupancyGrid Coarse grid holding the density range (min, max) of
+ * every cell of a volume, and whether each cell holds any non transparent
+ * density under the current transfer function. The occupancy is kept in a 3D
+ * texture so that the ray marcher can jump over empty cells, and the ranges in
+ * another one for the projection modes, which do not use the transfer
+ * function.
+ */
+class OccupancyGrid {
+ public:
+  /**
+   * @brief OccupancyGrid Constructor of the class.
+   */
+  OccupancyGrid();
+
+  /**
+   * @brief ~OccupancyGrid Destructor of the class. Calls Release.
+   */
+  ~OccupancyGrid();
+
+  OccupancyGrid(const OccupancyGrid&) = delete;
+  OccupancyGrid& operator=(const OccupancyGrid&) = delete;
+
+  /**
+   * @brief Init Sizes the grid for a volume, with every cell empty.
+   * @param width Volume width.
+   * @param height Volume height.
+   * @param depth Volume depth.
+   * @param cell_size Voxels per cell edge.
+   */
+  void Init(int width, int height, int depth, int cell_size);
+
+  /**
+   * @brief Accumulate Widens the cell ranges with a slab of slices. The range
+   * of a cell also covers the voxels one voxel away from it, so that
+   * trilinear samples taken inside the cell are bounded by it.
+   * @param data The voxels of the slab.
+   * @param z First slice of the slab.
+   * @param slices Number of slices of the slab.
+   */
+  void Accumulate(const unsigned char* data, int z, int slices);
+
+  /**
+   * @brief SetCellRange Sets the range of a cell, e.g. from the ranges of a
+   * brick store.
+   * @param cell Cell index, x + cells_x * (y + cells_y * z).
+   */
+  void SetCellRange(int cell, unsigned char min, unsigned char max);
+
+  /**
+   * @brief Classify Classifies the cells again when the opacity of the
+   * transfer function changed. Only the cells whose range overlaps the
+   * changed densities are visited.
+   * @param transfer_function The transfer function values, rgbargba...
+   * @return Whether the occupancy changed.
+   */
+  bool Classify(const std::vector<float>& transfer_function);
+
+  /**
+   * @brief Update Classifies the cells and uploads the occupancy texture if
+   * it changed, and the range texture if the ranges changed. Requires the GL
+   * context to be current.
+   * @param transfer_function The transfer function values, rgbargba...
+   * @return Whether the occupancy texture changed.
+   */
+  bool Update(const std::vector<float>& transfer_function);
+
+  /**
+   * @brief Release Deletes the textures.
+   */
+  void Release();
+
+  /**
+   * @brief GetTextureId Returns the id of the occupancy texture, 0 until the
+   * first Update.
+   */
+  GLuint GetTextureId() const;
+
+  /**
+   * @brief GetRangeTextureId Returns the id of the range texture, min in red
+   * and max in green, 0 until the first Update.
+   */
+  GLuint GetRangeTextureId() const;
+
+  /**
+   * @brief GetCellSize Returns the voxels per cell edge.
+   */
+  int GetCellSize() const;
+
+  /**
+   * @brief GetCellCount Returns the number of cells.
+   */
+  int GetCellCount() const;
+
+  /**
+   * @brief GetCells Returns the number of cells along every axis.
+   */
+  const int* GetCells() const;
+
+  /**
+   * @brief IsOccupied Whether a cell holds any non transparent density, as of
+   * the last classification.
+   * @param cell Cell index, x + cells_x * (y + cells_y * z).
+   */
+  bool IsOccupied(int cell) const;
+
+  /**
+   * @brief GetCellRange Returns the density range of a cell, min > max if the
+   * cell is empty.
+   * @param cell Cell index, x + cells_x * (y + cells_y * z).
+   */
+  void GetCellRange(int cell, unsigned char* min, unsigned char* max) const;
+
+  /**
+   * @brief GetDensityRange Returns the density range of the whole volume,
+   * scanning the cells.
+   */
+  void GetDensityRange(unsigned char* min, unsigned char* max) const;
+
+ private:
+  int dims_[3];
+  int cells_[3];
+  int cell_size_;
+
+  std::vector<unsigned char> min_;
+  std::vector<unsigned char> max_;
+  std::vector<unsigned char> occupied_;
+
+  /**
+   * @brief opaque_ Whether every density was non transparent at the last
+   * update.
+   */
+  std::vector<char> opaque_;
+
+  /**
+   * @brief count_ Number of non transparent densities below every density,
+   * kept so that classifying does not allocate.
+   */
+  std::vector<int> count_;
+
+  GLuint texture_id_;
+  GLuint range_texture_id_;
+
+  /**
+   * @brief ranges_dirty_ Whether the ranges changed since they were uploaded.
+   */
+  bool ranges_dirty_;
+};
+
+}  // namespace data_representation
+
+#endif  //  OCCUPANCY_GRID_H_
@@ -0,0 +1,100 @@
+#include <offscreen_context.h>
+
+#include <GL/glew.h>
+
+/* Keeps the X11 headers, and their macros, out */
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+
+namespace data_visualization {
+
+namespace {
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+const EGLint kContextAttributes[] = {
+    EGL_CONTEXT_MAJOR_VERSION,
+    3,
+    EGL_CONTEXT_MINOR_VERSION,
+    3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK,
+    EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+    EGL_NONE};
+
+/**
+ * @brief GetDisplay Returns the surfaceless display of Mesa, which needs
+ * neither a window system nor a GPU, or the default display otherwise.
+ */
+EGLDisplay GetDisplay() {
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+  EGLDisplay display = EGL_NO_DISPLAY;
+  if (get_platform_display != nullptr)
+    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+  if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+  return display;
+}
+
+}  // namespace
+
+OffscreenContext::OffscreenContext()
+    : display_(EGL_NO_DISPLAY), context_(EGL_NO_CONTEXT) {}
+
+OffscreenContext::~OffscreenContext() { Release(); }
+
+bool OffscreenContext::Create() {
+  Release();
+
+  display_ = GetDisplay();
+  if (display_ == EGL_NO_DISPLAY ||
+      !eglInitialize(display_, nullptr, nullptr)) {
+    std::cerr << "Could not initialize an EGL display" << std::endl;
+    display_ = EGL_NO_DISPLAY;
+    return false;
+  }
+
+  /* Without surfaces no config is needed (EGL_KHR_no_config_context) */
+  if (!eglBindAPI(EGL_OPENGL_API) ||
+      (context_ = eglCreateContext(display_, nullptr, EGL_NO_CONTEXT,
+                                   kContextAttributes)) == EGL_NO_CONTEXT ||
+      !eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_)) {
+    std::cerr << "Could not create an OpenGL context, EGL error 0x"
+              << std::hex << eglGetError() << std::dec << std::endl;
+    Release();
+    return false;
+  }
+
+  /* GLEW built for GLX loads the GL entry points, and then fails to find the
+   * X display */
+  glewInit();
+  if (!GLEW_VERSION_3_3) {
+    std::cerr << "OpenGL 3.3 is not available" << std::endl;
+    Release();
+    return false;
+  }
+
+  return true;
+}
+
+void OffscreenContext::Release() {
+  if (display_ == EGL_NO_DISPLAY) return;
+
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (context_ != EGL_NO_CONTEXT) eglDestroyContext(display_, context_);
+  eglTerminate(display_);
+
+  display_ = EGL_NO_DISPLAY;
+  context_ = EGL_NO_CONTEXT;
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,47 @@
+#ifndef OFFSCREEN_CONTEXT_H_
+#define OFFSCREEN_CONTEXT_H_
+
+namespace data_visualization {
+
+/**
+ * @brief OffscreenContext An OpenGL context without a window, for the
+ * headless tools. It is created on a surfaceless EGL display, Mesa llvmpipe
+ * on machines without a GPU, so it has no default framebuffer: frames are
+ * rendered into framebuffer objects.
+ */
+class OffscreenContext {
+ public:
+  /**
+   * @brief OffscreenContext Constructor of the class.
+   */
+  OffscreenContext();
+
+  /**
+   * @brief ~OffscreenContext Destructor of the class. Calls Release.
+   */
+  ~OffscreenContext();
+
+  OffscreenContext(const OffscreenContext&) = delete;
+  OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+  /**
+   * @brief Create Creates a compatibility profile context of OpenGL 3.3 or
+   * later, makes it current on the calling thread and initializes GLEW.
+   * @return Whether the context could be created.
+   */
+  bool Create();
+
+  /**
+   * @brief Release Destroys the context.
+   */
+  void Release();
+
+ private:
+  /* EGLDisplay and EGLContext, the EGL headers are kept out of the header */
+  void* display_;
+  void* context_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  OFFSCREEN_CONTEXT_H_
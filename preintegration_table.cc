@@ -0,0 +1,157 @@
+#include <preintegration_table.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace data_visualization {
+
+namespace {
+
+/* Opacities are clamped so that the extinction stays finite */
+const double kMaxOpacity = 0.9999;
+
+}  // namespace
+
+PreintegrationTable::PreintegrationTable()
+    : step_scale_(0.0f),
+      dirty_first_(std::numeric_limits<int>::max()),
+      dirty_last_(-1),
+      texture_id_(0) {}
+
+PreintegrationTable::~PreintegrationTable() { Release(); }
+
+bool PreintegrationTable::Compute(const std::vector<float>& transfer_function,
+                                  float step_scale) {
+  const int kSize = transfer_function.size() / 4;
+
+  /* Only the densities that changed need to be integrated again */
+  int first = 0, last = kSize - 1;
+  if (step_scale == step_scale_ &&
+      transfer_function_.size() == transfer_function.size()) {
+    while (first < kSize &&
+           std::equal(&transfer_function[4 * first],
+                      &transfer_function[4 * first] + 4,
+                      &transfer_function_[4 * first]))
+      ++first;
+    if (first == kSize) return false;
+    while (std::equal(&transfer_function[4 * last],
+                      &transfer_function[4 * last] + 4,
+                      &transfer_function_[4 * last]))
+      --last;
+  }
+
+  table_.resize(4 * kSize * kSize);
+  Build(transfer_function, first, last, step_scale);
+  transfer_function_ = transfer_function;
+  step_scale_ = step_scale;
+  dirty_first_ = std::min(dirty_first_, first);
+  dirty_last_ = std::max(dirty_last_, last);
+
+  return true;
+}
+
+bool PreintegrationTable::Update(const std::vector<float>& transfer_function,
+                                 float step_scale) {
+  /* Compute may have been called on its own since the last upload */
+  Compute(transfer_function, step_scale);
+  if (dirty_first_ > dirty_last_ && texture_id_ != 0) return false;
+
+  const int kSize = transfer_function.size() / 4;
+  if (texture_id_ == 0) {
+    glGenTextures(1, &texture_id_);
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, kSize, kSize, 0, GL_RGBA,
+                 GL_FLOAT, table_.data());
+  } else {
+    /* Only the segments that span a changed density: the rows of the
+     * changed front densities, the back densities past the first changed
+     * one in the rows before, and those up to the last one in the rows
+     * after */
+    const int kFirst = std::max(dirty_first_, 0);
+    const int kLast = std::min(dirty_last_, kSize - 1);
+    const auto kUpload = [this, kSize](int x, int y, int width, int height) {
+      if (width <= 0 || height <= 0) return;
+      glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA,
+                      GL_FLOAT, &table_[4 * (y * kSize + x)]);
+    };
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, kSize);
+    kUpload(0, kFirst, kSize, kLast - kFirst + 1);
+    kUpload(kFirst, 0, kSize - kFirst, kFirst);
+    kUpload(0, kLast + 1, kLast + 1, kSize - kLast - 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  }
+  dirty_first_ = std::numeric_limits<int>::max();
+  dirty_last_ = -1;
+
+  return true;
+}
+
+void PreintegrationTable::Release() {
+  if (texture_id_ != 0) glDeleteTextures(1, &texture_id_);
+  texture_id_ = 0;
+}
+
+GLuint PreintegrationTable::GetTextureId() const { return texture_id_; }
+
+const std::vector<float>& PreintegrationTable::GetTable() const {
+  return table_;
+}
+
+void PreintegrationTable::Build(const std::vector<float>& transfer_function,
+                                int first, int last, float step_scale) {
+  const int kSize = transfer_function.size() / 4;
+
+  /* Extinction of every entry over a one texel step, and the integrals of
+   * the extinction and of the extinction weighted color from density 0,
+   * trapezoidal between entries */
+  std::vector<double> extinction(kSize);
+  for (int i = 0; i < kSize; ++i)
+    extinction[i] = -std::log(
+        1.0 - std::min<double>(transfer_function[4 * i + 3], kMaxOpacity));
+
+  std::vector<double> extinction_sum(kSize, 0.0);
+  std::vector<double> color_sum(3 * kSize, 0.0);
+  for (int i = 1; i < kSize; ++i) {
+    extinction_sum[i] =
+        extinction_sum[i - 1] + 0.5 * (extinction[i - 1] + extinction[i]);
+    for (int c = 0; c < 3; ++c)
+      color_sum[3 * i + c] =
+          color_sum[3 * (i - 1) + c] +
+          0.5 * (transfer_function[4 * (i - 1) + c] * extinction[i - 1] +
+                 transfer_function[4 * i + c] * extinction[i]);
+  }
+
+#pragma omp parallel for schedule(dynamic, 8)
+  for (int front = 0; front < kSize; ++front) {
+    for (int back = 0; back < kSize; ++back) {
+      const int kLow = std::min(front, back);
+      const int kHigh = std::max(front, back);
+      if (kLow > last || kHigh < first) continue;
+
+      float* entry = &table_[4 * (front * kSize + back)];
+      if (kLow == kHigh) {
+        std::copy(&transfer_function[4 * kLow],
+                  &transfer_function[4 * kLow] + 3, entry);
+        entry[3] = 1.0 - std::exp(-extinction[kLow] * step_scale);
+        continue;
+      }
+
+      const double kExtinction = extinction_sum[kHigh] - extinction_sum[kLow];
+      for (int c = 0; c < 3; ++c)
+        entry[c] = kExtinction > 0.0
+                       ? (color_sum[3 * kHigh + c] - color_sum[3 * kLow + c]) /
+                             kExtinction
+                       : 0.0;
+      entry[3] =
+          1.0 - std::exp(-kExtinction / (kHigh - kLow) * step_scale);
+    }
+  }
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,96 @@
+#ifndef PREINTEGRATION_TABLE_H_
+#define PREINTEGRATION_TABLE_H_
+
+#include <GL/glew.h>
+
+#include <vector>
+
+namespace data_visualization {
+
+/**
+ * @brief PreintegrationTable Color and opacity of a ray segment between two
+ * samples, for every pair of front and back densities, so that sharp
+ * transfer functions can be rendered with larger steps. The transfer function
+ * is interpolated linearly along the segment, and the color is weighted by
+ * the extinction (without self attenuation within the segment).
+ */
+class PreintegrationTable {
+ public:
+  /**
+   * @brief PreintegrationTable Constructor of the class.
+   */
+  PreintegrationTable();
+
+  /**
+   * @brief ~PreintegrationTable Destructor of the class. Calls Release.
+   */
+  ~PreintegrationTable();
+
+  PreintegrationTable(const PreintegrationTable&) = delete;
+  PreintegrationTable& operator=(const PreintegrationTable&) = delete;
+
+  /**
+   * @brief Compute Rebuilds the entries whose segment spans a density of the
+   * transfer function that changed since the last call, or every entry if
+   * the step changed.
+   * @param transfer_function The transfer function values, rgbargba...
+   * @param step_scale Step length, in steps of one texel of the longest
+   * volume edge.
+   * @return Whether the table changed.
+   */
+  bool Compute(const std::vector<float>& transfer_function, float step_scale);
+
+  /**
+   * @brief Update Computes the table and uploads the entries that changed.
+   * Requires the GL context to be current.
+   * @param transfer_function The transfer function values, rgbargba...
+   * @param step_scale Step length, in steps of one texel of the longest
+   * volume edge.
+   * @return Whether the table changed.
+   */
+  bool Update(const std::vector<float>& transfer_function, float step_scale);
+
+  /**
+   * @brief Release Deletes the texture.
+   */
+  void Release();
+
+  /**
+   * @brief GetTextureId Returns the id of the 2D table texture, indexed by
+   * back density along s and front density along t.
+   */
+  GLuint GetTextureId() const;
+
+  /**
+   * @brief GetTable Returns the entries rgba, rows by front density.
+   */
+  const std::vector<float>& GetTable() const;
+
+ private:
+  /**
+   * @brief Build Computes the entries whose segment overlaps the densities
+   * [first, last].
+   */
+  void Build(const std::vector<float>& transfer_function, int first,
+             int last, float step_scale);
+
+  /**
+   * @brief table_ Entries rgba, rows by front density.
+   */
+  std::vector<float> table_;
+
+  /* Inputs of the last build */
+  std::vector<float> transfer_function_;
+  float step_scale_;
+
+  /* Densities whose entries changed since the last upload, none if first is
+   * past last */
+  int dirty_first_;
+  int dirty_last_;
+
+  GLuint texture_id_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  PREINTEGRATION_TABLE_H_
@@ -0,0 +1,159 @@
+#include <raycast_program.h>
+
+namespace data_visualization {
+
+const std::vector<std::string> kRaycastFeatures = {
+    "PHONG",      "SHADOWS", "PREINTEGRATED",     "PRECOMPUTED_GRADIENTS",
+    "SKIP_EMPTY", "BRICKED", "MAXIMUM_INTENSITY", "MINIMUM_INTENSITY",
+    "AVERAGE_INTENSITY", "TRANSFER_FUNCTION_2D", "PRECLASSIFIED",
+    "JITTERED", "REPROJECTED"};
+
+const ProgramInterface kRaycastInterface = {
+    {"volume_size", "occupancy_cell_size", "volume_range", "light_axes",
+     "jitter", "reprojection_parity"},
+    {{"volume", 0},
+     {"transfer_function", 1},
+     {"brick_atlas", 2},
+     {"page_table", 3},
+     {"occupancy", 4},
+     {"gradients", 5},
+     {"light_volume", 6},
+     {"preintegration_table", 7},
+     {"cell_ranges", 8},
+     {"transfer_function_2d", 9},
+     {"classified_volume", 10},
+     {"reprojected_color", 11},
+     {"reprojected_depth", 12}},
+    {"Frame"}};
+
+unsigned int GetRaycastVariant(const RaycastOptions &options) {
+  unsigned int variant = options.jittered ? kJitteredFeature : 0;
+  if (options.bricked) variant |= kBrickedFeature;
+  if (options.skip_empty) variant |= kSkipEmptyFeature;
+  if (options.precomputed_gradients) variant |= kPrecomputedGradientsFeature;
+
+  /* The shading options only apply to the compositing */
+  switch (options.mode) {
+    case kMaximumIntensity:
+      return variant | kMaximumIntensityFeature;
+    case kMinimumIntensity:
+      return variant | kMinimumIntensityFeature;
+    case kAverageIntensity:
+      return variant | kAverageIntensityFeature;
+    case kComposite:
+      break;
+  }
+  /* The pre-classified volume replaces the transfer functions, and bakes the
+   * view independent part of the Phong shading. Bricked volumes are
+   * classified per sample, their texture is not complete */
+  if (options.preclassified && !options.bricked) {
+    variant |= kPreclassifiedFeature;
+    if (options.shadows) variant |= kShadowsFeature;
+    return variant;
+  }
+
+  if (options.phong) variant |= kPhongFeature;
+
+  /* The 2D transfer function looks up the gradients, and replaces the
+   * pre-integration and the shadows, which classify by density alone */
+  if (options.transfer_function_2d && options.precomputed_gradients)
+    return variant | kTransferFunction2DFeature;
+
+  if (options.shadows) variant |= kShadowsFeature;
+  if (options.preintegrated) variant |= kPreintegratedFeature;
+  return variant;
+}
+
+void RenderRaycast(const ShaderVariants::Program &program,
+                   unsigned int variant, const RaycastInputs &inputs,
+                   data_representation::Cube *cube) {
+  /* The samplers were set at link time, to their texture units */
+  glUseProgram(program.id);
+
+  /* The jittered passes are blended into the average instead, and the
+   * reprojected frames keep the age of the pixels in alpha */
+  const bool kBlend = !(variant & (kJitteredFeature | kReprojectedFeature));
+  if (kBlend) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  }
+  if (variant & kJitteredFeature)
+    glUniform1f(program.uniforms[kJitterUniform], inputs.jitter);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_3D, inputs.volume);
+  glUniform3f(program.uniforms[kVolumeSizeUniform], inputs.volume_size.x(),
+              inputs.volume_size.y(), inputs.volume_size.z());
+
+  /* Set transfer function */
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_1D, inputs.transfer_function);
+
+  if (variant & kBrickedFeature) {
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, inputs.brick_atlas);
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_3D, inputs.page_table);
+  }
+
+  if (variant & kSkipEmptyFeature) {
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_3D, inputs.occupancy->GetTextureId());
+    glUniform1f(program.uniforms[kOccupancyCellSizeUniform],
+                inputs.occupancy->GetCellSize());
+
+    /* The projections skip the cells by their range instead */
+    if (variant & (kMaximumIntensityFeature | kMinimumIntensityFeature |
+                   kAverageIntensityFeature)) {
+      unsigned char min, max;
+      inputs.occupancy->GetDensityRange(&min, &max);
+      glActiveTexture(GL_TEXTURE8);
+      glBindTexture(GL_TEXTURE_3D, inputs.occupancy->GetRangeTextureId());
+      glUniform2f(program.uniforms[kVolumeRangeUniform], min / 255.0f,
+                  max / 255.0f);
+    }
+  }
+
+  if (variant & kPrecomputedGradientsFeature) {
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_3D, inputs.gradients);
+  }
+
+  if (variant & kShadowsFeature) {
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_3D, inputs.light_volume);
+    glUniformMatrix3fv(program.uniforms[kLightAxesUniform], 1, GL_FALSE,
+                       inputs.light_axes);
+  }
+
+  if (variant & kPreintegratedFeature) {
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_2D, inputs.preintegration_table);
+  }
+
+  if (variant & kTransferFunction2DFeature) {
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_2D, inputs.transfer_function_2d);
+  }
+
+  if (variant & kPreclassifiedFeature) {
+    glActiveTexture(GL_TEXTURE10);
+    glBindTexture(GL_TEXTURE_3D, inputs.classified_volume);
+  }
+
+  if (variant & kReprojectedFeature) {
+    glActiveTexture(GL_TEXTURE11);
+    glBindTexture(GL_TEXTURE_2D, inputs.reprojected_color);
+    glActiveTexture(GL_TEXTURE12);
+    glBindTexture(GL_TEXTURE_2D, inputs.reprojected_depth);
+    glUniform1i(program.uniforms[kReprojectionParityUniform],
+                inputs.reprojection_parity);
+  }
+
+  cube->Render();
+
+  if (kBlend) glDisable(GL_BLEND);
+}
+
+}  // namespace data_visualization
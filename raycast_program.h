@@ -0,0 +1,153 @@
+#ifndef RAYCAST_PROGRAM_H_
+#define RAYCAST_PROGRAM_H_
+
+#include <GL/glew.h>
+
+#include <eigen3/Eigen/Geometry>
+
+#include <string>
+#include <vector>
+
+#include "./cpu_raycaster.h"
+#include "./cube.h"
+#include "./occupancy_grid.h"
+#include "./shader_variants.h"
+
+namespace data_visualization {
+
+/**
+ * @brief kRaycastFeatures Features of the ray casting shader, bit i #defines
+ * kRaycastFeatures[i].
+ */
+extern const std::vector<std::string> kRaycastFeatures;
+
+enum RaycastFeature : unsigned int {
+  kPhongFeature = 1 << 0,
+  kShadowsFeature = 1 << 1,
+  kPreintegratedFeature = 1 << 2,
+  kPrecomputedGradientsFeature = 1 << 3,
+  kSkipEmptyFeature = 1 << 4,
+  kBrickedFeature = 1 << 5,
+  kMaximumIntensityFeature = 1 << 6,
+  kMinimumIntensityFeature = 1 << 7,
+  kAverageIntensityFeature = 1 << 8,
+  kTransferFunction2DFeature = 1 << 9,
+  kPreclassifiedFeature = 1 << 10,
+  kJitteredFeature = 1 << 11,
+  kReprojectedFeature = 1 << 12
+};
+
+/**
+ * @brief kRaycastInterface Uniforms of the ray casting programs, located once
+ * per link in the order of RaycastUniform, and their texture units.
+ */
+extern const ProgramInterface kRaycastInterface;
+
+enum RaycastUniform {
+  kVolumeSizeUniform,
+  kOccupancyCellSizeUniform,
+  kVolumeRangeUniform,
+  kLightAxesUniform,
+  kJitterUniform,
+  kReprojectionParityUniform
+};
+
+/**
+ * @brief kFrameBinding The Frame uniform block of the shaders (see
+ * FrameBlock) is bound to the first binding point, as the first block of the
+ * interfaces.
+ */
+const GLuint kFrameBinding = 0;
+
+/**
+ * @brief FrameBlock The Frame uniform block of the shaders, in the std140
+ * layout.
+ */
+struct FrameBlock {
+  GLfloat projection[16];
+  GLfloat view[16];
+  GLfloat model[16];
+  GLfloat light_position[3];
+  GLfloat padding;
+  GLfloat light_color[3];
+  GLfloat step_scale;
+};
+static_assert(sizeof(FrameBlock) == 224, "FrameBlock must match std140");
+
+/**
+ * @brief RaycastOptions The options of a frame, and what the volume
+ * provides, that select the variant of the ray casting program.
+ */
+struct RaycastOptions {
+  RenderMode mode = kComposite;
+  bool phong = false;
+  bool shadows = false;
+  bool preintegrated = false;
+  bool transfer_function_2d = false;
+  /* Only for volumes whose texture is complete, not while loading */
+  bool preclassified = false;
+  bool jittered = false;
+
+  bool bricked = false;
+  bool skip_empty = false;
+  bool precomputed_gradients = false;
+};
+
+/**
+ * @brief GetRaycastVariant Returns the features of the ray casting program
+ * for a set of options, those that apply to the render mode.
+ */
+unsigned int GetRaycastVariant(const RaycastOptions &options);
+
+/**
+ * @brief RaycastInputs The textures and values the ray casting programs read,
+ * only those of the features of the variant are bound.
+ */
+struct RaycastInputs {
+  GLuint volume = 0;
+  Eigen::Vector3i volume_size = Eigen::Vector3i::Zero();
+  GLuint transfer_function = 0;
+
+  /* kBrickedFeature */
+  GLuint brick_atlas = 0;
+  GLuint page_table = 0;
+
+  /* kSkipEmptyFeature, classified for the current transfer function */
+  const data_representation::OccupancyGrid *occupancy = nullptr;
+
+  /* kPrecomputedGradientsFeature */
+  GLuint gradients = 0;
+
+  /* kShadowsFeature */
+  GLuint light_volume = 0;
+  const GLfloat *light_axes = nullptr;
+
+  GLuint preintegration_table = 0;
+  GLuint transfer_function_2d = 0;
+  GLuint classified_volume = 0;
+
+  /* kJitteredFeature, the offset of the samples along the step in [0, 1) */
+  float jitter = 0.0f;
+
+  /* kReprojectedFeature */
+  GLuint reprojected_color = 0;
+  GLuint reprojected_depth = 0;
+  int reprojection_parity = 0;
+};
+
+/**
+ * @brief RenderRaycast Ray casts a volume with a variant of the ray casting
+ * program: binds the inputs of its features to their texture units, sets its
+ * uniforms and rasterizes the bounding cube, blended over the framebuffer
+ * unless the variant is jittered or reprojected. The Frame block must be
+ * bound, and the tables and volumes of the inputs up to date.
+ * @param program The variant, as returned by ShaderVariants::Get.
+ * @param variant Its features.
+ */
+void RenderRaycast(const ShaderVariants::Program &program,
+                   unsigned int variant, const RaycastInputs &inputs,
+                   data_representation::Cube *cube);
+
+}  // namespace data_visualization
+
+#endif  //  RAYCAST_PROGRAM_H_
@@ -0,0 +1,73 @@
+#include <render_target.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace data_visualization {
+
+RenderTarget::RenderTarget()
+    : framebuffer_(0),
+      color_(0),
+      depth_(0),
+      width_(0),
+      height_(0),
+      scaled_width_(0),
+      scaled_height_(0) {}
+
+RenderTarget::~RenderTarget() { Release(); }
+
+void RenderTarget::Resize(int width, int height) {
+  if (framebuffer_ != 0 && width == width_ && height == height_) return;
+
+  Release();
+  width_ = width;
+  height_ = height;
+
+  glGenRenderbuffers(1, &color_);
+  glBindRenderbuffer(GL_RENDERBUFFER, color_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+  glGenRenderbuffers(1, &depth_);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width_,
+                        height_);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &framebuffer_);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, color_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::Bind(float scale) {
+  scaled_width_ = std::max(static_cast<int>(std::lround(width_ * scale)), 1);
+  scaled_height_ =
+      std::max(static_cast<int>(std::lround(height_ * scale)), 1);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glViewport(0, 0, scaled_width_, scaled_height_);
+  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void RenderTarget::Display() {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glBlitFramebuffer(0, 0, scaled_width_, scaled_height_, 0, 0, width_,
+                    height_, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, width_, height_);
+}
+
+void RenderTarget::Release() {
+  if (framebuffer_ != 0) glDeleteFramebuffers(1, &framebuffer_);
+  if (color_ != 0) glDeleteRenderbuffers(1, &color_);
+  if (depth_ != 0) glDeleteRenderbuffers(1, &depth_);
+  framebuffer_ = 0;
+  color_ = 0;
+  depth_ = 0;
+}
+
+}  // namespace data_visualization
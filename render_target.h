@@ -0,0 +1,69 @@
+#ifndef RENDER_TARGET_H_
+#define RENDER_TARGET_H_
+
+#include <GL/glew.h>
+
+namespace data_visualization {
+
+/**
+ * @brief RenderTarget A framebuffer the size of the viewport, with color and
+ * depth, that frames are rendered into at a lower resolution. Only a corner
+ * of it is used then, so changing the resolution does not allocate, and that
+ * corner is upsampled to the default framebuffer.
+ */
+class RenderTarget {
+ public:
+  /**
+   * @brief RenderTarget Constructor of the class.
+   */
+  RenderTarget();
+
+  /**
+   * @brief ~RenderTarget Destructor of the class. Calls Release.
+   */
+  ~RenderTarget();
+
+  RenderTarget(const RenderTarget&) = delete;
+  RenderTarget& operator=(const RenderTarget&) = delete;
+
+  /**
+   * @brief Resize Allocates the framebuffer for a viewport size, if it
+   * changed. Requires the GL context to be current.
+   */
+  void Resize(int width, int height);
+
+  /**
+   * @brief Bind Binds the framebuffer, with the viewport on its lower left
+   * corner scaled by a factor, and clears it to white.
+   * @param scale The scale of the viewport, in (0, 1].
+   */
+  void Bind(float scale);
+
+  /**
+   * @brief Display Upsamples the corner rendered to the default framebuffer,
+   * with linear filtering, and binds it with the full viewport.
+   */
+  void Display();
+
+  /**
+   * @brief Release Deletes the framebuffer and its attachments.
+   */
+  void Release();
+
+ private:
+  GLuint framebuffer_;
+  GLuint color_;
+  GLuint depth_;
+  int width_;
+  int height_;
+
+  /**
+   * @brief scaled_width_ scaled_height_ Size of the corner rendered.
+   */
+  int scaled_width_;
+  int scaled_height_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  RENDER_TARGET_H_
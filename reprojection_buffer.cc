@@ -0,0 +1,112 @@
+#include <reprojection_buffer.h>
+
+#include <initializer_list>
+
+namespace data_visualization {
+
+ReprojectionBuffer::ReprojectionBuffer()
+    : display_framebuffer_(0), width_(0), height_(0) {}
+
+ReprojectionBuffer::~ReprojectionBuffer() { Release(); }
+
+bool ReprojectionBuffer::Resize(int width, int height) {
+  if (frame_.framebuffer != 0 && width == width_ && height == height_)
+    return false;
+
+  Release();
+  width_ = width;
+  height_ = height;
+  Allocate(&frame_);
+  Allocate(&reprojected_);
+  return true;
+}
+
+void ReprojectionBuffer::Allocate(Target* target) {
+  /* Fetched per pixel, never filtered */
+  glGenTextures(1, &target->color);
+  glBindTexture(GL_TEXTURE_2D, target->color);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, nullptr);
+
+  glGenTextures(1, &target->depth);
+  glBindTexture(GL_TEXTURE_2D, target->depth);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width_, height_, 0,
+               GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenFramebuffers(1, &target->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         target->color, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         target->depth, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ReprojectionBuffer::Reproject(bool valid) {
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &display_framebuffer_);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, reprojected_.framebuffer);
+  glViewport(0, 0, width_, height_);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  if (valid) {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, frame_.color);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, frame_.depth);
+    glDrawArrays(GL_POINTS, 0, width_ * height_);
+
+    /* The frame is rendered to next, not sampled */
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+}
+
+void ReprojectionBuffer::Bind() {
+  /* White where nothing is ray cast, and no age to reproject */
+  glBindFramebuffer(GL_FRAMEBUFFER, frame_.framebuffer);
+  glViewport(0, 0, width_, height_);
+  glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void ReprojectionBuffer::Display() {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, frame_.framebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, display_framebuffer_);
+  glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_,
+                    GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, display_framebuffer_);
+
+  /* Opaque, the ages are not displayed */
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_TRUE);
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void ReprojectionBuffer::Release() {
+  for (Target* target : {&frame_, &reprojected_}) {
+    if (target->framebuffer != 0)
+      glDeleteFramebuffers(1, &target->framebuffer);
+    if (target->color != 0) glDeleteTextures(1, &target->color);
+    if (target->depth != 0) glDeleteTextures(1, &target->depth);
+    *target = Target();
+  }
+}
+
+GLuint ReprojectionBuffer::GetReprojectedColorId() const {
+  return reprojected_.color;
+}
+
+GLuint ReprojectionBuffer::GetReprojectedDepthId() const {
+  return reprojected_.depth;
+}
+
+}  // namespace data_visualization
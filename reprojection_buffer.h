@@ -0,0 +1,104 @@
+#ifndef REPROJECTION_BUFFER_H_
+#define REPROJECTION_BUFFER_H_
+
+#include <GL/glew.h>
+
+namespace data_visualization {
+
+/**
+ * @brief ReprojectionBuffer The frames of the reprojection mode, and the
+ * previous one reprojected into the view of the next. A frame is rendered
+ * into it with its color, composited over the background, and the frames
+ * since the pixel was ray cast in alpha, and with the depth of a point that
+ * stands for every ray. Before the next frame every pixel of it is drawn as
+ * a point where the new view sees its depth, the nearest one kept by the
+ * depth test. The pixels that no point lands on (disoccluded, or too old)
+ * are ray cast again.
+ */
+class ReprojectionBuffer {
+ public:
+  /**
+   * @brief ReprojectionBuffer Constructor of the class.
+   */
+  ReprojectionBuffer();
+
+  /**
+   * @brief ~ReprojectionBuffer Destructor of the class. Calls Release.
+   */
+  ~ReprojectionBuffer();
+
+  ReprojectionBuffer(const ReprojectionBuffer&) = delete;
+  ReprojectionBuffer& operator=(const ReprojectionBuffer&) = delete;
+
+  /**
+   * @brief Resize Allocates the framebuffers for a viewport size, if it
+   * changed. Requires the GL context to be current.
+   * @return Whether they were allocated, the previous frame is lost then.
+   */
+  bool Resize(int width, int height);
+
+  /**
+   * @brief Reproject Draws the previous frame into the reprojected one, with
+   * the program in use and the vertex array bound, which draw a point per
+   * pixel from the vertex id. Its color and depth are bound to the texture
+   * units 0 and 1. The framebuffer bound before is the one Display copies
+   * to.
+   * @param valid Whether the previous frame can be reused, the reprojected
+   * frame is only cleared otherwise.
+   */
+  void Reproject(bool valid);
+
+  /**
+   * @brief Bind Binds the framebuffer of the frame, with its viewport, and
+   * clears it. Called after Reproject.
+   */
+  void Bind();
+
+  /**
+   * @brief Display Copies the color of the frame to the framebuffer bound
+   * before Reproject, and binds it.
+   */
+  void Display();
+
+  /**
+   * @brief Release Deletes the framebuffers and their textures.
+   */
+  void Release();
+
+  /**
+   * @brief GetReprojectedColorId GetReprojectedDepthId Return the textures
+   * of the reprojected frame, read by the ray casting.
+   */
+  GLuint GetReprojectedColorId() const;
+  GLuint GetReprojectedDepthId() const;
+
+ private:
+  /**
+   * @brief Target A framebuffer with a color and a depth texture.
+   */
+  struct Target {
+    GLuint framebuffer = 0;
+    GLuint color = 0;
+    GLuint depth = 0;
+  };
+
+  /**
+   * @brief Allocate Creates a target of the current size.
+   */
+  void Allocate(Target* target);
+
+  /**
+   * @brief frame_ reprojected_ The frame rendered, read by the next one, and
+   * the previous frame reprojected.
+   */
+  Target frame_;
+  Target reprojected_;
+
+  GLint display_framebuffer_;
+  int width_;
+  int height_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  REPROJECTION_BUFFER_H_
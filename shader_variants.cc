@@ -0,0 +1,296 @@
+#include <shader_variants.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "./volume_io.h"
+
+namespace data_visualization {
+
+namespace {
+
+bool ReadFile(const std::string& filename, std::string* source) {
+  std::ifstream infile(filename.c_str());
+  if (!infile.is_open() || !infile.good()) {
+    std::cerr << "Error " + filename + " not found." << std::endl;
+    return false;
+  }
+
+  std::stringstream stream;
+  stream << infile.rdbuf();
+  *source = stream.str();
+  return true;
+}
+
+/* FNV-1a of the sources and of the driver, whose binaries are not portable */
+uint64_t ProgramKey(const std::string& vertex_source,
+                    const std::string& fragment_source) {
+  uint64_t key = 14695981039346656037ULL;
+  auto hash = [&key](const char* bytes) {
+    for (; bytes != nullptr && *bytes != '\0'; ++bytes) {
+      key ^= static_cast<unsigned char>(*bytes);
+      key *= 1099511628211ULL;
+    }
+    /* Separator, so that the strings cannot be shifted between fields */
+    key ^= 0xff;
+    key *= 1099511628211ULL;
+  };
+
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    hash(reinterpret_cast<const char*>(glGetString(name)));
+  hash(vertex_source.c_str());
+  hash(fragment_source.c_str());
+  return key;
+}
+
+std::string ProgramCacheFilename(uint64_t key) {
+  std::stringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << key << ".prog";
+  return (boost::filesystem::path(data_representation::CacheDirectory()) /
+          name.str())
+      .string();
+}
+
+/**
+ * @brief ReadProgramBinary Creates a program from a cached binary.
+ * @return The linked program, 0 if there is no usable binary.
+ */
+GLuint ReadProgramBinary(uint64_t key) {
+  if (!GLEW_ARB_get_program_binary) return 0;
+
+  std::ifstream file(ProgramCacheFilename(key).c_str(), std::ios::binary);
+  if (!file.is_open()) return 0;
+
+  GLenum format;
+  if (!file.read(reinterpret_cast<char*>(&format), sizeof(format))) return 0;
+  const std::string kBinary((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  if (kBinary.empty()) return 0;
+
+  /* The driver rejects the binaries of other versions */
+  const GLuint kProgram = glCreateProgram();
+  glProgramBinary(kProgram, format, kBinary.data(), kBinary.size());
+  GLint linked = GL_FALSE;
+  glGetProgramiv(kProgram, GL_LINK_STATUS, &linked);
+  if (linked != GL_TRUE) {
+    glDeleteProgram(kProgram);
+    return 0;
+  }
+  return kProgram;
+}
+
+void WriteProgramBinary(GLuint program, uint64_t key) {
+  if (!GLEW_ARB_get_program_binary) return;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) return;
+
+  std::vector<char> binary(length);
+  GLenum format;
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  std::ofstream file(ProgramCacheFilename(key).c_str(), std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+  file.write(binary.data(), binary.size());
+  if (!file.good())
+    std::cerr << "Could not write the program cache "
+              << ProgramCacheFilename(key) << std::endl;
+}
+
+GLuint CompileShader(GLenum type, const std::string& source) {
+  const GLuint kShader = glCreateShader(type);
+  const char* kSource = source.c_str();
+  glShaderSource(kShader, 1, &kSource, nullptr);
+  glCompileShader(kShader);
+  return kShader;
+}
+
+void PrintLinkLog(GLuint program) {
+  GLuint shaders[2];
+  GLsizei count = 0;
+  glGetAttachedShaders(program, 2, &count, shaders);
+  for (GLsizei i = 0; i <= count; ++i) {
+    const bool kProgram = i == count;
+    GLint length = 0;
+    if (kProgram)
+      glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    else
+      glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &length);
+    if (length <= 1) continue;
+
+    std::vector<char> log(length);
+    if (kProgram)
+      glGetProgramInfoLog(program, length, nullptr, log.data());
+    else
+      glGetShaderInfoLog(shaders[i], length, nullptr, log.data());
+    std::cerr << log.data() << std::endl;
+  }
+}
+
+}  // namespace
+
+ShaderVariants::ShaderVariants(const std::string& vertex_file,
+                               const std::string& fragment_file,
+                               const std::vector<std::string>& features,
+                               const ProgramInterface& interface)
+    : vertex_file_(vertex_file),
+      fragment_file_(fragment_file),
+      features_(features),
+      interface_(interface) {}
+
+ShaderVariants::~ShaderVariants() { Release(); }
+
+bool ShaderVariants::Load() {
+  std::string vertex_source, fragment_source;
+  if (!ReadFile(vertex_file_, &vertex_source) ||
+      !ReadFile(fragment_file_, &fragment_source))
+    return false;
+
+  vertex_source_ = vertex_source;
+  fragment_source_ = fragment_source;
+  return true;
+}
+
+bool ShaderVariants::Reload() {
+  if (!Load()) return false;
+
+  for (auto& variant : variants_) {
+    if (variant.second.pending != 0) glDeleteProgram(variant.second.pending);
+    variant.second.pending = 0;
+    variant.second.failed = false;
+    StartLink(variant.first, &variant.second);
+  }
+  return true;
+}
+
+const ShaderVariants::Program& ShaderVariants::Get(unsigned int variant) {
+  Variant& state = variants_[variant];
+  if (state.program.id == 0 && !state.failed) {
+    if (state.pending == 0) StartLink(variant, &state);
+    FinishLink(variant, &state);
+  }
+  return state.program;
+}
+
+bool ShaderVariants::Poll() {
+  bool changed = false;
+  for (auto& variant : variants_) {
+    Variant& state = variant.second;
+    if (state.pending == 0) continue;
+
+    /* Without parallel compilation the link already blocked */
+    GLint complete = GL_TRUE;
+    if (GLEW_ARB_parallel_shader_compile)
+      glGetProgramiv(state.pending, GL_COMPLETION_STATUS_ARB, &complete);
+    if (complete == GL_TRUE) changed |= FinishLink(variant.first, &state);
+  }
+  return changed;
+}
+
+bool ShaderVariants::IsPending() const {
+  for (const auto& variant : variants_)
+    if (variant.second.pending != 0) return true;
+  return false;
+}
+
+void ShaderVariants::Release() {
+  for (auto& variant : variants_) {
+    if (variant.second.program.id != 0)
+      glDeleteProgram(variant.second.program.id);
+    if (variant.second.pending != 0) glDeleteProgram(variant.second.pending);
+  }
+  variants_.clear();
+}
+
+void ShaderVariants::StartLink(unsigned int variant, Variant* state) {
+  const std::string kVertexSource = Source(vertex_source_, variant);
+  const std::string kFragmentSource = Source(fragment_source_, variant);
+  const uint64_t kKey = ProgramKey(kVertexSource, kFragmentSource);
+
+  state->pending = ReadProgramBinary(kKey);
+  state->pending_key = 0;
+  if (state->pending != 0) return;
+
+  /* The compile and link calls return at once when the driver compiles in
+   * parallel, the status queries block */
+  const GLuint kVertex = CompileShader(GL_VERTEX_SHADER, kVertexSource);
+  const GLuint kFragment = CompileShader(GL_FRAGMENT_SHADER, kFragmentSource);
+  state->pending = glCreateProgram();
+  glAttachShader(state->pending, kVertex);
+  glAttachShader(state->pending, kFragment);
+  if (GLEW_ARB_get_program_binary)
+    glProgramParameteri(state->pending, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  glLinkProgram(state->pending);
+
+  /* Deleted along with the program */
+  glDeleteShader(kVertex);
+  glDeleteShader(kFragment);
+  state->pending_key = kKey;
+}
+
+bool ShaderVariants::FinishLink(unsigned int variant, Variant* state) {
+  const GLuint kProgram = state->pending;
+  state->pending = 0;
+
+  GLint linked = GL_FALSE;
+  glGetProgramiv(kProgram, GL_LINK_STATUS, &linked);
+  if (linked != GL_TRUE) {
+    std::cerr << "Could not link " << vertex_file_ << " and "
+              << fragment_file_ << " (variant " << variant << "):"
+              << std::endl;
+    PrintLinkLog(kProgram);
+    glDeleteProgram(kProgram);
+    state->failed = state->program.id == 0;
+    return false;
+  }
+
+  if (state->pending_key != 0)
+    WriteProgramBinary(kProgram, state->pending_key);
+  if (state->program.id != 0) glDeleteProgram(state->program.id);
+  state->program.id = kProgram;
+  Resolve(&state->program);
+  return true;
+}
+
+void ShaderVariants::Resolve(Program* program) const {
+  program->uniforms.resize(interface_.uniforms.size());
+  for (size_t i = 0; i < interface_.uniforms.size(); ++i)
+    program->uniforms[i] =
+        glGetUniformLocation(program->id, interface_.uniforms[i].c_str());
+
+  for (size_t i = 0; i < interface_.blocks.size(); ++i) {
+    const GLuint kIndex =
+        glGetUniformBlockIndex(program->id, interface_.blocks[i].c_str());
+    if (kIndex != GL_INVALID_INDEX)
+      glUniformBlockBinding(program->id, kIndex, i);
+  }
+
+  /* Samplers are only set through the current program */
+  GLint current = 0;
+  glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+  glUseProgram(program->id);
+  for (const auto& sampler : interface_.samplers)
+    glUniform1i(glGetUniformLocation(program->id, sampler.first.c_str()),
+                sampler.second);
+  glUseProgram(current);
+}
+
+std::string ShaderVariants::Source(const std::string& source,
+                                   unsigned int variant) const {
+  /* The #defines go after the #version line, and #line keeps the line
+   * numbers of the compile errors */
+  const size_t kVersionEnd = source.find('\n') + 1;
+  std::string defines;
+  for (size_t i = 0; i < features_.size(); ++i)
+    if (variant >> i & 1) defines += "#define " + features_[i] + "\n";
+  defines += "#line 2\n";
+  return source.substr(0, kVersionEnd) + defines + source.substr(kVersionEnd);
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,161 @@
+#ifndef SHADER_VARIANTS_H_
+#define SHADER_VARIANTS_H_
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace data_visualization {
+
+/**
+ * @brief ProgramInterface The uniforms a program is used through. They are
+ * resolved once per link, so that rendering does not look them up by name.
+ */
+struct ProgramInterface {
+  /* Uniforms set every frame, located in this order */
+  std::vector<std::string> uniforms;
+
+  /* Samplers and their texture units, which do not change */
+  std::vector<std::pair<std::string, GLint>> samplers;
+
+  /* Uniform blocks, block i is bound to the binding point i */
+  std::vector<std::string> blocks;
+};
+
+/**
+ * @brief ShaderVariants The programs built from a vertex and a fragment
+ * shader, one per combination of features. Feature i of a variant is enabled
+ * by bit i, which #defines features[i] after the #version line, so that the
+ * shaders select their code at compile time instead of branching on
+ * uniforms. Linked programs are cached on disk as program binaries, keyed by
+ * their sources and the driver, and reloads link in the background (when the
+ * driver compiles in parallel), keeping the previous programs until the new
+ * ones link. The uniforms of the interface are located once per link.
+ */
+class ShaderVariants {
+ public:
+  /**
+   * @brief ShaderVariants Constructor of the class.
+   * @param vertex_file Path of the vertex shader.
+   * @param fragment_file Path of the fragment shader.
+   * @param features Names of the #defines of the features.
+   * @param interface Uniforms of the programs.
+   */
+  ShaderVariants(const std::string& vertex_file,
+                 const std::string& fragment_file,
+                 const std::vector<std::string>& features = {},
+                 const ProgramInterface& interface = {});
+
+  /**
+   * @brief ~ShaderVariants Destructor of the class. Calls Release.
+   */
+  ~ShaderVariants();
+
+  ShaderVariants(const ShaderVariants&) = delete;
+  ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+  /**
+   * @brief Program A linked variant.
+   */
+  struct Program {
+    GLuint id = 0;
+
+    /* Locations of the uniforms of the interface, -1 if they are unused */
+    std::vector<GLint> uniforms;
+  };
+
+  /**
+   * @brief Load Reads the sources, the variants are built on first use.
+   * @return Whether the sources could be read.
+   */
+  bool Load();
+
+  /**
+   * @brief Reload Reads the sources again and starts linking the variants
+   * in use. The previous programs are used until Poll swaps the new ones.
+   * Requires the GL context to be current.
+   * @return Whether the sources could be read, otherwise the previous ones
+   * are kept.
+   */
+  bool Reload();
+
+  /**
+   * @brief Get Returns the program of a variant, building it if it was not
+   * used yet. Requires the GL context to be current.
+   * @param variant Bit i enables features[i].
+   * @return The program, whose id is 0 if it does not compile or link.
+   */
+  const Program& Get(unsigned int variant);
+
+  /**
+   * @brief Poll Swaps the programs that finished linking since the last
+   * reload. The ones that fail to link are dropped, with their log.
+   * @return Whether any program changed.
+   */
+  bool Poll();
+
+  /**
+   * @brief IsPending Whether any program is still linking.
+   */
+  bool IsPending() const;
+
+  /**
+   * @brief Release Deletes the programs.
+   */
+  void Release();
+
+ private:
+  /**
+   * @brief Variant The program of a variant, and the one linking.
+   */
+  struct Variant {
+    Program program;
+    GLuint pending = 0;
+    /* Binary cache key of the pending program, 0 if it was read from it */
+    uint64_t pending_key = 0;
+    /* Whether the last link failed, it is not retried until a reload */
+    bool failed = false;
+  };
+
+  /**
+   * @brief StartLink Starts building the program of a variant, from the
+   * binary cache or from the sources.
+   */
+  void StartLink(unsigned int variant, Variant* state);
+
+  /**
+   * @brief FinishLink Waits for the pending program of a variant, caches it
+   * and swaps it if it linked.
+   * @return Whether the program changed.
+   */
+  bool FinishLink(unsigned int variant, Variant* state);
+
+  /**
+   * @brief Resolve Locates the uniforms of a linked program, sets its
+   * samplers and binds its uniform blocks.
+   */
+  void Resolve(Program* program) const;
+
+  /**
+   * @brief Source Returns a shader source with the #defines of a variant.
+   */
+  std::string Source(const std::string& source, unsigned int variant) const;
+
+  std::string vertex_file_;
+  std::string fragment_file_;
+  std::vector<std::string> features_;
+  ProgramInterface interface_;
+
+  std::string vertex_source_;
+  std::string fragment_source_;
+
+  std::map<unsigned int, Variant> variants_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  SHADER_VARIANTS_H_
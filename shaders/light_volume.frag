@@ -0,0 +1,44 @@
+#version 330
+
+smooth in vec2 slice_coords;
+
+uniform sampler3D volume;
+/* Transfer function has four channels, one for each rgba component */
+uniform sampler1D transfer_function;
+/* Transmittance of the previous slice */
+uniform sampler2D previous;
+/* Maps volume texture coordinates to light volume texture coordinates */
+uniform mat3 axes;
+/* Light position, in light volume texture coordinates */
+uniform vec3 light_position;
+/* Texture coordinate of the slice along z, and signed distance between slices */
+uniform float layer;
+uniform float layer_step;
+/* Opacity samples per unit of length */
+uniform float samples_per_unit;
+
+out float transmittance;
+
+void main(void) {
+  vec3 position = vec3(slice_coords, layer);
+  vec3 direction = position - light_position;
+
+  /* Slices that are not past the light receive all of it */
+  float slices_from_light = direction.z / layer_step;
+  if (slices_from_light < 1) {
+    transmittance = 1;
+    return;
+  }
+
+  /* Follow the light ray back to the previous slice */
+  vec3 previous_position = position - direction / slices_from_light;
+  float previous_transmittance = texture(previous, previous_position.xy).r;
+
+  /* Correct the opacity for the length of the ray between both slices */
+  float density = texture(volume, transpose(axes) * position).r;
+  float alpha = texture(transfer_function, density).a;
+  float path_length = length(direction) / slices_from_light;
+  alpha = 1 - pow(1 - alpha, path_length * samples_per_unit);
+
+  transmittance = previous_transmittance * (1 - alpha);
+}
@@ -0,0 +1,11 @@
+#version 330
+
+/* Texture coordinates of the slice being rendered */
+smooth out vec2 slice_coords;
+
+void main(void)  {
+  /* A triangle covering the whole slice, from the vertex id */
+  vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  slice_coords = corner;
+  gl_Position = vec4(corner * 2 - 1, 0, 1);
+}
@@ -0,0 +1,44 @@
+#version 330
+
+smooth in vec3 position;
+smooth in vec3 fragment_normal;
+in vec3 camera_position_world;
+
+out vec4 frag_color;
+
+/* Per frame state, shared by the programs (see GLWidget) */
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  mat4 model;
+  vec3 LPOS;
+  vec3 LCOL;
+  float step_scale;
+};
+
+uniform vec3 surface_color;
+
+void main (void) {
+#ifndef PHONG
+  frag_color = vec4(surface_color, 1);
+#else
+  /* Surfaces cut by the volume bounds are seen from behind too */
+  vec3 view_direction = normalize(camera_position_world - position);
+  vec3 normal = normalize(fragment_normal);
+  if (dot(normal, view_direction) < 0) normal = -normal;
+
+  vec3 light_ambient = 0.3 * LCOL * surface_color;
+
+  vec3 light_direction_inv = normalize(LPOS - position);
+  float light_diffuse_strength = max(dot(normal, light_direction_inv), 0.0);
+  vec3 light_diffuse = LCOL * light_diffuse_strength * surface_color;
+
+  vec3 light_reflect_vector = reflect(-light_direction_inv, normal);
+  float light_specular_strength =
+      pow(max(dot(view_direction, light_reflect_vector), 0.0), 16.0);
+  vec3 light_specular = LCOL * light_specular_strength * 0.1;
+
+  frag_color = vec4(clamp(light_ambient + light_diffuse + light_specular,
+                          vec3(0), vec3(1)), 1);
+#endif
+}
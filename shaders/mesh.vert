@@ -0,0 +1,32 @@
+#version 330
+
+layout (location = 0) in vec3 vert;
+layout (location = 1) in vec3 normal;
+
+/* Per frame state, shared by the programs (see GLWidget) */
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  mat4 model;
+  vec3 LPOS;
+  vec3 LCOL;
+  float step_scale;
+};
+
+/* From voxel coordinates to the [-0.5, 0.5] cube */
+uniform mat4 voxel_to_model;
+
+smooth out vec3 position;
+smooth out vec3 fragment_normal;
+out vec3 camera_position_world;
+
+void main(void)  {
+  vec4 cube_position = voxel_to_model * vec4(vert, 1);
+  position = cube_position.xyz;
+  fragment_normal = transpose(inverse(mat3(voxel_to_model))) * normal;
+
+  mat4 view_inv = inverse(view * model);
+  camera_position_world = vec3(view_inv[3][0], view_inv[3][1], view_inv[3][2]);
+
+  gl_Position = projection * view * model * cube_position;
+}
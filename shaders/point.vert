@@ -1,12 +1,17 @@
 #version 330
 
-layout (location = 0) in vec3 vert;
-
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+/* Per frame state, shared by the programs (see GLWidget) */
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  mat4 model;
+  vec3 LPOS;
+  vec3 LCOL;
+  float step_scale;
+};
 
+/* Drawn as a single point, at the light position */
 void main(void)  {
   gl_PointSize = 10.0;
-  gl_Position = projection * view * model * vec4(vert, 1);
+  gl_Position = projection * view * model * vec4(LPOS, 1);
 }
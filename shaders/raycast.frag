@@ -1,28 +1,130 @@
 #version 330
 
+/* Features, #defined by the variant of the program (see GLWidget):
+   BRICKED, SKIP_EMPTY, PRECOMPUTED_GRADIENTS, PREINTEGRATED, SHADOWS, PHONG,
+   TRANSFER_FUNCTION_2D, PRECLASSIFIED, JITTERED, REPROJECTED, and the
+   compositing, MAXIMUM_INTENSITY, MINIMUM_INTENSITY, AVERAGE_INTENSITY or
+   front to back emission and absorption otherwise */
+
 smooth in vec3 tex_coords;
 smooth in vec3 position;
 in vec3 camera_position_world;
 
 uniform sampler3D volume;
+/* Size of the volume in voxels */
+uniform vec3 volume_size;
+/* Out-of-core volumes keep their resident bricks in an atlas, located
+   through the page table, and volume holds a downsampled overview */
+uniform sampler3D brick_atlas;
+uniform usampler3D page_table;
+/* Coarse grid, a cell is non zero if any of its densities is visible under
+   the transfer function, empty cells are skipped */
+uniform sampler3D occupancy;
+/* Voxels per cell edge of the occupancy grid */
+uniform float occupancy_cell_size;
+/* Density range of every cell, min in r and max in g, and of the volume,
+   used by the projections along with SKIP_EMPTY */
+uniform sampler3D cell_ranges;
+uniform vec2 volume_range;
+/* Gradients computed at load time, the normal in rgb and the magnitude in a */
+uniform sampler3D gradients;
 /* Transfer function has four channels, one for each rgba component */ 
 uniform sampler1D transfer_function;
-/* Light position */
-uniform vec3 LPOS;
-/* Light color */
-uniform vec3 LCOL;
-/* Calculate shadow */
-uniform bool calc_shadow = true;
-/* Calculate phong shading */
-uniform bool calc_phong = true;
+/* Color and opacity by density (s) and gradient magnitude (t), used instead
+   of the transfer function along with PRECOMPUTED_GRADIENTS */
+uniform sampler2D transfer_function_2d;
+/* Color, weighted by the opacity, and opacity of every voxel, baked from
+   the transfer function and the static lighting, used by PRECLASSIFIED
+   instead of the volume and the transfer function */
+uniform sampler3D classified_volume;
+/* Transmittance from the light to every texel, its axes are a permutation of
+   the volume ones */
+uniform sampler3D light_volume;
+uniform mat3 light_axes;
+/* Color and opacity of a ray segment, by back (s) and front (t) density */
+uniform sampler2D preintegration_table;
+/* Offset of the first sample of the pass, in steps, added to a per pixel
+   offset, used by JITTERED */
+uniform float jitter;
+/* The previous frame reprojected into this view, its color composited over
+   the background with the frames since it was ray cast over 255 in a (0
+   where there is none), and its depth, used by REPROJECTED. The tiles of
+   one half of a checkerboard, alternating every frame, reuse it */
+uniform sampler2D reprojected_color;
+uniform sampler2D reprojected_depth;
+uniform int reprojection_parity;
+/* Per frame state, shared by the programs (see GLWidget): the light
+   position and color, and the step length in texels of the longest edge of
+   the volume */
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  mat4 model;
+  vec3 LPOS;
+  vec3 LCOL;
+  float step_scale;
+};
 
 out vec4 frag_color;
 
+/* Brick edge and apron in voxels, they must match brick_store.h */
+const float kBrickSize = 64.0;
+const float kBrickApron = 1.0;
+
+/* Sample the density of the volume */
+float SampleVolume(vec3 texel_pos) {
+#ifdef BRICKED
+  {
+    vec3 voxel = clamp(texel_pos, vec3(0), vec3(1)) * volume_size;
+    ivec3 brick = min(ivec3(voxel / kBrickSize), textureSize(page_table, 0) - 1);
+    uvec4 entry = texelFetch(page_table, brick, 0);
+    if (entry.a != 0u) {
+      vec3 local = voxel - vec3(brick) * kBrickSize + vec3(kBrickApron);
+      vec3 atlas_pos = vec3(entry.xyz) * (kBrickSize + 2 * kBrickApron) + local;
+      return texture(brick_atlas, atlas_pos / vec3(textureSize(brick_atlas, 0))).r;
+    }
+    /* Bricks not resident yet fall back to the overview */
+  }
+#endif
+  return texture(volume, texel_pos).r;
+}
+
 vec4 TF(float density) {
    /* Sample color from the transfer function */
    return vec4(texture(transfer_function, density));
 }
 
+/* Color and opacity of the ray segment between two samples */
+vec4 Segment(float front_density, float back_density) {
+#ifdef PREINTEGRATED
+  /* Texel centers of the 256 x 256 table */
+  return texture(preintegration_table, (vec2(back_density, front_density) * 255 + 0.5) / 256);
+#else
+  /* Correct the opacity of the back sample for the step length */
+  vec4 color = TF(back_density);
+  color.a = 1 - pow(1 - color.a, step_scale);
+  return color;
+#endif
+}
+
+/* Color and opacity of a sample by its density and the magnitude of its
+   gradient texel */
+vec4 Classify2D(float density, float magnitude) {
+  /* Texel centers of the 256 x 256 table */
+  vec4 color = texture(transfer_function_2d, (vec2(density, magnitude) * 255 + 0.5) / 256);
+  color.a = 1 - pow(1 - color.a, step_scale);
+  return color;
+}
+
+/* Color and opacity of a pre-classified sample */
+vec4 Preclassified(vec3 texel_pos) {
+  vec4 color = texture(classified_volume, texel_pos);
+  /* The colors were interpolated weighted by the opacity */
+  color.rgb = color.a > 0 ? min(color.rgb / color.a, vec3(1)) : vec3(0);
+  color.a = 1 - pow(1 - color.a, step_scale);
+  return color;
+}
+
 /* Compose color, front to back, color is the input color, alpha is the opacity accumulation */
 vec3 ComposeColor(vec4 color, float alpha){
   return (1 - alpha) * (color.a) * color.xyz;
@@ -34,15 +136,31 @@ float ComposeAlpha(vec4 color, float alpha){
 
 /* Calculate the gradient of a texel, given a small delta */
 vec3 CalculateNormal(vec3 texel_pos, float delta) {
-  float x = texture(volume, texel_pos + vec3(delta, 0, 0)).r - texture(volume, texel_pos - vec3(delta, 0, 0)).r;
-  float y = texture(volume, texel_pos + vec3(0, delta, 0)).r - texture(volume, texel_pos - vec3(0, delta, 0)).r;
-  float z = texture(volume, texel_pos + vec3(0, 0, delta)).r - texture(volume, texel_pos - vec3(0, 0, delta)).r;
+  float x = SampleVolume(texel_pos + vec3(delta, 0, 0)) - SampleVolume(texel_pos - vec3(delta, 0, 0));
+  float y = SampleVolume(texel_pos + vec3(0, delta, 0)) - SampleVolume(texel_pos - vec3(0, delta, 0));
+  float z = SampleVolume(texel_pos + vec3(0, 0, delta)) - SampleVolume(texel_pos - vec3(0, 0, delta));
 
   /* Normalize and inverse */
   /* Inversion is applied because in the volume that I was testing, ligthning was inversed */
   return -normalize(vec3(x, y, z));
 }
 
+/* Unpack the normal of a texel of the precomputed gradients */
+vec3 UnpackNormal(vec4 gradient) {
+  /* Unpack from [0, 1] to [-1, 1], interpolation shortens the normal */
+  vec3 normal = gradient.xyz * 2 - 1;
+  float normal_length = length(normal);
+
+  /* Flat regions have no normal */
+  if (normal_length < 0.05) return vec3(0);
+  return normal / normal_length;
+}
+
+/* Fetch the precomputed normal of a texel */
+vec3 SampleNormal(vec3 texel_pos) {
+  return UnpackNormal(texture(gradients, texel_pos));
+}
+
 vec3 ComputePhongShading(vec3 light_position, vec3 light_color, vec3 fragment_position, vec3 fragment_normal, vec3 fragment_color){
     /* Calculate ambient component */
     vec3 light_ambient = 0.3 * light_color * fragment_color;
@@ -61,100 +179,301 @@ vec3 ComputePhongShading(vec3 light_position, vec3 light_color, vec3 fragment_po
     return clamp(light_ambient + light_diffuse + light_specular, vec3(0,0,0), vec3(1,1,1));
 }
 
-/* Calculate the shadow for a texel */
-float CalculateShadow(vec3 texel_world_position, vec3 fragment_tex_coords, vec3 light_position) {
-  /* Accumulate alpha from the texel position to the light */
-  float alpha_acc = 0.0f;
+/* Ray state shared by the kernels, set up by main, the samples are taken
+   at t_start + i * step_length */
+vec3 ray;
+vec3 inv_ray;
+float step_length;
+float t_start;
+float t_exit;
+/* Distance of the point that stands for the ray when it is reprojected */
+float t_depth;
+float max_steps;
+vec3 cell_size;
+ivec3 last_cell;
+
+/* Cell of the occupancy grid holding a position */
+ivec3 CellOf(vec3 position) {
+  return clamp(ivec3(position / cell_size), ivec3(0), last_cell);
+}
 
-  /* This is used again to estimate the number of steps */
-  float max_texture_size = max(max(textureSize(volume, 0).x, textureSize(volume, 0).y), textureSize(volume, 0).z);
+/* Distance of the first step past a cell */
+float StepPastCell(ivec3 cell) {
+  vec3 cell_exits = max((vec3(cell) * cell_size - tex_coords) * inv_ray,
+                        (vec3(cell + 1) * cell_size - tex_coords) * inv_ray);
+  float t_cell = min(min(cell_exits.x, cell_exits.y), cell_exits.z);
+  return t_start + step_length * (floor((t_cell - t_start) / step_length) + 1);
+}
 
-  /* Calculate direction from the texel to light */
-  vec3 current_position = fragment_tex_coords;
-  vec3 ray =  normalize(LPOS - texel_world_position);
-  /* Advance roughly 10 texel per step */
-  vec3 step = 10 * ray / max_texture_size;
+/* Interleaved gradient noise, an offset in [0, 1) that differs between
+   neighbouring pixels without a texture */
+float PixelNoise() {
+  return fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+}
 
-  for(int i=0; i < 2*max_texture_size; i++) {
-    /* Sample texel density */
-    float density = texture(volume, current_position).r;
-    /* Calculate color */
-    vec4 color = TF(density);
-    /* Compse alpha */
-    alpha_acc += (1 - alpha_acc) * color.a;
+/* Pixels this old are ray cast again, it must match reproject.vert */
+const float kMaxReprojectionAge = 4.0;
 
-    /* Advance ray */
-    current_position = current_position + step;
+/* Edge in pixels of the tiles that reuse the previous frame */
+const int kReprojectionTile = 8;
 
-    /* Stop if accumulation is high enough, or we if exited the volume */
-    if (alpha_acc >= 0.95) break;
-    if (current_position.x > 1 || current_position.x < 0) break;
-    if (current_position.y > 1 || current_position.y < 0) break;
-    if (current_position.z > 1 || current_position.z < 0) break;
-  }
-  return alpha_acc;
-}
+/* Opacity at the point that stands for a composited ray */
+const float kRepresentativeOpacity = 0.5;
 
+/* Emission and absorption, front to back */
+vec4 Composite() {
+  vec4 color_sum = vec4(0, 0, 0, 0);
+  /* Depths weighted by the opacity they add */
+  float depth_sum = 0;
+  t_depth = -1;
 
-void main (void) {
-  
-  /* Initial color */
-  frag_color = vec4(0, 0, 0, 0);
-  /* Calculate maximum texture size, to be used to estimate the 
-     number of ray tracing steps
-  */
-  float max_texture_size = max(max(textureSize(volume, 0).x, textureSize(volume, 0).y), textureSize(volume, 0).z);
+  float t = t_start;
+  /* Density of the previous sample, negative if the previous step was skipped */
+  float front_density = -1;
+  for(int i=0; i < max_steps && t < t_exit; i++) {
+    vec3 current_position = tex_coords + t * ray;
 
-  /* Calculate ray direction from cameta to fragment */
-  vec3 current_position = tex_coords;
-  vec3 ray =  normalize(position - camera_position_world);
-  /* March roughly one texel per step, if the angle is perpendicular 
-     to the volume
-  */
-  vec3 step = 1 * ray / max_texture_size;
+    /* Jump to the first step past an empty cell */
+#ifdef SKIP_EMPTY
+    ivec3 cell = CellOf(current_position);
+    if (texelFetch(occupancy, cell, 0).r == 0) {
+      t = StepPastCell(cell);
+      front_density = -1;
+      continue;
+    }
+#endif
 
-  for(int i=0; i < 2*max_texture_size; i++) {
+#if defined(PRECLASSIFIED)
+    /* One fetch instead of the density and the transfer function, the
+       ambient and diffuse lighting are baked in too when enabled */
+    vec4 color = Preclassified(current_position);
+#else
     /* Sample texel density from the volume */
-    float density = texture(volume, current_position).r;
-    /* Calculate color based on the transfer function */
-    vec4 color = TF(density);
+    float density = SampleVolume(current_position);
+#ifdef TRANSFER_FUNCTION_2D
+    /* The one extra fetch, its gradient also shades the sample */
+    vec4 gradient = texture(gradients, current_position);
+    vec4 color = Classify2D(density, gradient.a);
+#else
+    /* Calculate color based on the transfer function, for the segment that
+       ends at this sample */
+    vec4 color = Segment(front_density < 0 ? density : front_density, density);
+    front_density = density;
+#endif
+#endif
    
     /* If the texel is highly transparent, then skip it */
     if (color.a <= 0.001) {
        /* Advance ray */
-       current_position = current_position + step;
+       t += step_length;
        continue;
     }
 
     /* Calculate shadow for this texel */
     float shadow = 0.0f;
-    if (calc_shadow){
-       /* The world position of that texel is current_position - 0.5 
-          since the texels are shifted in the vertex shader 
-       */
-       shadow = CalculateShadow(current_position - vec3(0.5), current_position, LPOS);
-    }
+#ifdef SHADOWS
+    /* The light that reaches this texel was computed when the light or
+       the transfer function changed
+    */
+    shadow = 1 - texture(light_volume, light_axes * current_position).r;
+#endif
     
     /* Calculate phong color for texel */
     vec4 phong_color = color;
-    if (calc_phong){
-        /* Calculate the gradient of this texel, for the normal, delta is 0.01 */
-        /* Shift again for the same reason, we could shift current_position as well */
-        phong_color = vec4(ComputePhongShading(LPOS + vec3(0.5), LCOL, current_position, CalculateNormal(current_position, 0.01), color.xyz), color.a);
-    }
+#ifdef PHONG
+    /* Fetch the gradient of this texel for the normal, or calculate it
+       with a delta of 0.01 if it was not precomputed */
+#if defined(TRANSFER_FUNCTION_2D)
+    vec3 normal = UnpackNormal(gradient);
+#elif defined(PRECOMPUTED_GRADIENTS)
+    vec3 normal = SampleNormal(current_position);
+#else
+    vec3 normal = CalculateNormal(current_position, 0.01);
+#endif
+    /* Shift again for the same reason, we could shift current_position as well */
+    phong_color = vec4(ComputePhongShading(LPOS + vec3(0.5), LCOL, current_position, normal, color.xyz), color.a);
+#endif
     
     /* Compose color and alpha, front to back, multiply color with shadow */
-    frag_color.xyz += (1-shadow) * ComposeColor(phong_color, frag_color.a);
-    frag_color.a += ComposeAlpha(phong_color, frag_color.a);
+    color_sum.xyz += (1-shadow) * ComposeColor(phong_color, color_sum.a);
+    float alpha = ComposeAlpha(phong_color, color_sum.a);
+    depth_sum += alpha * t;
+    if (color_sum.a < kRepresentativeOpacity &&
+        color_sum.a + alpha >= kRepresentativeOpacity)
+      t_depth = t;
+    color_sum.a += alpha;
 
     /* Advance ray */
-    current_position = current_position + step;
+    t += step_length;
 
-    /* Exit if opacity is big enough, or if we ray exited the volume */
-    if (frag_color.a >= 0.95) break;
-    if (current_position.x > 1 || current_position.x < 0) break;
-    if (current_position.y > 1 || current_position.y < 0) break;
-    if (current_position.z > 1 || current_position.z < 0) break;
+    /* Exit if opacity is big enough, the loop exits the volume at t_exit */
+    if (color_sum.a >= 0.95) break;
   }
 
+  /* Rays that stay translucent stand at their mean depth */
+  if (t_depth < 0) t_depth = color_sum.a > 0 ? depth_sum / color_sum.a : 0;
+  return color_sum;
+}
+
+/* Maximum intensity projection, cells that cannot raise the maximum are
+   skipped, and the ray stops at the maximum of the volume */
+vec4 MaximumIntensity() {
+  float maximum = 0;
+  float t = t_start;
+  for (int i = 0; i < max_steps && t < t_exit; i++) {
+    vec3 current_position = tex_coords + t * ray;
+#ifdef SKIP_EMPTY
+    ivec3 cell = CellOf(current_position);
+    if (texelFetch(cell_ranges, cell, 0).g <= maximum) {
+      t = StepPastCell(cell);
+      continue;
+    }
+#endif
+
+    float density = SampleVolume(current_position);
+    if (density > maximum) {
+      maximum = density;
+      t_depth = t;
+    }
+#ifdef SKIP_EMPTY
+    if (maximum >= volume_range.y) break;
+#endif
+    t += step_length;
+  }
+  return vec4(vec3(maximum), 1);
+}
+
+/* Minimum intensity projection, the dual of MaximumIntensity */
+vec4 MinimumIntensity() {
+  float minimum = 1;
+  float t = t_start;
+  for (int i = 0; i < max_steps && t < t_exit; i++) {
+    vec3 current_position = tex_coords + t * ray;
+#ifdef SKIP_EMPTY
+    ivec3 cell = CellOf(current_position);
+    if (texelFetch(cell_ranges, cell, 0).r >= minimum) {
+      t = StepPastCell(cell);
+      continue;
+    }
+#endif
+
+    float density = SampleVolume(current_position);
+    if (density < minimum) {
+      minimum = density;
+      t_depth = t;
+    }
+#ifdef SKIP_EMPTY
+    if (minimum <= volume_range.x) break;
+#endif
+    t += step_length;
+  }
+  return vec4(vec3(minimum), 1);
+}
+
+/* Mean density along the ray, the samples of cells that are all zero are
+   counted without being taken */
+vec4 AverageIntensity() {
+  float sum = 0;
+  float count = 0;
+  /* Distance past the last sample inside the volume */
+  float t_last = t_start + ceil((t_exit - t_start) / step_length) * step_length;
+  t_depth = 0.5 * t_exit;
+  float t = t_start;
+  for (int i = 0; i < max_steps && t < t_exit; i++) {
+    vec3 current_position = tex_coords + t * ray;
+#ifdef SKIP_EMPTY
+    ivec3 cell = CellOf(current_position);
+    if (texelFetch(cell_ranges, cell, 0).g == 0) {
+      float t_next = StepPastCell(cell);
+      count += round((min(t_next, t_last) - t) / step_length);
+      t = t_next;
+      continue;
+    }
+#endif
+
+    sum += SampleVolume(current_position);
+    count += 1;
+    t += step_length;
+  }
+  return vec4(vec3(count > 0 ? sum / count : 0), 1);
+}
+
+void main (void) {
+#ifdef REPROJECTED
+  /* The tiles of this frame's half of the checkerboard keep the previous
+     frame, in the 2 x 2 quads it landed on entirely and not too long ago.
+     A quad decides as one, the texture lookups of the others take their
+     derivatives from it, and whole tiles skip the ray casting */
+  ivec2 pixel = ivec2(gl_FragCoord.xy);
+  ivec2 tile = pixel / kReprojectionTile;
+  bool reuse = ((tile.x + tile.y + reprojection_parity) & 1) == 0;
+  for (int i = 0; i < 4 && reuse; i++) {
+    ivec2 quad_pixel = (pixel & ~1) + ivec2(i & 1, i >> 1);
+    float age = round(texelFetch(reprojected_color, quad_pixel, 0).a * 255);
+    reuse = age > 0 && age <= kMaxReprojectionAge;
+  }
+  if (reuse) {
+    frag_color = texelFetch(reprojected_color, pixel, 0);
+    gl_FragDepth = texelFetch(reprojected_depth, pixel, 0).r;
+    return;
+  }
+#endif
+
+  /* Calculate maximum texture size, to be used to estimate the 
+     number of ray tracing steps, enough for the diagonal of the volume at
+     the scaled step
+  */
+  float max_texture_size = max(max(volume_size.x, volume_size.y), volume_size.z);
+  max_steps = ceil(sqrt(3.0) * max_texture_size / step_scale) + 1;
+
+  /* Calculate ray direction from cameta to fragment */
+  ray =  normalize(position - camera_position_world);
+  /* March roughly one texel per step, if the angle is perpendicular 
+     to the volume
+  */
+  step_length = step_scale / max_texture_size;
+
+  /* The passes of the progressive mode sample the rays at offsets that
+     differ by pixel and by pass, their average converges to the integral */
+#ifdef JITTERED
+  t_start = fract(PixelNoise() + jitter) * step_length;
+#else
+  t_start = 0;
+#endif
+
+  t_depth = 0;
+
+  /* Distance to the exit of the volume, rays parallel to a face are nudged
+     to avoid dividing by zero */
+  inv_ray = 1.0 / mix(ray, vec3(1e-6), lessThan(abs(ray), vec3(1e-6)));
+  vec3 exits = max(-tex_coords * inv_ray, (vec3(1) - tex_coords) * inv_ray);
+  t_exit = min(min(exits.x, exits.y), exits.z);
+
+  /* Size of a cell of the occupancy grid in texture coordinates */
+  cell_size = occupancy_cell_size / volume_size;
+  last_cell = textureSize(occupancy, 0) - 1;
+
+#if defined(MAXIMUM_INTENSITY)
+  frag_color = MaximumIntensity();
+#elif defined(MINIMUM_INTENSITY)
+  frag_color = MinimumIntensity();
+#elif defined(AVERAGE_INTENSITY)
+  frag_color = AverageIntensity();
+#else
+  frag_color = Composite();
+#endif
+
+#ifdef JITTERED
+  /* Composited over the white background here, the passes are averaged by
+     the blending */
+  frag_color = vec4(mix(vec3(1), frag_color.rgb, frag_color.a), 1);
+#endif
+
+#ifdef REPROJECTED
+  /* Composited over the white background here too, as a pixel just ray
+     cast, and at the depth of the point that stands for the ray */
+  frag_color = vec4(mix(vec3(1), frag_color.rgb, frag_color.a), 1.0 / 255);
+  vec4 clip = projection * view * model * vec4(position + t_depth * ray, 1);
+  gl_FragDepth = clamp(0.5 * clip.z / clip.w + 0.5, 0, 1);
+#endif
 }
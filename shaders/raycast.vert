@@ -2,9 +2,15 @@
 
 layout (location = 0) in vec3 vert;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+/* Per frame state, shared by the programs (see GLWidget) */
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  mat4 model;
+  vec3 LPOS;
+  vec3 LCOL;
+  float step_scale;
+};
 
 smooth out vec3 tex_coords;
 smooth out vec3 position;
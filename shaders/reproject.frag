@@ -0,0 +1,11 @@
+#version 330
+
+in vec4 color;
+
+out vec4 frag_color;
+
+/* The nearest point of the previous frame that lands on the pixel, by the
+   depth test */
+void main (void) {
+  frag_color = color;
+}
@@ -0,0 +1,35 @@
+#version 330
+
+/* The previous frame: its color, composited over the background, with the
+   frames since it was ray cast over 255 in a (0 where nothing was ray cast),
+   and the depth of its representative points */
+uniform sampler2D previous_color;
+uniform sampler2D previous_depth;
+/* From the normalized device coordinates of the previous frame to the clip
+   coordinates of this one */
+uniform mat4 reprojection;
+
+/* Pixels this old are ray cast again, it must match raycast.frag */
+const float kMaxReprojectionAge = 4.0;
+
+out vec4 color;
+
+/* One point per pixel of the previous frame, from the vertex id */
+void main(void)  {
+  ivec2 size = textureSize(previous_color, 0);
+  ivec2 pixel = ivec2(gl_VertexID % size.x, gl_VertexID / size.x);
+  color = texelFetch(previous_color, pixel, 0);
+  gl_PointSize = 1.0;
+
+  /* Pixels with nothing to reuse are dropped outside the clip volume */
+  float age = round(color.a * 255);
+  if (age == 0 || age >= kMaxReprojectionAge) {
+    gl_Position = vec4(2, 2, 2, 1);
+    return;
+  }
+
+  float depth = texelFetch(previous_depth, pixel, 0).r;
+  vec3 ndc = vec3((vec2(pixel) + 0.5) / vec2(size), depth) * 2 - 1;
+  gl_Position = reprojection * vec4(ndc, 1);
+  color.a = (age + 1) / 255;
+}
@@ -0,0 +1,246 @@
+// Streams a stack of images through the pixel unpack ring into a 3D texture,
+// in an offscreen OpenGL context, as ReadFromDicom does. Reads the volume and
+// gradient textures back and compares them, and the histograms, with those of
+// the slices decoded on the host:
+//
+//   ViewerSVStreamCheck path/to/stack --slab-depth 4
+//
+// Without a stack, a synthetic phantom of --size voxels per edge is written
+// as a stack of JPEG slices to a temporary directory first. Every slab of
+// --slab-depth slices goes through a slot of the ring, so a small depth wraps
+// around the ring several times. Exits with 0 if the volumes match, 1 if they
+// differ, and 2 if the check could not run.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QImage>
+#include <QTemporaryDir>
+
+#include <GL/glew.h>
+
+#include <boost/filesystem.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./offscreen_context.h"
+#include "./synthetic_volume.h"
+#include "./volume_io.h"
+#include "./volume_stream.h"
+
+namespace {
+
+/* The synthetic stack */
+const float kSyntheticSparsity = 0.7f;
+const unsigned int kSyntheticSeed = 1;
+const int kJpegQuality = 100;
+
+/**
+ * @brief WriteSyntheticStack Writes a synthetic phantom as a stack of
+ * grayscale JPEG slices, named by their index.
+ * @return Whether all the slices could be written.
+ */
+bool WriteSyntheticStack(const QString &dir, int size) {
+  std::vector<unsigned char> voxels;
+  data_representation::GenerateVolume(data_representation::kPhantom, size,
+                                      size, size, kSyntheticSparsity,
+                                      kSyntheticSeed, &voxels);
+
+  const size_t kSliceVoxels = static_cast<size_t>(size) * size;
+  for (int z = 0; z < size; ++z) {
+    const QImage kSlice(voxels.data() + kSliceVoxels * z, size, size, size,
+                        QImage::Format_Grayscale8);
+    if (!kSlice.save(QDir(dir).filePath(QString("%1.jpg").arg(z)), "JPG",
+                     kJpegQuality))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief CountMismatches Counts the bytes that differ between two buffers of
+ * the same size.
+ * @param first The offset of the first difference, if any.
+ */
+size_t CountMismatches(const std::vector<unsigned char> &a,
+                       const std::vector<unsigned char> &b,
+                       size_t *first) {
+  size_t mismatches = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i] == b[i]) continue;
+    if (mismatches++ == 0) *first = i;
+  }
+  return mismatches;
+}
+
+/**
+ * @brief ReadTexture Reads back the base level of a 3D texture.
+ */
+std::vector<unsigned char> ReadTexture(GLuint texture, GLenum format,
+                                       size_t size) {
+  std::vector<unsigned char> data(size);
+  glBindTexture(GL_TEXTURE_3D, texture);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_3D, 0, format, GL_UNSIGNED_BYTE, data.data());
+  return data;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Checks the volume streamed through the pixel unpack ring against the "
+      "decoded slices");
+  parser.addHelpOption();
+  parser.addPositionalArgument(
+      "stack", "Directory of the slices, a synthetic stack if omitted.",
+      "[stack]");
+  const QCommandLineOption kSize(
+      "size", "Voxels along every edge of the synthetic stack.", "size", "96");
+  const QCommandLineOption kSlabDepth("slab-depth", "Slices per slab.",
+                                      "slices", "4");
+  parser.addOptions({kSize, kSlabDepth});
+  parser.process(app);
+
+  bool valid_size = false, valid_slab_depth = false;
+  const int kSyntheticSize = parser.value(kSize).toInt(&valid_size);
+  const int kSlabSlices = parser.value(kSlabDepth).toInt(&valid_slab_depth);
+  if (!valid_size || kSyntheticSize <= 0 || !valid_slab_depth ||
+      kSlabSlices <= 0) {
+    std::cerr << "The size and slab depth must be positive." << std::endl;
+    return 2;
+  }
+
+  QTemporaryDir synthetic_dir;
+  std::string stack;
+  if (!parser.positionalArguments().isEmpty()) {
+    stack = parser.positionalArguments().first().toStdString();
+  } else if (synthetic_dir.isValid() &&
+             WriteSyntheticStack(synthetic_dir.path(), kSyntheticSize)) {
+    stack = synthetic_dir.path().toStdString();
+  } else {
+    std::cerr << "Could not write the synthetic stack" << std::endl;
+    return 2;
+  }
+
+  std::vector<boost::filesystem::path> paths;
+  if (!data_representation::ScanDicomDirectory(stack, &paths)) {
+    std::cerr << "No slices in " << stack << std::endl;
+    return 2;
+  }
+  const QImage kFirstSlice(QString::fromStdString(paths[0].string()));
+  if (kFirstSlice.isNull()) {
+    std::cerr << "Could not read " << paths[0].string() << std::endl;
+    return 2;
+  }
+
+  const int kWidth = kFirstSlice.width();
+  const int kHeight = kFirstSlice.height();
+  const int kDepth = paths.size();
+  const size_t kDataSize = static_cast<size_t>(kWidth) * kHeight * kDepth;
+
+  /* The reference, decoded in one go on the host */
+  std::vector<unsigned char> decoded(kDataSize);
+  if (!data_representation::DecodeDicomSlices(paths, 0, kDepth, kWidth,
+                                              kHeight, decoded.data())) {
+    std::cerr << "Could not decode " << stack << std::endl;
+    return 2;
+  }
+  std::vector<double> decoded_histogram(data_representation::kHistogramSize,
+                                        0.0);
+  data_representation::AccumulateHistogram(decoded.data(), kDataSize,
+                                           &decoded_histogram);
+  std::vector<unsigned char> decoded_gradients(4 * kDataSize);
+  data_representation::ComputeGradients(decoded.data(), kWidth, kHeight,
+                                        kDepth, decoded_gradients.data());
+  std::vector<double> decoded_joint_histogram(
+      data_representation::kHistogramSize *
+          data_representation::kHistogramSize,
+      0.0);
+  data_representation::AccumulateJointHistogram(
+      decoded.data(), decoded_gradients.data(), kDataSize,
+      &decoded_joint_histogram);
+
+  data_visualization::OffscreenContext context;
+  if (!context.Create()) return 2;
+  if (!data_representation::PixelUnpackRing::IsSupported()) {
+    std::cerr << "The context has no persistent buffer mappings" << std::endl;
+    return 2;
+  }
+  std::cerr << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+  data_representation::PixelUnpackRing ring;
+  if (!ring.Init(static_cast<size_t>(kWidth) * kHeight * kSlabSlices,
+                 data_representation::kStreamingSlots)) {
+    std::cerr << "Could not map the pixel unpack ring" << std::endl;
+    return 2;
+  }
+
+  /* Neither cached nor classified, only the textures are checked */
+  std::vector<double> streamed_histogram(data_representation::kHistogramSize,
+                                         0.0);
+  std::vector<double> streamed_joint_histogram(decoded_joint_histogram.size(),
+                                               0.0);
+  GLuint texture, gradient_texture;
+  data_representation::LoadTimes times;
+  if (!data_representation::StreamSlices(
+          paths, kWidth, kHeight, kSlabSlices, &ring, nullptr,
+          &streamed_histogram, nullptr, &texture, &gradient_texture,
+          &streamed_joint_histogram, &times)) {
+    std::cerr << "Could not stream " << stack << std::endl;
+    return 2;
+  }
+  ring.Release();
+
+  const std::vector<unsigned char> kStreamed =
+      ReadTexture(texture, GL_RED, kDataSize);
+  const std::vector<unsigned char> kStreamedGradients =
+      ReadTexture(gradient_texture, GL_RGBA, 4 * kDataSize);
+  glDeleteTextures(1, &texture);
+  glDeleteTextures(1, &gradient_texture);
+
+  size_t first_mismatch = 0, first_gradient_mismatch = 0;
+  const size_t kMismatches =
+      CountMismatches(kStreamed, decoded, &first_mismatch);
+  const size_t kGradientMismatches = CountMismatches(
+      kStreamedGradients, decoded_gradients, &first_gradient_mismatch);
+  const bool kSameHistogram = streamed_histogram == decoded_histogram;
+  const bool kSameJointHistogram =
+      streamed_joint_histogram == decoded_joint_histogram;
+
+  std::cout << kWidth << " x " << kHeight << " x " << kDepth << " in slabs of "
+            << kSlabSlices << " slices: " << kMismatches << " of " << kDataSize
+            << " voxels and " << kGradientMismatches << " of " << 4 * kDataSize
+            << " gradient bytes differ, histogram "
+            << (kSameHistogram ? "matches" : "differs") << ", joint histogram "
+            << (kSameJointHistogram ? "matches" : "differs") << std::endl;
+
+  const size_t kSliceVoxels = static_cast<size_t>(kWidth) * kHeight;
+  if (kMismatches > 0) {
+    std::cout << "First difference at (" << first_mismatch % kWidth << ", "
+              << first_mismatch % kSliceVoxels / kWidth << ", "
+              << first_mismatch / kSliceVoxels << "): streamed "
+              << static_cast<int>(kStreamed[first_mismatch]) << ", decoded "
+              << static_cast<int>(decoded[first_mismatch]) << std::endl;
+  }
+  if (kGradientMismatches > 0) {
+    const size_t kVoxel = first_gradient_mismatch / 4;
+    std::cout << "First gradient difference at (" << kVoxel % kWidth << ", "
+              << kVoxel % kSliceVoxels / kWidth << ", "
+              << kVoxel / kSliceVoxels << "): streamed "
+              << static_cast<int>(kStreamedGradients[first_gradient_mismatch])
+              << ", computed "
+              << static_cast<int>(decoded_gradients[first_gradient_mismatch])
+              << std::endl;
+  }
+
+  const bool kMatch = kMismatches == 0 && kGradientMismatches == 0 &&
+                      kSameHistogram && kSameJointHistogram;
+  return kMatch ? 0 : 1;
+}
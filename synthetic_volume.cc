@@ -0,0 +1,252 @@
+#include <synthetic_volume.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace data_representation {
+
+namespace {
+
+/**
+ * @brief Ellipsoid An ellipsoid of the phantom, in [-1, 1]^3, rotated around
+ * the z axis, that adds its density to the voxels inside.
+ */
+struct Ellipsoid {
+  double center[3];
+  double axes[3];
+  double degrees;
+  double density;
+};
+
+/* The 3D modified Shepp-Logan phantom, the first ellipsoid is the skull and
+ * bounds the others */
+const Ellipsoid kPhantomEllipsoids[] = {
+    {{0.0, 0.0, 0.0}, {0.69, 0.92, 0.81}, 0.0, 1.0},
+    {{0.0, -0.0184, 0.0}, {0.6624, 0.874, 0.78}, 0.0, -0.8},
+    {{0.22, 0.0, 0.0}, {0.11, 0.31, 0.22}, -18.0, -0.2},
+    {{-0.22, 0.0, 0.0}, {0.16, 0.41, 0.28}, 18.0, -0.2},
+    {{0.0, 0.35, -0.15}, {0.21, 0.25, 0.41}, 0.0, 0.1},
+    {{0.0, 0.1, 0.25}, {0.046, 0.046, 0.05}, 0.0, 0.1},
+    {{0.0, -0.1, 0.25}, {0.046, 0.046, 0.05}, 0.0, 0.1},
+    {{-0.08, -0.605, 0.0}, {0.046, 0.023, 0.05}, 0.0, 0.1},
+    {{0.0, -0.605, 0.0}, {0.023, 0.023, 0.02}, 0.0, 0.1},
+    {{0.06, -0.605, 0.0}, {0.023, 0.046, 0.02}, 0.0, 0.1}};
+
+const double kPi = 3.14159265358979323846;
+
+/* Octaves of the noise, and lattice spacing in voxels of the first one */
+const int kNoiseOctaves = 4;
+const int kNoiseSpacing = 32;
+
+/* Bins of the noise histogram that places the threshold */
+const int kNoiseBins = 1 << 16;
+
+unsigned char ToByte(double density) {
+  return static_cast<unsigned char>(
+      std::lround(255.0 * std::min(std::max(density, 0.0), 1.0)));
+}
+
+void GenerateSphere(int width, int height, int depth, float sparsity,
+                    std::vector<unsigned char> *voxels) {
+  const double kVoxels = static_cast<double>(width) * height * depth;
+  const double kRadius =
+      std::min(std::cbrt(3.0 * (1.0 - sparsity) * kVoxels / (4.0 * kPi)),
+               0.5 * std::min(width, std::min(height, depth)));
+
+#pragma omp parallel for
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const double kDx = x + 0.5 - 0.5 * width;
+        const double kDy = y + 0.5 - 0.5 * height;
+        const double kDz = z + 0.5 - 0.5 * depth;
+        const double kDistance = std::sqrt(kDx * kDx + kDy * kDy + kDz * kDz);
+        (*voxels)[(static_cast<size_t>(z) * height + y) * width + x] =
+            kRadius > 0.0 ? ToByte(1.0 - kDistance / kRadius) : 0;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Lattice The random values of an octave of the noise, at every
+ * spacing voxels.
+ */
+struct Lattice {
+  int spacing;
+  int size[3];
+  std::vector<float> values;
+
+  float At(int x, int y, int z) const {
+    return values[(static_cast<size_t>(z) * size[1] + y) * size[0] + x];
+  }
+
+  /* Smoothly interpolated value at a voxel */
+  float Sample(int x, int y, int z) const {
+    const int kVoxel[3] = {x, y, z};
+    int cell[3];
+    float weight[3];
+    for (int i = 0; i < 3; ++i) {
+      cell[i] = kVoxel[i] / spacing;
+      const float kT =
+          (kVoxel[i] - cell[i] * spacing + 0.5f) / static_cast<float>(spacing);
+      weight[i] = kT * kT * (3.0f - 2.0f * kT);
+    }
+
+    float value = 0.0f;
+    for (int corner = 0; corner < 8; ++corner) {
+      float corner_weight = 1.0f;
+      int index[3];
+      for (int i = 0; i < 3; ++i) {
+        const int kBit = corner >> i & 1;
+        index[i] = cell[i] + kBit;
+        corner_weight *= kBit ? weight[i] : 1.0f - weight[i];
+      }
+      value += corner_weight * At(index[0], index[1], index[2]);
+    }
+    return value;
+  }
+};
+
+void GenerateNoise(int width, int height, int depth, float sparsity,
+                   unsigned int seed, std::vector<unsigned char> *voxels) {
+  /* The raw output of the Mersenne twister is the same on every platform,
+   * unlike the standard distributions */
+  std::mt19937 random(seed);
+  std::vector<Lattice> octaves(kNoiseOctaves);
+  for (int octave = 0; octave < kNoiseOctaves; ++octave) {
+    Lattice &lattice = octaves[octave];
+    lattice.spacing = std::max(1, kNoiseSpacing >> octave);
+    lattice.size[0] = width / lattice.spacing + 2;
+    lattice.size[1] = height / lattice.spacing + 2;
+    lattice.size[2] = depth / lattice.spacing + 2;
+    lattice.values.resize(static_cast<size_t>(lattice.size[0]) *
+                          lattice.size[1] * lattice.size[2]);
+    for (float &value : lattice.values)
+      value = (random() >> 8) / static_cast<float>(1 << 24);
+  }
+
+  const size_t kVoxels = static_cast<size_t>(width) * height * depth;
+  std::vector<float> noise(kVoxels);
+#pragma omp parallel for
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        float value = 0.0f, amplitude = 1.0f, total = 0.0f;
+        for (const Lattice &lattice : octaves) {
+          value += amplitude * lattice.Sample(x, y, z);
+          total += amplitude;
+          amplitude *= 0.5f;
+        }
+        noise[(static_cast<size_t>(z) * height + y) * width + x] =
+            value / total;
+      }
+    }
+  }
+
+  /* The threshold leaves the requested fraction of the voxels empty */
+  std::vector<size_t> histogram(kNoiseBins, 0);
+  for (float value : noise)
+    ++histogram[std::min(kNoiseBins - 1, static_cast<int>(value * kNoiseBins))];
+  const size_t kEmpty = static_cast<size_t>(sparsity * kVoxels);
+  size_t count = 0;
+  int bin = 0;
+  while (bin < kNoiseBins && count + histogram[bin] <= kEmpty)
+    count += histogram[bin++];
+  const float kThreshold = bin / static_cast<float>(kNoiseBins);
+
+#pragma omp parallel for
+  for (int z = 0; z < depth; ++z) {
+    const size_t kSlice = static_cast<size_t>(z) * width * height;
+    for (size_t i = kSlice; i < kSlice + static_cast<size_t>(width) * height;
+         ++i) {
+      const float kValue = noise[i];
+      (*voxels)[i] =
+          kValue < kThreshold
+              ? 0
+              : 1 + static_cast<unsigned char>(std::lround(
+                        254.0f * (kValue - kThreshold) / (1.0f - kThreshold)));
+    }
+  }
+}
+
+void GeneratePhantom(int width, int height, int depth, float sparsity,
+                     std::vector<unsigned char> *voxels) {
+  /* The skull covers this fraction of the volume when unscaled */
+  const Ellipsoid &kSkull = kPhantomEllipsoids[0];
+  const double kSkullFraction =
+      4.0 / 3.0 * kPi * kSkull.axes[0] * kSkull.axes[1] * kSkull.axes[2] / 8.0;
+  const double kMaxScale =
+      1.0 / std::max(kSkull.axes[0], std::max(kSkull.axes[1], kSkull.axes[2]));
+  const double kScale = std::min(
+      std::cbrt((1.0 - sparsity) / kSkullFraction), kMaxScale);
+
+  double cosines[10], sines[10];
+  for (int i = 0; i < 10; ++i) {
+    cosines[i] = std::cos(kPhantomEllipsoids[i].degrees * kPi / 180.0);
+    sines[i] = std::sin(kPhantomEllipsoids[i].degrees * kPi / 180.0);
+  }
+
+#pragma omp parallel for
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const double kPoint[3] = {(2.0 * (x + 0.5) / width - 1.0) / kScale,
+                                  (2.0 * (y + 0.5) / height - 1.0) / kScale,
+                                  (2.0 * (z + 0.5) / depth - 1.0) / kScale};
+        double density = 0.0;
+        for (int i = 0; i < 10; ++i) {
+          const Ellipsoid &kEllipsoid = kPhantomEllipsoids[i];
+          const double kX = kPoint[0] - kEllipsoid.center[0];
+          const double kY = kPoint[1] - kEllipsoid.center[1];
+          const double kZ = kPoint[2] - kEllipsoid.center[2];
+          const double kU = (cosines[i] * kX + sines[i] * kY) /
+                            kEllipsoid.axes[0];
+          const double kV = (-sines[i] * kX + cosines[i] * kY) /
+                            kEllipsoid.axes[1];
+          const double kW = kZ / kEllipsoid.axes[2];
+          if (kU * kU + kV * kV + kW * kW <= 1.0)
+            density += kEllipsoid.density;
+        }
+        (*voxels)[(static_cast<size_t>(z) * height + y) * width + x] =
+            ToByte(density);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void GenerateVolume(SyntheticShape shape, int width, int height, int depth,
+                    float sparsity, unsigned int seed,
+                    std::vector<unsigned char> *voxels) {
+  voxels->assign(static_cast<size_t>(width) * height * depth, 0);
+  sparsity = std::min(std::max(sparsity, 0.0f), 1.0f);
+
+  switch (shape) {
+    case kSphere:
+      GenerateSphere(width, height, depth, sparsity, voxels);
+      break;
+    case kNoise:
+      GenerateNoise(width, height, depth, sparsity, seed, voxels);
+      break;
+    case kPhantom:
+      GeneratePhantom(width, height, depth, sparsity, voxels);
+      break;
+  }
+}
+
+bool ParseSyntheticShape(const std::string &name, SyntheticShape *shape) {
+  if (name == "sphere")
+    *shape = kSphere;
+  else if (name == "noise")
+    *shape = kNoise;
+  else if (name == "phantom")
+    *shape = kPhantom;
+  else
+    return false;
+  return true;
+}
+
+}  // namespace data_representation
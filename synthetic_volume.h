@@ -0,0 +1,43 @@
+#ifndef SYNTHETIC_VOLUME_H_
+#define SYNTHETIC_VOLUME_H_
+
+#include <string>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief SyntheticShape The procedural volumes.
+ */
+enum SyntheticShape {
+  /* A ball whose density falls linearly from its center */
+  kSphere,
+  /* Fractal value noise, the densities below a threshold are empty */
+  kNoise,
+  /* The 3D modified Shepp-Logan head phantom, a CT-like set of ellipsoids */
+  kPhantom
+};
+
+/**
+ * @brief GenerateVolume Generates a procedural volume, the same one for the
+ * same arguments on every platform.
+ * @param sparsity Fraction of empty (zero) voxels. The sphere and the phantom
+ * are scaled to it as far as they fit in the volume, the noise threshold is
+ * placed at that quantile.
+ * @param seed Seed of the noise.
+ * @param voxels The voxels, width * height * depth bytes, x first.
+ */
+void GenerateVolume(SyntheticShape shape, int width, int height, int depth,
+                    float sparsity, unsigned int seed,
+                    std::vector<unsigned char> *voxels);
+
+/**
+ * @brief ParseSyntheticShape Reads a shape from its name, sphere, noise or
+ * phantom.
+ * @return Whether the name is a shape.
+ */
+bool ParseSyntheticShape(const std::string &name, SyntheticShape *shape);
+
+}  // namespace data_representation
+
+#endif  //  SYNTHETIC_VOLUME_H_
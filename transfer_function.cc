@@ -0,0 +1,116 @@
+#include <transfer_function.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace data_visualization {
+
+namespace {
+
+/* Samples per entry spanned, so that every entry is set */
+const double kSamplesPerEntry = 2.0;
+
+/* Bounds the samples of a curve dragged far outside the entries */
+const int kMaxSegments = 16 * kTransferFunctionEntries;
+
+}  // namespace
+
+TransferFunction::TransferFunction()
+    : values_(4 * kTransferFunctionEntries, 0.0f) {}
+
+int TransferFunction::AddCurve(int channel, int control_points) {
+  Curve curve;
+  curve.channel = channel;
+  curve.control_points.reserve(control_points);
+  curves_.push_back(curve);
+  return curves_.size() - 1;
+}
+
+bool TransferFunction::SetControlPoints(
+    int curve, const std::vector<Eigen::Vector2f> &control_points, int *first,
+    int *last) {
+  Curve &current = curves_[curve];
+  if (current.control_points == control_points) return false;
+  current.control_points = control_points;
+  EvaluateBezier(current.control_points, &current.samples);
+
+  *first = kTransferFunctionEntries;
+  *last = -1;
+  for (const Eigen::Vector2f &sample : current.samples) {
+    /* The user is free to move the nodes anywhere */
+    const int kEntry = static_cast<int>(sample.x());
+    if (kEntry < 0 || kEntry >= kTransferFunctionEntries) continue;
+
+    float &value = values_[4 * kEntry + current.channel];
+    const float kValue = std::min(std::max(sample.y(), 0.0f), 1.0f);
+    if (value == kValue) continue;
+    value = kValue;
+    *first = std::min(*first, kEntry);
+    *last = std::max(*last, kEntry);
+  }
+
+  return *first <= *last;
+}
+
+const std::vector<Eigen::Vector2f> &TransferFunction::GetSamples(
+    int curve) const {
+  return curves_[curve].samples;
+}
+
+const std::vector<float> &TransferFunction::GetValues() const {
+  return values_;
+}
+
+void TransferFunction::SetValues(const std::vector<float> &values) {
+  values_ = values;
+}
+
+void TransferFunction::EvaluateBezier(
+    const std::vector<Eigen::Vector2f> &control_points,
+    std::vector<Eigen::Vector2f> *samples) {
+  const int kCount = std::min<int>(control_points.size(), kMaxControlPoints);
+  if (kCount == 0) {
+    samples->clear();
+    return;
+  }
+  const int kDegree = kCount - 1;
+
+  /* The coefficients of t^j are C(n, j) sum_i (-1)^(j - i) C(j, i) P_i, row
+   * j of Pascal's triangle is built in place */
+  Eigen::Vector2d coefficients[kMaxControlPoints];
+  double pascal[kMaxControlPoints] = {1.0};
+  double binomial = 1.0;
+  for (int j = 0; j <= kDegree; ++j) {
+    if (j > 0) {
+      for (int i = j; i > 0; --i) pascal[i] += pascal[i - 1];
+      binomial = binomial * (kDegree - j + 1) / j;
+    }
+    Eigen::Vector2d sum = Eigen::Vector2d::Zero();
+    for (int i = 0; i <= j; ++i) {
+      const double kSign = (j - i) % 2 == 0 ? 1.0 : -1.0;
+      sum += kSign * pascal[i] * control_points[i].cast<double>();
+    }
+    coefficients[j] = binomial * sum;
+  }
+
+  /* |dx/dt| <= n max |x_i+1 - x_i| bounds the entries between samples */
+  double max_step = 0.0;
+  for (int i = 0; i < kDegree; ++i)
+    max_step = std::max(max_step, std::abs(static_cast<double>(
+                                      control_points[i + 1].x() -
+                                      control_points[i].x())));
+  const int kSegments = std::min(
+      kMaxSegments,
+      std::max(1, static_cast<int>(
+                      std::ceil(kSamplesPerEntry * kDegree * max_step))));
+
+  samples->resize(kSegments + 1);
+  for (int s = 0; s <= kSegments; ++s) {
+    const double kT = static_cast<double>(s) / kSegments;
+    Eigen::Vector2d point = coefficients[kDegree];
+    for (int j = kDegree - 1; j >= 0; --j) point = point * kT + coefficients[j];
+    (*samples)[s] = point.cast<float>();
+  }
+}
+
+}  // namespace data_visualization
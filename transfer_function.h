@@ -0,0 +1,94 @@
+#ifndef TRANSFER_FUNCTION_H_
+#define TRANSFER_FUNCTION_H_
+
+#include <eigen3/Eigen/Core>
+
+#include <vector>
+
+namespace data_visualization {
+
+/**
+ * @brief kTransferFunctionEntries Entries of the transfer function.
+ */
+const int kTransferFunctionEntries = 256;
+
+/**
+ * @brief kMaxControlPoints Control points of the longest curve.
+ */
+const int kMaxControlPoints = 16;
+
+/**
+ * @brief TransferFunction The rgba entries of the transfer function and the
+ * Bezier curves that set them, one channel per curve. The control points are
+ * in (entry, value) coordinates. A curve is only evaluated again when its
+ * control points move, into samples that cover every entry it spans, and
+ * each sample sets the channel of the entry it falls in.
+ */
+class TransferFunction {
+ public:
+  /**
+   * @brief TransferFunction Constructor of the class, every entry is zero.
+   */
+  TransferFunction();
+
+  /**
+   * @brief AddCurve Adds a curve of a channel (0 red, 1 green, 2 blue, 3
+   * alpha), set by its first SetControlPoints.
+   * @param control_points Number of control points, the degree plus one.
+   * @return The index of the curve.
+   */
+  int AddCurve(int channel, int control_points);
+
+  /**
+   * @brief SetControlPoints Moves the control points of a curve, and if they
+   * moved evaluates it and sets the entries it spans.
+   * @param first last The entries that changed, if any.
+   * @return Whether any entry changed.
+   */
+  bool SetControlPoints(int curve,
+                        const std::vector<Eigen::Vector2f> &control_points,
+                        int *first, int *last);
+
+  /**
+   * @brief GetSamples Returns the samples of a curve, in (entry, value)
+   * coordinates, unclamped.
+   */
+  const std::vector<Eigen::Vector2f> &GetSamples(int curve) const;
+
+  /**
+   * @brief GetValues Returns the entries, rgbargba...
+   */
+  const std::vector<float> &GetValues() const;
+
+  /**
+   * @brief SetValues Replaces the entries, until the curves move again.
+   */
+  void SetValues(const std::vector<float> &values);
+
+  /**
+   * @brief EvaluateBezier Samples a Bezier curve, at least two samples per
+   * entry it spans. The curve is converted once from the Bernstein to the
+   * power basis, and every sample is a Horner evaluation of it.
+   * @param control_points At most kMaxControlPoints.
+   * @param samples The samples, resized without releasing their capacity.
+   */
+  static void EvaluateBezier(const std::vector<Eigen::Vector2f> &control_points,
+                             std::vector<Eigen::Vector2f> *samples);
+
+ private:
+  /**
+   * @brief Curve A curve and its last evaluation.
+   */
+  struct Curve {
+    int channel;
+    std::vector<Eigen::Vector2f> control_points;
+    std::vector<Eigen::Vector2f> samples;
+  };
+
+  std::vector<Curve> curves_;
+  std::vector<float> values_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  TRANSFER_FUNCTION_H_
@@ -0,0 +1,202 @@
+#include <transfer_function_2d.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace data_visualization {
+
+namespace {
+
+const int kSize = kTransferFunction2DSize;
+
+/* Entries of a normalized coordinate range, clamped to the table */
+void EntryRange(float min, float max, int* first, int* last) {
+  *first = std::max(static_cast<int>(std::floor(min * (kSize - 1))), 0);
+  *last = std::min(static_cast<int>(std::ceil(max * (kSize - 1))), kSize - 1);
+}
+
+/* Adds [first, last] to the rectangle of entries [dirty_first, dirty_last]
+ * along an axis */
+void Widen(int first, int last, int* dirty_first, int* dirty_last) {
+  if (first > last) return;
+  if (*dirty_first > *dirty_last) {
+    *dirty_first = first;
+    *dirty_last = last;
+  } else {
+    *dirty_first = std::min(*dirty_first, first);
+    *dirty_last = std::max(*dirty_last, last);
+  }
+}
+
+}  // namespace
+
+TransferFunction2D::TransferFunction2D()
+    : table_(4 * kSize * kSize, 0.0f),
+      envelope_(4 * kSize, 0.0f),
+      dirty_first_{0, 0},
+      dirty_last_{-1, -1},
+      upload_first_{0, 0},
+      upload_last_{-1, -1},
+      texture_id_(0) {}
+
+TransferFunction2D::~TransferFunction2D() { Release(); }
+
+int TransferFunction2D::AddRegion(const TransferFunctionRegion& region) {
+  regions_.push_back(region);
+  MarkDirty(region);
+  return regions_.size() - 1;
+}
+
+void TransferFunction2D::SetRegion(int region,
+                                   const TransferFunctionRegion& value) {
+  /* The entries it leaves are cleared too */
+  MarkDirty(regions_[region]);
+  regions_[region] = value;
+  MarkDirty(value);
+}
+
+void TransferFunction2D::RemoveRegion(int region) {
+  MarkDirty(regions_[region]);
+  regions_.erase(regions_.begin() + region);
+}
+
+const std::vector<TransferFunctionRegion>& TransferFunction2D::GetRegions()
+    const {
+  return regions_;
+}
+
+void TransferFunction2D::MarkDirty(const TransferFunctionRegion& region) {
+  int first, last;
+  EntryRange(region.density_min, region.density_max, &first, &last);
+  if (first > last) return;
+  Widen(first, last, &dirty_first_[0], &dirty_last_[0]);
+  EntryRange(region.magnitude_min, region.magnitude_max, &first, &last);
+  Widen(first, last, &dirty_first_[1], &dirty_last_[1]);
+}
+
+bool TransferFunction2D::Compute() {
+  if (dirty_first_[0] > dirty_last_[0] || dirty_first_[1] > dirty_last_[1])
+    return false;
+
+  for (int j = dirty_first_[1]; j <= dirty_last_[1]; ++j) {
+    const float kMagnitude = static_cast<float>(j) / (kSize - 1);
+    for (int i = dirty_first_[0]; i <= dirty_last_[0]; ++i) {
+      const float kDensity = static_cast<float>(i) / (kSize - 1);
+
+      /* The colors are weighted by their opacity, and the opacities combine
+       * as if the regions were layers of one sample */
+      float color[3] = {0.0f, 0.0f, 0.0f};
+      float weight = 0.0f, transparency = 1.0f;
+      for (const TransferFunctionRegion& region : regions_) {
+        const float kHalfWidth =
+            0.5f * (region.density_max - region.density_min);
+        if (kHalfWidth <= 0.0f || kMagnitude < region.magnitude_min ||
+            kMagnitude > region.magnitude_max)
+          continue;
+
+        const float kCenter = region.density_min + kHalfWidth;
+        const float kAlpha =
+            region.color[3] *
+            (1.0f - std::abs(kDensity - kCenter) / kHalfWidth);
+        if (kAlpha <= 0.0f) continue;
+        for (int c = 0; c < 3; ++c) color[c] += kAlpha * region.color[c];
+        weight += kAlpha;
+        transparency *= 1.0f - std::min(kAlpha, 1.0f);
+      }
+
+      float* entry = &table_[4 * (j * kSize + i)];
+      for (int c = 0; c < 3; ++c)
+        entry[c] = weight > 0.0f ? color[c] / weight : 0.0f;
+      entry[3] = 1.0f - transparency;
+    }
+  }
+
+  ComputeEnvelope(table_, dirty_first_[0], dirty_last_[0], &envelope_);
+  for (int axis = 0; axis < 2; ++axis) {
+    Widen(dirty_first_[axis], dirty_last_[axis], &upload_first_[axis],
+          &upload_last_[axis]);
+    dirty_first_[axis] = 0;
+    dirty_last_[axis] = -1;
+  }
+  return true;
+}
+
+bool TransferFunction2D::IsDirty() const {
+  return texture_id_ == 0 ||
+         (dirty_first_[0] <= dirty_last_[0] &&
+          dirty_first_[1] <= dirty_last_[1]) ||
+         (upload_first_[0] <= upload_last_[0] &&
+          upload_first_[1] <= upload_last_[1]);
+}
+
+bool TransferFunction2D::Update() {
+  Compute();
+
+  if (texture_id_ == 0) {
+    glGenTextures(1, &texture_id_);
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    if (GLEW_ARB_texture_storage)
+      glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, kSize, kSize);
+    else
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, kSize, kSize, 0, GL_RGBA,
+                   GL_FLOAT, nullptr);
+    for (int axis = 0; axis < 2; ++axis) {
+      upload_first_[axis] = 0;
+      upload_last_[axis] = kSize - 1;
+    }
+  }
+
+  if (upload_first_[0] > upload_last_[0] ||
+      upload_first_[1] > upload_last_[1])
+    return false;
+
+  /* The rows of the rectangle are read in place from the table */
+  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, kSize);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, upload_first_[0], upload_first_[1],
+                  upload_last_[0] - upload_first_[0] + 1,
+                  upload_last_[1] - upload_first_[1] + 1, GL_RGBA, GL_FLOAT,
+                  &table_[4 * (upload_first_[1] * kSize + upload_first_[0])]);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+  for (int axis = 0; axis < 2; ++axis) {
+    upload_first_[axis] = 0;
+    upload_last_[axis] = -1;
+  }
+  return true;
+}
+
+void TransferFunction2D::Release() {
+  if (texture_id_ != 0) glDeleteTextures(1, &texture_id_);
+  texture_id_ = 0;
+}
+
+GLuint TransferFunction2D::GetTextureId() const { return texture_id_; }
+
+const std::vector<float>& TransferFunction2D::GetTable() const {
+  return table_;
+}
+
+const std::vector<float>& TransferFunction2D::GetEnvelope() const {
+  return envelope_;
+}
+
+void TransferFunction2D::ComputeEnvelope(const std::vector<float>& table,
+                                         int first, int last,
+                                         std::vector<float>* envelope) {
+  for (int i = first; i <= last; ++i) {
+    const float* most_opaque = &table[4 * i];
+    for (int j = 1; j < kSize; ++j) {
+      const float* kEntry = &table[4 * (j * kSize + i)];
+      if (kEntry[3] > most_opaque[3]) most_opaque = kEntry;
+    }
+    std::copy_n(most_opaque, 4, &(*envelope)[4 * i]);
+  }
+}
+
+}  // namespace data_visualization
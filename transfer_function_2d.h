@@ -0,0 +1,153 @@
+#ifndef TRANSFER_FUNCTION_2D_H_
+#define TRANSFER_FUNCTION_2D_H_
+
+#include <GL/glew.h>
+
+#include <vector>
+
+namespace data_visualization {
+
+/**
+ * @brief kTransferFunction2DSize Entries of the 2D transfer function along
+ * each axis, one per density and one per packed gradient magnitude.
+ */
+const int kTransferFunction2DSize = 256;
+
+/**
+ * @brief TransferFunctionRegion A rectangle of the 2D transfer function, in
+ * normalized density and gradient magnitude, and its color and opacity. The
+ * opacity is highest at the center density and fades linearly to zero at the
+ * density bounds, so that a narrow region picks the boundary between two
+ * materials at the magnitudes the boundary spans.
+ */
+struct TransferFunctionRegion {
+  float density_min = 0.0f;
+  float density_max = 0.0f;
+  float magnitude_min = 0.0f;
+  float magnitude_max = 0.0f;
+  float color[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+/**
+ * @brief TransferFunction2D Color and opacity by density and gradient
+ * magnitude, as the sum of a set of regions, rasterized into a table and a 2D
+ * texture. Only the entries under the regions that changed are rasterized and
+ * uploaded again. The ray marcher looks it up with the magnitude of the
+ * gradient texel it fetches for the shading.
+ */
+class TransferFunction2D {
+ public:
+  /**
+   * @brief TransferFunction2D Constructor of the class, every entry is zero.
+   */
+  TransferFunction2D();
+
+  /**
+   * @brief ~TransferFunction2D Destructor of the class. Calls Release.
+   */
+  ~TransferFunction2D();
+
+  TransferFunction2D(const TransferFunction2D&) = delete;
+  TransferFunction2D& operator=(const TransferFunction2D&) = delete;
+
+  /**
+   * @brief AddRegion Adds a region.
+   * @return The index of the region.
+   */
+  int AddRegion(const TransferFunctionRegion& region);
+
+  /**
+   * @brief SetRegion Moves, resizes or recolors a region.
+   */
+  void SetRegion(int region, const TransferFunctionRegion& value);
+
+  /**
+   * @brief RemoveRegion Removes a region, the next ones move down one index.
+   */
+  void RemoveRegion(int region);
+
+  /**
+   * @brief GetRegions Returns the regions.
+   */
+  const std::vector<TransferFunctionRegion>& GetRegions() const;
+
+  /**
+   * @brief Compute Rasterizes the entries under the regions that changed
+   * since the last call, and the envelope of their densities.
+   * @return Whether any entry changed.
+   */
+  bool Compute();
+
+  /**
+   * @brief IsDirty Returns whether the next Update uploads.
+   */
+  bool IsDirty() const;
+
+  /**
+   * @brief Update Computes the table and uploads the entries that changed, or
+   * every entry the first time. Requires the GL context to be current.
+   * @return Whether the texture changed.
+   */
+  bool Update();
+
+  /**
+   * @brief Release Deletes the texture.
+   */
+  void Release();
+
+  /**
+   * @brief GetTextureId Returns the id of the 2D texture, indexed by density
+   * along s and gradient magnitude along t.
+   */
+  GLuint GetTextureId() const;
+
+  /**
+   * @brief GetTable Returns the entries rgba, rows by gradient magnitude.
+   */
+  const std::vector<float>& GetTable() const;
+
+  /**
+   * @brief GetEnvelope Returns a 1D transfer function, rgbargba..., holding
+   * at every density the most opaque entry over all the magnitudes. The
+   * occupancy grid and the bricks classified with it keep every voxel that
+   * is visible under the 2D transfer function.
+   */
+  const std::vector<float>& GetEnvelope() const;
+
+  /**
+   * @brief ComputeEnvelope Sets the densities [first, last] of the envelope
+   * of a table (see GetEnvelope).
+   * @param table Entries rgba, kTransferFunction2DSize rows by magnitude.
+   * @param envelope kTransferFunction2DSize entries rgba.
+   */
+  static void ComputeEnvelope(const std::vector<float>& table, int first,
+                              int last, std::vector<float>* envelope);
+
+ private:
+  /**
+   * @brief MarkDirty Adds the entries under a region to the rectangle to
+   * rasterize.
+   */
+  void MarkDirty(const TransferFunctionRegion& region);
+
+  std::vector<TransferFunctionRegion> regions_;
+
+  /**
+   * @brief table_ Entries rgba, rows by gradient magnitude.
+   */
+  std::vector<float> table_;
+  std::vector<float> envelope_;
+
+  /* Entries to rasterize, and to upload, from first to last density (0) and
+   * magnitude (1), empty if first > last */
+  int dirty_first_[2];
+  int dirty_last_[2];
+  int upload_first_[2];
+  int upload_last_[2];
+
+  GLuint texture_id_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  TRANSFER_FUNCTION_2D_H_
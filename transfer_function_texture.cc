@@ -0,0 +1,121 @@
+#include <transfer_function_texture.h>
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace data_visualization {
+
+namespace {
+
+/* Internal format, and bytes and type of a channel of the uploaded data */
+const GLenum kInternalFormats[] = {GL_RGBA32F, GL_RGBA16F, GL_RGBA8};
+const size_t kChannelBytes[] = {4, 2, 1};
+const GLenum kChannelTypes[] = {GL_FLOAT, GL_HALF_FLOAT, GL_UNSIGNED_BYTE};
+
+}  // namespace
+
+TransferFunctionTexture::TransferFunctionTexture()
+    : format_(kTransferFunctionRgba32f),
+      size_(0),
+      dirty_first_(0),
+      dirty_last_(-1),
+      texture_id_(0) {}
+
+TransferFunctionTexture::~TransferFunctionTexture() { Release(); }
+
+void TransferFunctionTexture::SetFormat(TransferFunctionFormat format) {
+  if (format == format_) return;
+  format_ = format;
+  /* Reallocated by the next update, with the context current */
+  size_ = 0;
+}
+
+void TransferFunctionTexture::MarkDirty(int first, int last) {
+  if (first > last) return;
+  if (dirty_first_ > dirty_last_) {
+    dirty_first_ = first;
+    dirty_last_ = last;
+  } else {
+    dirty_first_ = std::min(dirty_first_, first);
+    dirty_last_ = std::max(dirty_last_, last);
+  }
+}
+
+bool TransferFunctionTexture::IsDirty() const {
+  return size_ == 0 || dirty_first_ <= dirty_last_;
+}
+
+bool TransferFunctionTexture::Update(
+    const std::vector<float>& transfer_function) {
+  const int kSize = transfer_function.size() / 4;
+  if (kSize != size_) {
+    Release();
+    Allocate(kSize);
+    dirty_first_ = 0;
+    dirty_last_ = kSize - 1;
+  }
+
+  const int kFirst = std::max(dirty_first_, 0);
+  const int kLast = std::min(dirty_last_, kSize - 1);
+  dirty_first_ = 0;
+  dirty_last_ = -1;
+  if (kFirst > kLast) return false;
+
+  /* The entries are converted here so that only their bytes are sent */
+  const float* kValues = &transfer_function[4 * kFirst];
+  const size_t kChannels = 4 * (kLast - kFirst + 1);
+  const size_t kBytes = kChannels * kChannelBytes[format_];
+  staging_.resize(std::max(staging_.size(), kBytes));
+  switch (format_) {
+    case kTransferFunctionRgba32f:
+      std::memcpy(staging_.data(), kValues, kBytes);
+      break;
+    case kTransferFunctionRgba16f:
+      for (size_t i = 0; i < kChannels; ++i) {
+        const glm::uint16 kHalf = glm::packHalf1x16(kValues[i]);
+        std::memcpy(&staging_[2 * i], &kHalf, 2);
+      }
+      break;
+    case kTransferFunctionRgba8:
+      for (size_t i = 0; i < kChannels; ++i)
+        staging_[i] = static_cast<unsigned char>(
+            std::lround(255.0f * std::min(std::max(kValues[i], 0.0f), 1.0f)));
+      break;
+  }
+
+  glBindTexture(GL_TEXTURE_1D, texture_id_);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage1D(GL_TEXTURE_1D, 0, kFirst, kLast - kFirst + 1, GL_RGBA,
+                  kChannelTypes[format_], staging_.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  return true;
+}
+
+void TransferFunctionTexture::Allocate(int size) {
+  glGenTextures(1, &texture_id_);
+  glBindTexture(GL_TEXTURE_1D, texture_id_);
+  /* Set border style to clamp */
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAX_LEVEL, 0);
+  if (GLEW_ARB_texture_storage)
+    glTexStorage1D(GL_TEXTURE_1D, 1, kInternalFormats[format_], size);
+  else
+    glTexImage1D(GL_TEXTURE_1D, 0, kInternalFormats[format_], size, 0,
+                 GL_RGBA, kChannelTypes[format_], nullptr);
+  size_ = size;
+}
+
+void TransferFunctionTexture::Release() {
+  if (texture_id_ != 0) glDeleteTextures(1, &texture_id_);
+  texture_id_ = 0;
+  size_ = 0;
+}
+
+GLuint TransferFunctionTexture::GetTextureId() const { return texture_id_; }
+
+}  // namespace data_visualization
@@ -0,0 +1,105 @@
+#ifndef TRANSFER_FUNCTION_TEXTURE_H_
+#define TRANSFER_FUNCTION_TEXTURE_H_
+
+#include <GL/glew.h>
+
+#include <vector>
+
+namespace data_visualization {
+
+/**
+ * @brief TransferFunctionFormat Internal format of the transfer function
+ * texture. The compact formats upload less, RGBA8 quantizes the small
+ * opacities of translucent transfer functions.
+ */
+enum TransferFunctionFormat {
+  kTransferFunctionRgba32f = 0,
+  kTransferFunctionRgba16f = 1,
+  kTransferFunctionRgba8 = 2
+};
+
+/**
+ * @brief TransferFunctionTexture The transfer function as a 1D texture with
+ * immutable storage, allocated once per size and format. The entries that
+ * changed are tracked as a dirty range and flushed with a single
+ * glTexSubImage1D, converted on the CPU to the texture format so that only
+ * the bytes of the changed entries are transferred.
+ */
+class TransferFunctionTexture {
+ public:
+  /**
+   * @brief TransferFunctionTexture Constructor of the class.
+   */
+  TransferFunctionTexture();
+
+  /**
+   * @brief ~TransferFunctionTexture Destructor of the class. Calls Release.
+   */
+  ~TransferFunctionTexture();
+
+  TransferFunctionTexture(const TransferFunctionTexture&) = delete;
+  TransferFunctionTexture& operator=(const TransferFunctionTexture&) = delete;
+
+  /**
+   * @brief SetFormat Sets the internal format, the texture is allocated
+   * again and filled by the next Update if it changed.
+   */
+  void SetFormat(TransferFunctionFormat format);
+
+  /**
+   * @brief MarkDirty Adds the entries [first, last] to the range to upload.
+   */
+  void MarkDirty(int first, int last);
+
+  /**
+   * @brief IsDirty Returns whether the next Update uploads.
+   */
+  bool IsDirty() const;
+
+  /**
+   * @brief Update Uploads the dirty entries, or allocates the texture and
+   * uploads every entry if the size or the format changed. Requires the GL
+   * context to be current.
+   * @param transfer_function The transfer function values, rgbargba...
+   * @return Whether the texture changed.
+   */
+  bool Update(const std::vector<float>& transfer_function);
+
+  /**
+   * @brief Release Deletes the texture.
+   */
+  void Release();
+
+  /**
+   * @brief GetTextureId Returns the id of the texture, bound to
+   * GL_TEXTURE_1D.
+   */
+  GLuint GetTextureId() const;
+
+ private:
+  /**
+   * @brief Allocate Creates the texture for size entries in the current
+   * format.
+   */
+  void Allocate(int size);
+
+  TransferFunctionFormat format_;
+
+  /* Entries of the allocated texture, 0 if there is none */
+  int size_;
+
+  /* Range of entries to upload, empty if first > last */
+  int dirty_first_;
+  int dirty_last_;
+
+  /**
+   * @brief staging_ The dirty entries converted to the texture format.
+   */
+  std::vector<unsigned char> staging_;
+
+  GLuint texture_id_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  TRANSFER_FUNCTION_TEXTURE_H_
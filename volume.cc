@@ -5,20 +5,36 @@
 #include <algorithm>
 #include <limits>
 
+#include "./brick_cache.h"
+#include "./occupancy_grid.h"
+
 namespace data_representation {
 
-Volume::Volume() : width_(0), height_(0), depth_(0), id_(0) {}
+Volume::Volume()
+    : width_(0), height_(0), depth_(0), id_(0), gradient_id_(0) {}
 
 Volume::~Volume() { Clear(); }
 
 void Volume::Clear() {
   histogram_.clear();
+  joint_histogram_.clear();
   width_ = 0;
   height_ = 0;
   depth_ = 0;
+  if (id_ != 0) glDeleteTextures(1, &id_);
   id_ = 0;
+  if (gradient_id_ != 0) glDeleteTextures(1, &gradient_id_);
+  gradient_id_ = 0;
+  brick_cache_.reset();
+  occupancy_.reset();
 }
 
 GLuint Volume::GetTextureId() { return id_; }
 
+GLuint Volume::GetGradientTextureId() { return gradient_id_; }
+
+BrickCache* Volume::GetBrickCache() { return brick_cache_.get(); }
+
+OccupancyGrid* Volume::GetOccupancyGrid() { return occupancy_.get(); }
+
 }  // namespace data_representation
@@ -7,11 +7,15 @@
 
 #include <eigen3/Eigen/Geometry>
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace data_representation {
 
+class BrickCache;
+class OccupancyGrid;
+
 class Volume {
  public:
   /**
@@ -25,8 +29,8 @@ class Volume {
   ~Volume();
 
   /**
-   * @brief Clear Empties the data arrays and resets the bounding box
-   * vertices.
+   * @brief Clear Empties the data arrays, deletes the 3D textures and resets
+   * the bounding box vertices. Requires the GL context to be current.
    */
   void Clear();
 
@@ -37,15 +41,46 @@ class Volume {
    */
   GLuint GetTextureId();
 
+  /**
+   * @brief GetGradientTextureId Returns the id of the 3D texture holding the
+   * packed gradients of this volume (see ComputeGradients), or 0 if they were
+   * not computed.
+   */
+  GLuint GetGradientTextureId();
+
+  /**
+   * @brief GetBrickCache Returns the bricks of an out-of-core volume, or
+   * nullptr if the whole volume is stored in the 3D texture. For out-of-core
+   * volumes the 3D texture holds a downsampled overview.
+   */
+  BrickCache* GetBrickCache();
+
+  /**
+   * @brief GetOccupancyGrid Returns the occupancy grid used to skip empty
+   * space, or nullptr while the volume is being loaded.
+   */
+  OccupancyGrid* GetOccupancyGrid();
+
   friend bool ReadFromDicom(const std::string& path, Volume* vol);
+  friend class VolumeLoader;
 
  public:
   std::vector<double> histogram_;
 
+  /**
+   * @brief joint_histogram_ Normalized joint histogram of the densities and
+   * the gradient magnitudes (see AccumulateJointHistogram), empty if the
+   * gradients were not computed.
+   */
+  std::vector<double> joint_histogram_;
+
   int width_, height_, depth_;
 
  private:
   GLuint id_;
+  GLuint gradient_id_;
+  std::unique_ptr<BrickCache> brick_cache_;
+  std::unique_ptr<OccupancyGrid> occupancy_;
 };
 
 }  // namespace data_representation
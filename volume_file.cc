@@ -0,0 +1,176 @@
+#include <volume_file.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace data_representation {
+
+namespace {
+
+const char kMagic[8] = {'V', 'R', 'V', 'O', 'L', 0, 0, 0};
+const uint32_t kVersion = 1;
+const uint64_t kDataAlignment = 4096;
+
+size_t VoxelCount(const VolumeFileHeader& header) {
+  return static_cast<size_t>(header.width) * header.height * header.depth;
+}
+
+}  // namespace
+
+VolumeFile::VolumeFile() : mapping_(nullptr), mapping_size_(0) {}
+
+VolumeFile::~VolumeFile() { Close(); }
+
+bool VolumeFile::Open(const std::string& filename) {
+  Close();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      static_cast<size_t>(file_stat.st_size) < sizeof(VolumeFileHeader)) {
+    close(fd);
+    return false;
+  }
+
+  mapping_size_ = file_stat.st_size;
+  mapping_ = mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    return false;
+  }
+
+  const VolumeFileHeader& header = GetHeader();
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.voxel_type != kVoxelUnsigned8 ||
+      header.width <= 0 || header.height <= 0 || header.depth <= 0 ||
+      header.data_offset + VoxelCount(header) > mapping_size_) {
+    std::cerr << "Invalid volume file " << filename << std::endl;
+    Close();
+    return false;
+  }
+
+  /* The voxels are read front to back by the upload */
+  madvise(mapping_, mapping_size_, MADV_SEQUENTIAL);
+
+  return true;
+}
+
+void VolumeFile::Close() {
+  if (mapping_ != nullptr) munmap(mapping_, mapping_size_);
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+}
+
+bool VolumeFile::IsOpen() const { return mapping_ != nullptr; }
+
+const VolumeFileHeader& VolumeFile::GetHeader() const {
+  return *static_cast<const VolumeFileHeader*>(mapping_);
+}
+
+const unsigned char* VolumeFile::GetData() const {
+  return static_cast<const unsigned char*>(mapping_) +
+         GetHeader().data_offset;
+}
+
+size_t VolumeFile::GetDataSize() const { return VoxelCount(GetHeader()); }
+
+void VolumeFile::InitHeader(int width, int height, int depth,
+                            uint64_t source_key, VolumeFileHeader* header) {
+  std::memset(header, 0, sizeof(VolumeFileHeader));
+  std::memcpy(header->magic, kMagic, sizeof(kMagic));
+  header->version = kVersion;
+  header->voxel_type = kVoxelUnsigned8;
+  header->width = width;
+  header->height = height;
+  header->depth = depth;
+  /* Image stacks carry no spacing information, assume isotropic voxels */
+  header->spacing[0] = header->spacing[1] = header->spacing[2] = 1.0f;
+  header->source_key = source_key;
+  header->data_offset =
+      (sizeof(VolumeFileHeader) + kDataAlignment - 1) / kDataAlignment *
+      kDataAlignment;
+}
+
+bool VolumeFile::Write(const std::string& filename,
+                       const VolumeFileHeader& header,
+                       const unsigned char* data) {
+  VolumeFileWriter writer;
+  return writer.Open(filename, header) &&
+         writer.Append(data, VoxelCount(header)) &&
+         writer.Finish(header.histogram);
+}
+
+VolumeFileWriter::VolumeFileWriter() : written_(0) {}
+
+VolumeFileWriter::~VolumeFileWriter() { Abort(); }
+
+bool VolumeFileWriter::Open(const std::string& filename,
+                            const VolumeFileHeader& header) {
+  Abort();
+
+  filename_ = filename;
+  header_ = header;
+  written_ = 0;
+
+  outfile_.open((filename_ + ".tmp").c_str(), std::ios::binary);
+  if (!outfile_.is_open()) return false;
+
+  std::vector<char> padding(header_.data_offset - sizeof(VolumeFileHeader), 0);
+  outfile_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+  outfile_.write(padding.data(), padding.size());
+
+  return outfile_.good();
+}
+
+bool VolumeFileWriter::Append(const unsigned char* data, size_t size) {
+  if (!outfile_.is_open()) return false;
+
+  outfile_.write(reinterpret_cast<const char*>(data), size);
+  written_ += size;
+
+  return outfile_.good();
+}
+
+bool VolumeFileWriter::Finish(const double* histogram) {
+  if (!outfile_.is_open()) return false;
+
+  if (written_ != VoxelCount(header_)) {
+    Abort();
+    return false;
+  }
+
+  std::copy(histogram, histogram + 256, header_.histogram);
+  outfile_.seekp(0);
+  outfile_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+  outfile_.close();
+
+  const std::string kTemporary = filename_ + ".tmp";
+  if (!outfile_.good() || std::rename(kTemporary.c_str(), filename_.c_str())) {
+    std::remove(kTemporary.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void VolumeFileWriter::Abort() {
+  if (!outfile_.is_open()) return;
+
+  outfile_.close();
+  std::remove((filename_ + ".tmp").c_str());
+}
+
+}  // namespace data_representation
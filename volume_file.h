@@ -0,0 +1,159 @@
+#ifndef VOLUME_FILE_H_
+#define VOLUME_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace data_representation {
+
+/**
+ * @brief VoxelType Type of the voxels stored in a volume file.
+ */
+enum VoxelType : uint32_t { kVoxelUnsigned8 = 0 };
+
+/**
+ * @brief VolumeFileHeader Header of the native volume format. It is followed,
+ * at data_offset (a multiple of the page size), by the raw voxels in x, y, z
+ * order.
+ */
+struct VolumeFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t voxel_type;
+  int32_t width;
+  int32_t height;
+  int32_t depth;
+  float spacing[3];
+  uint64_t source_key;
+  uint64_t data_offset;
+  double histogram[256];
+};
+
+/**
+ * @brief VolumeFile A read only, memory mapped volume in the native format.
+ */
+class VolumeFile {
+ public:
+  /**
+   * @brief VolumeFile Constructor of the class.
+   */
+  VolumeFile();
+
+  /**
+   * @brief ~VolumeFile Destructor of the class. Unmaps the file.
+   */
+  ~VolumeFile();
+
+  VolumeFile(const VolumeFile&) = delete;
+  VolumeFile& operator=(const VolumeFile&) = delete;
+
+  /**
+   * @brief Open Maps a volume file and validates its header.
+   * @param filename Path to the volume file.
+   * @return Whether the file is a valid volume.
+   */
+  bool Open(const std::string& filename);
+
+  /**
+   * @brief Close Unmaps the file, if any.
+   */
+  void Close();
+
+  /**
+   * @brief IsOpen Whether a file is currently mapped.
+   */
+  bool IsOpen() const;
+
+  /**
+   * @brief GetHeader Returns the header of the mapped file.
+   */
+  const VolumeFileHeader& GetHeader() const;
+
+  /**
+   * @brief GetData Returns a pointer to the mapped voxels.
+   */
+  const unsigned char* GetData() const;
+
+  /**
+   * @brief GetDataSize Returns the size of the voxel data, in bytes.
+   */
+  size_t GetDataSize() const;
+
+  /**
+   * @brief InitHeader Fills a header with the magic, version and data offset
+   * for a volume of the given dimensions.
+   */
+  static void InitHeader(int width, int height, int depth, uint64_t source_key,
+                         VolumeFileHeader* header);
+
+  /**
+   * @brief Write Writes a volume file. The file is written under a temporary
+   * name and renamed, so readers never map a partial file.
+   * @param filename Path to the volume file.
+   * @param header A header initialized with InitHeader.
+   * @param data The voxels.
+   * @return Whether the file could be written.
+   */
+  static bool Write(const std::string& filename, const VolumeFileHeader& header,
+                    const unsigned char* data);
+
+ private:
+  void* mapping_;
+  size_t mapping_size_;
+};
+
+/**
+ * @brief VolumeFileWriter Writes a volume file incrementally, so that a volume
+ * can be cached while it is streamed without holding all its voxels.
+ */
+class VolumeFileWriter {
+ public:
+  /**
+   * @brief VolumeFileWriter Constructor of the class.
+   */
+  VolumeFileWriter();
+
+  /**
+   * @brief ~VolumeFileWriter Destructor of the class. Discards the file if it
+   * was not finished.
+   */
+  ~VolumeFileWriter();
+
+  /**
+   * @brief Open Starts writing a volume file under a temporary name.
+   * @param filename Path to the volume file.
+   * @param header A header initialized with VolumeFile::InitHeader.
+   * @return Whether the file could be created.
+   */
+  bool Open(const std::string& filename, const VolumeFileHeader& header);
+
+  /**
+   * @brief Append Appends voxels, in x, y, z order.
+   */
+  bool Append(const unsigned char* data, size_t size);
+
+  /**
+   * @brief Finish Rewrites the header with the final histogram and renames the
+   * file, so readers never map a partial file.
+   * @param histogram The 256 bins histogram of the volume.
+   * @return Whether the file was completely written.
+   */
+  bool Finish(const double* histogram);
+
+  /**
+   * @brief Abort Discards the file being written.
+   */
+  void Abort();
+
+ private:
+  std::string filename_;
+  std::ofstream outfile_;
+  VolumeFileHeader header_;
+  size_t written_;
+};
+
+}  // namespace data_representation
+
+#endif  //  VOLUME_FILE_H_
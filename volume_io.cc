@@ -5,13 +5,27 @@
 #include <boost/filesystem.hpp>
 
 #include <QImage>
+#include <QImageReader>
+
+#include <omp.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "./occupancy_grid.h"
 #include "./volume.h"
+#include "./volume_file.h"
+#include "./volume_stream.h"
 
 namespace data_representation {
 
@@ -25,83 +39,619 @@ bool compare(const boost::filesystem::path& a,
     return a.size() < b.size();
 }
 
-}  // namespace
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
 
-bool ReadFromDicom(const std::string& path, Volume* vol) {
-  const boost::filesystem::path kDir = boost::filesystem::path(path);
+/**
+ * @brief DecodeSlice Decodes one slice straight into its place in the voxel
+ * buffer, one scanline at a time.
+ * @param file_path Path to the slice image.
+ * @param width Expected slice width.
+ * @param height Expected slice height.
+ * @param slice Destination of width * height voxels.
+ * @return Whether the slice could be decoded and has the expected size.
+ */
+bool DecodeSlice(const boost::filesystem::path& file_path, int width,
+                 int height, uchar* slice) {
+  QImage img(QString::fromStdString(file_path.string()));
 
-  if (!boost::filesystem::exists(kDir) ||
-      !boost::filesystem::is_directory(kDir))
+  if (img.isNull() || img.width() != width || img.height() != height)
     return false;
-  vol->histogram_.clear();
-  vol->histogram_.resize(256, 0);
 
-  std::vector<boost::filesystem::path> paths(
-      boost::filesystem::directory_iterator{kDir},
-      boost::filesystem::directory_iterator{});
-  std::sort(paths.begin(), paths.end(), compare);
+  if (img.format() == QImage::Format_Grayscale8) {
+    for (int y = 0; y < height; ++y)
+      std::memcpy(slice + static_cast<size_t>(y) * width, img.constScanLine(y),
+                  width);
+    return true;
+  }
+
+  /* Any other format keeps the lowest byte of the 32 bit pixel, as
+   * QImage::pixel() & 0xFF did */
+  if (img.format() != QImage::Format_RGB32)
+    img = img.convertToFormat(QImage::Format_RGB32);
+
+  for (int y = 0; y < height; ++y) {
+    const QRgb* line = reinterpret_cast<const QRgb*>(img.constScanLine(y));
+    uchar* dst = slice + static_cast<size_t>(y) * width;
+    for (int x = 0; x < width; ++x) dst[x] = line[x] & 0xFF;
+  }
+
+  return true;
+}
+
+void SetTextureParameters() {
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP);
+}
+
+int MipLevels(int width, int height, int depth) {
+  int levels = 1;
+  for (int size = std::max(width, std::max(height, depth)); size > 1;
+       size /= 2)
+    ++levels;
+  return levels;
+}
+
+/**
+ * @brief UploadTexture Generates the 3D texture of a volume.
+ * @param data The voxels, width * height * depth bytes.
+ * @return The 3D texture id.
+ */
+GLuint UploadTexture(const uchar* data, int width, int height, int depth) {
+  GLuint id;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_3D, id);
+  SetTextureParameters();
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_RED, width, height, depth, 0, GL_RED,
+               GL_UNSIGNED_BYTE, data);
+  glGenerateMipmap(GL_TEXTURE_3D);
+  glFinish();
+
+  return id;
+}
+
+void PrintLoadTimes(const LoadTimes& times) {
+  std::cout << "Load time (ms): scan " << times.scan << ", decode "
+            << times.decode << ", histogram " << times.histogram
+            << ", occupancy " << times.occupancy << ", gradients "
+            << times.gradients << ", cache " << times.cache << ", upload "
+            << times.upload << std::endl;
+}
+
+/**
+ * @brief UploadGradients Computes the gradients of a volume and their joint
+ * histogram with the densities, and generates their 3D texture.
+ * @param joint_histogram The normalized joint histogram.
+ * @return The 3D texture id.
+ */
+GLuint UploadGradients(const uchar* data, int width, int height, int depth,
+                       std::vector<double>* joint_histogram) {
+  const size_t kSize = static_cast<size_t>(width) * height * depth;
+  std::vector<uchar> gradients(4 * kSize);
+  ComputeGradients(data, width, height, depth, gradients.data());
 
-  vol->depth_ = 0;
-  std::vector<uchar> data;
-  for (auto const& file_path : paths) {
+  joint_histogram->assign(kHistogramSize * kHistogramSize, 0.0);
+  AccumulateJointHistogram(data, gradients.data(), kSize, joint_histogram);
+  NormalizeJointHistogram(joint_histogram);
+
+  return CreateGradientTexture(gradients.data(), width, height, depth);
+}
+
+}  // namespace
+
+bool ScanDicomDirectory(const boost::filesystem::path& dir,
+                        std::vector<boost::filesystem::path>* slices) {
+  if (!boost::filesystem::exists(dir) || !boost::filesystem::is_directory(dir))
+    return false;
+
+  slices->clear();
+  for (boost::filesystem::directory_iterator it(dir), end; it != end; ++it) {
+    const boost::filesystem::path& file_path = it->path();
     if (boost::filesystem::is_regular_file(file_path) &&
-        file_path.extension() == ".jpg") {
-      std::cout << file_path.string() << std::endl;
+        file_path.extension() == ".jpg")
+      slices->push_back(file_path);
+  }
+  std::sort(slices->begin(), slices->end(), compare);
 
-      QImage img(QString::fromStdString(file_path.string()));
+  return !slices->empty();
+}
 
-      if (img.isNull()) return false;
+uint64_t DicomSourceKey(const boost::filesystem::path& dir,
+                        const std::vector<boost::filesystem::path>& slices) {
+  uint64_t key = 14695981039346656037ULL;
+  auto hash = [&key](const void* bytes, size_t size) {
+    const unsigned char* data = static_cast<const unsigned char*>(bytes);
+    for (size_t i = 0; i < size; ++i) {
+      key ^= data[i];
+      key *= 1099511628211ULL;
+    }
+  };
 
-      if (vol->depth_ == 0) {
-        vol->width_ = img.width();
-        vol->height_ = img.height();
-      } else if (vol->width_ != img.width() || vol->height_ != img.height()) {
-        return false;
-      }
+  const std::string kDir = boost::filesystem::absolute(dir).string();
+  hash(kDir.data(), kDir.size());
+  for (auto const& file_path : slices) {
+    const std::string kName = file_path.filename().string();
+    const uint64_t kSize = boost::filesystem::file_size(file_path);
+    const int64_t kTime = boost::filesystem::last_write_time(file_path);
+    hash(kName.data(), kName.size());
+    hash(&kSize, sizeof(kSize));
+    hash(&kTime, sizeof(kTime));
+  }
 
-      vol->depth_++;
+  return key;
+}
 
-      for (int i = 0; i < vol->width_; ++i) {
-        for (int j = 0; j < vol->height_; ++j) {
-          data.push_back(img.pixel(j, i) & 0xFF);
-        }
-      }
+std::string CacheDirectory() {
+  boost::filesystem::path dir;
+  if (const char* xdg_cache = std::getenv("XDG_CACHE_HOME"))
+    dir = xdg_cache;
+  else if (const char* home = std::getenv("HOME"))
+    dir = boost::filesystem::path(home) / ".cache";
+  else
+    dir = boost::filesystem::temp_directory_path();
+  dir /= "volrendapp";
+
+  boost::system::error_code error;
+  boost::filesystem::create_directories(dir, error);
+  return dir.string();
+}
+
+std::string VolumeCacheFilename(uint64_t key) {
+  std::stringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << key << ".vol";
+  return (boost::filesystem::path(CacheDirectory()) / name.str()).string();
+}
+
+bool DecodeDicomSlices(const std::vector<boost::filesystem::path>& paths,
+                       int first, int count, int width, int height,
+                       uchar* data) {
+  const size_t kSliceVoxels = static_cast<size_t>(width) * height;
+  bool failed = false;
+
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < count; ++i) {
+    if (!DecodeSlice(paths[first + i], width, height,
+                     data + kSliceVoxels * i)) {
+#pragma omp atomic write
+      failed = true;
     }
   }
 
-  const int kDataSize = data.size();
+  return !failed;
+}
+
+bool StreamSlices(const std::vector<boost::filesystem::path>& paths, int width,
+                  int height, int slab_depth, PixelUnpackRing* ring,
+                  VolumeFileWriter* cache, std::vector<double>* histogram,
+                  OccupancyGrid* occupancy, GLuint* texture, GLuint* gradients,
+                  std::vector<double>* joint_histogram, LoadTimes* times) {
+  const int kDepth = paths.size();
+  const size_t kSliceVoxels = static_cast<size_t>(width) * height;
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  *texture = CreateVolumeTexture(width, height, kDepth);
+  times->upload += ElapsedMilliseconds(start);
+
+  start = std::chrono::steady_clock::now();
+  *gradients = CreateGradientTexture(nullptr, width, height, kDepth);
+  times->gradients += ElapsedMilliseconds(start);
+
+  /* The slots are mapped write only, so every slab is decoded and consumed
+   * on the host and copied into its slot afterwards. The slab is decoded
+   * after the last two slices of the previous one, the neighbours of the
+   * slice whose gradients are still missing */
+  std::vector<uchar> window(kSliceVoxels * (slab_depth + 2));
+  uchar* slab = window.data() + 2 * kSliceVoxels;
+  std::vector<uchar> slab_gradients(4 * kSliceVoxels * (slab_depth + 1));
+  int slot = 0;
+  for (int z = 0; z < kDepth; z += slab_depth) {
+    const int kSlices = std::min(slab_depth, kDepth - z);
+    const size_t kSlabVoxels = kSliceVoxels * kSlices;
+
+    start = std::chrono::steady_clock::now();
+    if (!DecodeDicomSlices(paths, z, kSlices, width, height, slab)) {
+      glDeleteTextures(1, texture);
+      glDeleteTextures(1, gradients);
+      *texture = 0;
+      *gradients = 0;
+      return false;
+    }
+    times->decode += ElapsedMilliseconds(start);
 
-  // Generate the 3D texture.
-  for (int i = 0; i < kDataSize; i++) {
-    vol->histogram_[static_cast<int>(data[i])] += 1.0;
+    start = std::chrono::steady_clock::now();
+    AccumulateHistogram(slab, kSlabVoxels, histogram);
+    times->histogram += ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    if (occupancy != nullptr) occupancy->Accumulate(slab, z, kSlices);
+    times->occupancy += ElapsedMilliseconds(start);
+
+    /* From the last slice of the previous slab to the one before the last of
+     * this slab, or to the end of the volume */
+    start = std::chrono::steady_clock::now();
+    const int kFirst = std::max(z - 1, 0);
+    const int kLast = z + kSlices == kDepth ? kDepth : z + kSlices - 1;
+    const uchar* kFirstSlice = window.data() + (kFirst - z + 2) * kSliceVoxels;
+    if (kLast > kFirst) {
+      ComputeGradientSlices(kFirstSlice, width, height, kDepth, kFirst,
+                            kLast - kFirst, slab_gradients.data());
+      AccumulateJointHistogram(kFirstSlice, slab_gradients.data(),
+                               kSliceVoxels * (kLast - kFirst),
+                               joint_histogram);
+      glBindTexture(GL_TEXTURE_3D, *gradients);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, kFirst, width, height,
+                      kLast - kFirst, GL_RGBA, GL_UNSIGNED_BYTE,
+                      slab_gradients.data());
+    }
+    times->gradients += ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    if (cache != nullptr) cache->Append(slab, kSlabVoxels);
+    times->cache += ElapsedMilliseconds(start);
+
+    /* Waits only if the GPU is still reading this slot */
+    start = std::chrono::steady_clock::now();
+    std::memcpy(ring->Acquire(slot), slab, kSlabVoxels);
+    ring->Upload(slot, *texture, width, height, z, kSlices);
+    times->upload += ElapsedMilliseconds(start);
+
+    /* The last two slices of the window precede the next slab */
+    std::memmove(window.data(), slab + kSlabVoxels - 2 * kSliceVoxels,
+                 2 * kSliceVoxels);
+
+    slot = (slot + 1) % ring->GetSlotCount();
   }
 
-  glGenTextures(1, &vol->id_);
-  glBindTexture(GL_TEXTURE_3D, vol->id_);
-  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER,
-                  GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP);
-  glTexImage3D(GL_TEXTURE_3D, 0, GL_RED, vol->width_, vol->height_, vol->depth_,
-               0, GL_RED, GL_UNSIGNED_BYTE, &data[0]);
+  start = std::chrono::steady_clock::now();
+  glBindTexture(GL_TEXTURE_3D, *texture);
   glGenerateMipmap(GL_TEXTURE_3D);
+  glFinish();
+  times->upload += ElapsedMilliseconds(start);
+
+  return true;
+}
+
+void AccumulateHistogram(const uchar* data, size_t size,
+                         std::vector<double>* histogram) {
+  std::vector<size_t> counts(kHistogramSize, 0);
+
+#pragma omp parallel
+  {
+    /* Per thread sub-histograms, merged at the end */
+    std::vector<size_t> local(kHistogramSize, 0);
 
+#pragma omp for schedule(static)
+    for (long long i = 0; i < static_cast<long long>(size); ++i)
+      local[data[i]]++;
+
+#pragma omp critical
+    for (int i = 0; i < kHistogramSize; ++i) counts[i] += local[i];
+  }
+
+  for (int i = 0; i < kHistogramSize; ++i)
+    (*histogram)[i] += static_cast<double>(counts[i]);
+}
+
+void NormalizeHistogram(std::vector<double>* histogram) {
   std::vector<double> sorted_histogram_;
-  sorted_histogram_.insert(sorted_histogram_.begin(), vol->histogram_.begin(),
-                           vol->histogram_.end());
+  sorted_histogram_.insert(sorted_histogram_.begin(), histogram->begin(),
+                           histogram->end());
   sort(sorted_histogram_.begin(), sorted_histogram_.end());
 
   const double kMaximum = sorted_histogram_[sorted_histogram_.size() * 0.98];
 
-  const int kHistSize = vol->histogram_.size();
+  const int kHistSize = histogram->size();
   for (int i = 0; i < kHistSize; ++i) {
-    vol->histogram_[i] = vol->histogram_[i] / kMaximum;
+    (*histogram)[i] = (*histogram)[i] / kMaximum;
+  }
+}
+
+void AccumulateJointHistogram(const uchar* data, const uchar* gradients,
+                              size_t size, std::vector<double>* histogram) {
+  const int kBins = kHistogramSize * kHistogramSize;
+  std::vector<size_t> counts;
+
+#pragma omp parallel
+  {
+    const int kThreads = omp_get_num_threads();
+#pragma omp single
+    counts.assign(static_cast<size_t>(kThreads) * kBins, 0);
+
+    /* Per thread sub-histograms, too large to be merged one at a time */
+    size_t* local = &counts[static_cast<size_t>(omp_get_thread_num()) * kBins];
+#pragma omp for schedule(static)
+    for (long long i = 0; i < static_cast<long long>(size); ++i)
+      local[gradients[4 * i + 3] * kHistogramSize + data[i]]++;
+
+#pragma omp for schedule(static)
+    for (int bin = 0; bin < kBins; ++bin) {
+      size_t count = 0;
+      for (int thread = 0; thread < kThreads; ++thread)
+        count += counts[static_cast<size_t>(thread) * kBins + bin];
+      (*histogram)[bin] += static_cast<double>(count);
+    }
+  }
+}
+
+void NormalizeJointHistogram(std::vector<double>* histogram) {
+  double maximum = 0.0;
+  for (double& count : *histogram) {
+    count = std::log1p(count);
+    maximum = std::max(maximum, count);
+  }
+
+  if (maximum > 0.0)
+    for (double& count : *histogram) count /= maximum;
+}
+
+GLuint CreateVolumeTexture(int width, int height, int depth) {
+  GLuint id;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_3D, id);
+  SetTextureParameters();
+
+  if (GLEW_ARB_texture_storage)
+    glTexStorage3D(GL_TEXTURE_3D, MipLevels(width, height, depth), GL_R8,
+                   width, height, depth);
+  else
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, width, height, depth, 0, GL_RED,
+                 GL_UNSIGNED_BYTE, nullptr);
+
+  return id;
+}
+
+void ComputeGradients(const uchar* data, int width, int height, int depth,
+                      uchar* gradients) {
+  ComputeGradientSlices(data, width, height, depth, 0, depth, gradients);
+}
+
+void ComputeGradientSlices(const uchar* data, int width, int height,
+                           int depth, int first, int count,
+                           uchar* gradients) {
+  const ptrdiff_t kSliceVoxels = static_cast<ptrdiff_t>(width) * height;
+
+#pragma omp parallel for schedule(static)
+  for (int z = 0; z < count; ++z) {
+    /* The neighbours are clamped to the volume, not to the slices given */
+    const uchar* slice = data + z * kSliceVoxels;
+    const uchar* back =
+        data + (std::max(first + z - 1, 0) - first) * kSliceVoxels;
+    const uchar* front =
+        data + (std::min(first + z + 1, depth - 1) - first) * kSliceVoxels;
+    for (int y = 0; y < height; ++y) {
+      const size_t kRow = static_cast<size_t>(y) * width;
+      const uchar* row = slice + kRow;
+      const uchar* down =
+          slice + static_cast<size_t>(std::max(y - 1, 0)) * width;
+      const uchar* up =
+          slice + static_cast<size_t>(std::min(y + 1, height - 1)) * width;
+      const uchar* back_row = back + kRow;
+      const uchar* front_row = front + kRow;
+      uchar* out = gradients + 4 * (z * kSliceVoxels + kRow);
+
+#pragma omp simd
+      for (int x = 0; x < width; ++x) {
+        const int kLeft = x > 0 ? x - 1 : 0;
+        const int kRight = x < width - 1 ? x + 1 : width - 1;
+        const float kX = 0.5f * (row[kRight] - row[kLeft]);
+        const float kY = 0.5f * (up[x] - down[x]);
+        const float kZ = 0.5f * (front_row[x] - back_row[x]);
+        const float kMagnitude = std::sqrt(kX * kX + kY * kY + kZ * kZ);
+        const float kScale = kMagnitude > 0.0f ? 127.5f / kMagnitude : 0.0f;
+
+        out[4 * x] = static_cast<uchar>(127.5f - kX * kScale);
+        out[4 * x + 1] = static_cast<uchar>(127.5f - kY * kScale);
+        out[4 * x + 2] = static_cast<uchar>(127.5f - kZ * kScale);
+        out[4 * x + 3] = static_cast<uchar>(std::min(kMagnitude, 255.0f));
+      }
+    }
+  }
+}
+
+GLuint CreateGradientTexture(const uchar* gradients, int width, int height,
+                             int depth) {
+  GLuint id;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_3D, id);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, width, height, depth, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, gradients);
+
+  return id;
+}
+
+bool MapDicomVolume(const std::string& path, VolumeFile* file) {
+  const boost::filesystem::path kDir = boost::filesystem::path(path);
+  std::vector<boost::filesystem::path> paths;
+  if (!ScanDicomDirectory(kDir, &paths)) return false;
+
+  const uint64_t kKey = DicomSourceKey(kDir, paths);
+  const std::string kCacheFilename = VolumeCacheFilename(kKey);
+  if (file->Open(kCacheFilename) && file->GetHeader().source_key == kKey &&
+      file->GetHeader().depth == static_cast<int>(paths.size()))
+    return true;
+  file->Close();
+
+  const QSize kFirstSlice =
+      QImageReader(QString::fromStdString(paths[0].string())).size();
+  if (!kFirstSlice.isValid()) return false;
+
+  const int kWidth = kFirstSlice.width();
+  const int kHeight = kFirstSlice.height();
+  const int kDepth = paths.size();
+  const size_t kDataSize = static_cast<size_t>(kWidth) * kHeight * kDepth;
+  std::vector<uchar> data(kDataSize);
+  if (!DecodeDicomSlices(paths, 0, kDepth, kWidth, kHeight, data.data()))
+    return false;
+
+  std::vector<double> histogram(kHistogramSize, 0.0);
+  AccumulateHistogram(data.data(), kDataSize, &histogram);
+
+  /* The voxels are mapped from the cache, so that they are not held twice */
+  VolumeFileHeader header;
+  VolumeFile::InitHeader(kWidth, kHeight, kDepth, kKey, &header);
+  std::copy(histogram.begin(), histogram.end(), header.histogram);
+  if (!VolumeFile::Write(kCacheFilename, header, data.data())) {
+    std::cerr << "Could not write the volume cache " << kCacheFilename
+              << std::endl;
+    return false;
   }
 
+  return file->Open(kCacheFilename);
+}
+
+bool ReadFromDicom(const std::string& path, Volume* vol) {
+  const boost::filesystem::path kDir = boost::filesystem::path(path);
+  LoadTimes times;
+
+  /* Scan the directory first, so that the voxel buffer is allocated once */
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+  std::vector<boost::filesystem::path> paths;
+  if (!ScanDicomDirectory(kDir, &paths)) return false;
+
+  const uint64_t kKey = DicomSourceKey(kDir, paths);
+  const std::string kCacheFilename = VolumeCacheFilename(kKey);
+  times.scan = ElapsedMilliseconds(start);
+
+  /* A cached volume goes straight from the mapped pages to the texture */
+  VolumeFile cache;
+  if (cache.Open(kCacheFilename) && cache.GetHeader().source_key == kKey &&
+      cache.GetHeader().depth == static_cast<int>(paths.size())) {
+    const VolumeFileHeader& header = cache.GetHeader();
+    vol->width_ = header.width;
+    vol->height_ = header.height;
+    vol->depth_ = header.depth;
+    vol->histogram_.assign(header.histogram, header.histogram + kHistogramSize);
+    NormalizeHistogram(&vol->histogram_);
+
+    start = std::chrono::steady_clock::now();
+    vol->occupancy_.reset(new OccupancyGrid);
+    vol->occupancy_->Init(vol->width_, vol->height_, vol->depth_,
+                          kOccupancyCellSize);
+    vol->occupancy_->Accumulate(cache.GetData(), 0, vol->depth_);
+    times.occupancy = ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    vol->gradient_id_ =
+        UploadGradients(cache.GetData(), vol->width_, vol->height_,
+                        vol->depth_, &vol->joint_histogram_);
+    times.gradients = ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    vol->id_ = UploadTexture(cache.GetData(), vol->width_, vol->height_,
+                             vol->depth_);
+    times.upload = ElapsedMilliseconds(start);
+
+    std::cout << "Volume loaded from cache " << kCacheFilename << ": "
+              << vol->width_ << " x " << vol->height_ << " x " << vol->depth_
+              << std::endl;
+    PrintLoadTimes(times);
+
+    return true;
+  }
+  cache.Close();
+
+  /* Only the header of the first slice is read to get the dimensions */
+  const QSize kFirstSlice =
+      QImageReader(QString::fromStdString(paths[0].string())).size();
+  if (!kFirstSlice.isValid()) return false;
+
+  vol->width_ = kFirstSlice.width();
+  vol->height_ = kFirstSlice.height();
+  vol->depth_ = paths.size();
+  vol->histogram_.assign(kHistogramSize, 0.0);
+  vol->occupancy_.reset(new OccupancyGrid);
+  vol->occupancy_->Init(vol->width_, vol->height_, vol->depth_,
+                        kOccupancyCellSize);
+
+  const size_t kSliceVoxels = static_cast<size_t>(vol->width_) * vol->height_;
+  const size_t kDataSize = kSliceVoxels * vol->depth_;
+
+  /* The decoded volume is kept for the next time the stack is opened */
+  VolumeFileHeader header;
+  VolumeFile::InitHeader(vol->width_, vol->height_, vol->depth_, kKey, &header);
+  VolumeFileWriter writer;
+  const bool kCaching = writer.Open(kCacheFilename, header);
+  if (!kCaching)
+    std::cerr << "Could not write the volume cache " << kCacheFilename
+              << std::endl;
+
+  /* Stream the slices through the GPU if possible, so that only a few slabs
+   * are held in host memory */
+  const int kSlabDepth = std::max<int>(
+      1, std::min<size_t>(vol->depth_, kStreamingSlabSize / kSliceVoxels));
+  PixelUnpackRing ring;
+  if (PixelUnpackRing::IsSupported() &&
+      ring.Init(kSlabDepth * kSliceVoxels, kStreamingSlots)) {
+    vol->joint_histogram_.assign(kHistogramSize * kHistogramSize, 0.0);
+    if (!StreamSlices(paths, vol->width_, vol->height_, kSlabDepth, &ring,
+                      kCaching ? &writer : nullptr, &vol->histogram_,
+                      vol->occupancy_.get(),
+                      &vol->id_, &vol->gradient_id_, &vol->joint_histogram_,
+                      &times))
+      return false;
+    NormalizeJointHistogram(&vol->joint_histogram_);
+  } else {
+    start = std::chrono::steady_clock::now();
+    std::vector<uchar> data(kDataSize);
+    if (!DecodeDicomSlices(paths, 0, vol->depth_, vol->width_, vol->height_,
+                      data.data()))
+      return false;
+    times.decode = ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    AccumulateHistogram(data.data(), kDataSize, &vol->histogram_);
+    times.histogram = ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    vol->occupancy_->Accumulate(data.data(), 0, vol->depth_);
+    times.occupancy = ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    vol->gradient_id_ =
+        UploadGradients(data.data(), vol->width_, vol->height_, vol->depth_,
+                        &vol->joint_histogram_);
+    times.gradients = ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    writer.Append(data.data(), kDataSize);
+    times.cache = ElapsedMilliseconds(start);
+
+    // Generate the 3D texture.
+    start = std::chrono::steady_clock::now();
+    vol->id_ =
+        UploadTexture(data.data(), vol->width_, vol->height_, vol->depth_);
+    times.upload = ElapsedMilliseconds(start);
+  }
+
+  start = std::chrono::steady_clock::now();
+  if (kCaching && !writer.Finish(vol->histogram_.data()))
+    std::cerr << "Could not write the volume cache " << kCacheFilename
+              << std::endl;
+  times.cache += ElapsedMilliseconds(start);
+
+  NormalizeHistogram(&vol->histogram_);
+
   std::cout << "Volume loaded, 3D texture built: " << vol->width_ << " x "
             << vol->height_ << " x " << vol->depth_ << std::endl;
+  PrintLoadTimes(times);
 
   return true;
 }
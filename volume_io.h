@@ -5,13 +5,29 @@
 
 #include <volume.h>
 
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace data_representation {
 
+class OccupancyGrid;
+class PixelUnpackRing;
+class VolumeFile;
+class VolumeFileWriter;
+
+/**
+ * @brief kHistogramSize Number of bins of a volume histogram, one per density.
+ */
+const int kHistogramSize = 256;
+
 /**
  * @brief ReadFromDicom Reads a stack of images in Dicom format and generated
- * the appropiate 3D textures.
+ * the appropiate 3D textures. The decoded volume is cached in the native
+ * format (see VolumeFile) under $XDG_CACHE_HOME/volrendapp, keyed by the
+ * slice names, sizes and modification times, and mapped on later loads.
  * @param filename The path to the file containing the name of the dicom files
  * that compose the volume.
  * @param vol The resulting volumetric representation.
@@ -19,6 +35,187 @@ namespace data_representation {
  */
 bool ReadFromDicom(const std::string &filename, Volume *vol);
 
+/**
+ * @brief MapDicomVolume Maps the voxels of a stack for use on the host, e.g.
+ * by the CPU ray caster. A stack that is not cached yet is decoded and cached
+ * first. It does not need a GL context.
+ * @param path The directory containing the images.
+ * @param file The mapped volume.
+ * @return Whether the stack could be read and cached.
+ */
+bool MapDicomVolume(const std::string &path, VolumeFile *file);
+
+/**
+ * @brief ScanDicomDirectory Lists the slices of a stack, in stack order.
+ * @param dir Directory containing the images.
+ * @param slices The sorted list of slice paths.
+ * @return Whether the directory contains any slice.
+ */
+bool ScanDicomDirectory(const boost::filesystem::path &dir,
+                        std::vector<boost::filesystem::path> *slices);
+
+/**
+ * @brief DicomSourceKey Hashes (FNV-1a) the directory, the name, size and
+ * modification time of every slice, so that any change in the stack
+ * invalidates its cached volume.
+ */
+uint64_t DicomSourceKey(const boost::filesystem::path &dir,
+                        const std::vector<boost::filesystem::path> &slices);
+
+/**
+ * @brief CacheDirectory Returns the directory of the caches of the
+ * application, $XDG_CACHE_HOME/volrendapp, creating it if needed.
+ */
+std::string CacheDirectory();
+
+/**
+ * @brief VolumeCacheFilename Returns the path of the cached volume for a key,
+ * creating the cache directory ($XDG_CACHE_HOME/volrendapp) if needed.
+ */
+std::string VolumeCacheFilename(uint64_t key);
+
+/**
+ * @brief DecodeDicomSlices Decodes a range of slices concurrently, each one
+ * into its own spot of the destination buffer.
+ * @param paths The slices of the stack.
+ * @param first First slice to decode.
+ * @param count Number of slices to decode.
+ * @param width Expected slice width.
+ * @param height Expected slice height.
+ * @param data Destination of count * width * height voxels.
+ * @return Whether all the slices could be decoded.
+ */
+bool DecodeDicomSlices(const std::vector<boost::filesystem::path> &paths,
+                       int first, int count, int width, int height,
+                       unsigned char *data);
+
+/**
+ * @brief LoadTimes Wall time spent in every phase of a load, in
+ * milliseconds.
+ */
+struct LoadTimes {
+  double scan = 0.0;
+  double decode = 0.0;
+  double histogram = 0.0;
+  double occupancy = 0.0;
+  double gradients = 0.0;
+  double cache = 0.0;
+  double upload = 0.0;
+};
+
+/**
+ * @brief StreamSlices Decodes the stack slab by slab, copies every slab into
+ * a slot of a pixel unpack ring, and uploads it while the next one is
+ * decoded, as ReadFromDicom does with the stacks that are not cached. The
+ * gradients of every slab are computed and uploaded as it streams, one slice
+ * behind, since the last slice of a slab needs the first one of the next.
+ * Only a slab with the two slices before it, its gradients and the ring are
+ * held in host memory.
+ * @param paths The slices of the stack.
+ * @param width Slice width.
+ * @param height Slice height.
+ * @param slab_depth Number of slices per slab, the ring slots must hold them.
+ * @param ring The pixel unpack ring.
+ * @param cache Writer of the cached volume, or null.
+ * @param histogram The resulting (unnormalized) histogram.
+ * @param occupancy The occupancy grid sized for the volume, or null.
+ * @param texture The resulting 3D texture (see CreateVolumeTexture), with its
+ * mipmaps.
+ * @param gradients The resulting 3D texture of the gradients (see
+ * CreateGradientTexture).
+ * @param joint_histogram The resulting (unnormalized) joint histogram of the
+ * densities and gradient magnitudes.
+ * @param times Time spent in every phase.
+ * @return Whether all the slices could be decoded.
+ */
+bool StreamSlices(const std::vector<boost::filesystem::path> &paths,
+                  int width, int height, int slab_depth,
+                  PixelUnpackRing *ring, VolumeFileWriter *cache,
+                  std::vector<double> *histogram, OccupancyGrid *occupancy,
+                  GLuint *texture, GLuint *gradients,
+                  std::vector<double> *joint_histogram, LoadTimes *times);
+
+/**
+ * @brief AccumulateHistogram Adds the occurrences of every density value to a
+ * histogram of kHistogramSize bins.
+ * @param data The voxel data.
+ * @param size Number of voxels.
+ * @param histogram The (unnormalized) histogram.
+ */
+void AccumulateHistogram(const unsigned char *data, size_t size,
+                         std::vector<double> *histogram);
+
+/**
+ * @brief NormalizeHistogram Scales the histogram so that the 98th percentile
+ * bin is one.
+ */
+void NormalizeHistogram(std::vector<double> *histogram);
+
+/**
+ * @brief AccumulateJointHistogram Adds the occurrences of every pair of
+ * density and gradient magnitude to a joint histogram of kHistogramSize x
+ * kHistogramSize bins, in rows by magnitude, in a single pass. Every thread
+ * counts into its own sub-histogram, and the sub-histograms are summed bin by
+ * bin by all the threads.
+ * @param data The voxel data.
+ * @param gradients The packed gradients of the voxels (see ComputeGradients).
+ * @param size Number of voxels.
+ * @param histogram The (unnormalized) histogram.
+ */
+void AccumulateJointHistogram(const unsigned char *data,
+                              const unsigned char *gradients, size_t size,
+                              std::vector<double> *histogram);
+
+/**
+ * @brief NormalizeJointHistogram Replaces the counts by their logarithm,
+ * scaled so that the largest bin is one. The empty space alone outnumbers
+ * the boundaries by orders of magnitude.
+ */
+void NormalizeJointHistogram(std::vector<double> *histogram);
+
+/**
+ * @brief CreateVolumeTexture Generates a 3D texture of GL_R8 voxels with room
+ * for its mipmaps. The storage is immutable when the context supports it.
+ * @return The 3D texture id.
+ */
+GLuint CreateVolumeTexture(int width, int height, int depth);
+
+/**
+ * @brief ComputeGradients Computes the gradient of every voxel by central
+ * differences (one sided on the borders). Every gradient is packed in four
+ * bytes: the unit normal pointing towards lower densities, mapped from
+ * [-1, 1] to [0, 255], and the gradient magnitude in density units per voxel,
+ * clamped to 255.
+ * @param data The voxels, width * height * depth bytes.
+ * @param gradients Destination of 4 * width * height * depth bytes.
+ */
+void ComputeGradients(const unsigned char *data, int width, int height,
+                      int depth, unsigned char *gradients);
+
+/**
+ * @brief ComputeGradientSlices Computes the gradients of count slices of a
+ * volume, from slice first on, as ComputeGradients does for the whole
+ * volume. Only those slices and their neighbours are read, so that a volume
+ * can be processed slab by slab.
+ * @param data The voxels of slice first, preceded by slice first - 1 and
+ * followed by slice first + count where those are inside the volume.
+ * @param depth Number of slices of the volume.
+ * @param gradients Destination of 4 * width * height * count bytes.
+ */
+void ComputeGradientSlices(const unsigned char *data, int width, int height,
+                           int depth, int first, int count,
+                           unsigned char *gradients);
+
+/**
+ * @brief CreateGradientTexture Generates a GL_RGBA8 3D texture from the
+ * output of ComputeGradients.
+ * @param gradients The packed gradients, or null to only allocate the
+ * texture.
+ * @return The 3D texture id.
+ */
+GLuint CreateGradientTexture(const unsigned char *gradients, int width,
+                             int height, int depth);
+
 }  // namespace data_representation
 
 #endif  // VOLUME_IO_H_
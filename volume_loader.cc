@@ -0,0 +1,463 @@
+#include <volume_loader.h>
+
+#include <QImageReader>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "./brick_cache.h"
+#include "./volume_io.h"
+
+namespace data_representation {
+
+VolumeLoader::VolumeLoader()
+    : vol_(nullptr),
+      state_(kIdle),
+      budget_(0),
+      max_texture_size_(0),
+      cancelled_(false),
+      dimensions_ready_(false),
+      slots_ready_(false),
+      decoded_(false),
+      failed_(false),
+      from_cache_(false),
+      bricked_(false),
+      width_(0),
+      height_(0),
+      depth_(0),
+      slab_depth_(0),
+      built_slices_(0),
+      next_upload_(0),
+      uploaded_slices_(0) {}
+
+VolumeLoader::~VolumeLoader() { Cancel(); }
+
+void VolumeLoader::Start(const std::string& path, Volume* vol,
+                         size_t budget) {
+  Cancel();
+
+  path_ = path;
+  vol_ = vol;
+  budget_ = budget;
+  glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &max_texture_size_);
+  state_ = kLoading;
+  cancelled_ = false;
+  dimensions_ready_ = false;
+  slots_ready_ = false;
+  decoded_ = false;
+  failed_ = false;
+  from_cache_ = false;
+  bricked_ = false;
+  width_ = height_ = depth_ = slab_depth_ = 0;
+  slots_.clear();
+  histogram_.clear();
+  bricks_.reset();
+  built_slices_ = 0;
+  occupancy_.reset(new OccupancyGrid);
+  gradients_.clear();
+  joint_histogram_.clear();
+  next_upload_ = 0;
+  uploaded_slices_ = 0;
+
+  worker_ = std::thread(&VolumeLoader::Run, this);
+}
+
+VolumeLoader::State VolumeLoader::Poll() {
+  if (state_ != kLoading) return state_;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (failed_) {
+    lock.unlock();
+    Cancel();
+    state_ = kFailed;
+    return state_;
+  }
+
+  if (!dimensions_ready_) return state_;
+
+  if (bricked_) {
+    lock.unlock();
+    FinishBricked();
+    state_ = kFinished;
+    return state_;
+  }
+
+  if (vol_->id_ == 0) CreateTexture();
+
+  if (from_cache_) {
+    /* One slab per call, straight from the mapped pages */
+    const int kZ = uploaded_slices_;
+    const int kSlices = std::min(slab_depth_, depth_ - kZ);
+    const size_t kOffset = static_cast<size_t>(width_) * height_ * kZ;
+    glBindTexture(GL_TEXTURE_3D, vol_->id_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, kZ, width_, height_, kSlices,
+                    GL_RED, GL_UNSIGNED_BYTE, cache_.GetData() + kOffset);
+    uploaded_slices_ += kSlices;
+  } else {
+    bool freed = false;
+    const bool kStaged = ring_.GetSlotCount() > 0;
+
+    if (kStaged) {
+      for (size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].state == kSlotUploading && ring_.IsAvailable(i)) {
+          slots_[i].state = kSlotFree;
+          freed = true;
+        }
+      }
+    }
+
+    /* Slabs are uploaded in the order they were decoded */
+    while (slots_[next_upload_].state == kSlotReady) {
+      Slot& slot = slots_[next_upload_];
+      if (kStaged) {
+        ring_.Upload(next_upload_, vol_->id_, width_, height_, slot.z,
+                     slot.depth);
+        slot.state = kSlotUploading;
+      } else {
+        glBindTexture(GL_TEXTURE_3D, vol_->id_);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, slot.z, width_, height_,
+                        slot.depth, GL_RED, GL_UNSIGNED_BYTE, slot.data);
+        slot.state = kSlotFree;
+        freed = true;
+      }
+      uploaded_slices_ += slot.depth;
+      next_upload_ = (next_upload_ + 1) % slots_.size();
+    }
+
+    if (freed) condition_.notify_all();
+  }
+
+  if (uploaded_slices_ == depth_ && decoded_) {
+    lock.unlock();
+    Finish();
+    state_ = kFinished;
+  }
+
+  return state_;
+}
+
+void VolumeLoader::Cancel() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+  }
+  condition_.notify_all();
+  if (worker_.joinable()) worker_.join();
+
+  ring_.Release();
+  host_slots_.clear();
+  cache_.Close();
+  bricks_.reset();
+
+  if (state_ == kLoading) state_ = kCancelled;
+}
+
+float VolumeLoader::GetProgress() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (depth_ == 0) return 0.0f;
+  return static_cast<float>(std::max<int>(uploaded_slices_, built_slices_)) /
+         depth_;
+}
+
+bool VolumeLoader::HasData() const { return uploaded_slices_ > 0; }
+
+void VolumeLoader::Run() {
+  const boost::filesystem::path kDir(path_);
+
+  std::vector<boost::filesystem::path> paths;
+  if (!ScanDicomDirectory(kDir, &paths)) {
+    Fail();
+    return;
+  }
+
+  const uint64_t kKey = DicomSourceKey(kDir, paths);
+  const std::string kCacheFilename = VolumeCacheFilename(kKey);
+  const std::string kBrickFilename = BrickStore::Filename(kKey);
+
+  /* Volumes that do not fit in a single texture or in the budget are
+   * rendered out-of-core */
+  const auto kOutOfCore = [this](int width, int height, int depth) {
+    return std::max(width, std::max(height, depth)) > max_texture_size_ ||
+           static_cast<size_t>(width) * height * depth > budget_;
+  };
+
+  /* The GL thread reads cache_ only once from_cache_ is published */
+  if (cache_.Open(kCacheFilename) && cache_.GetHeader().source_key == kKey &&
+      cache_.GetHeader().depth == static_cast<int>(paths.size()) &&
+      !kOutOfCore(cache_.GetHeader().width, cache_.GetHeader().height,
+                  cache_.GetHeader().depth)) {
+    const VolumeFileHeader& header = cache_.GetHeader();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      width_ = header.width;
+      height_ = header.height;
+      depth_ = header.depth;
+      histogram_.assign(header.histogram, header.histogram + kHistogramSize);
+      from_cache_ = true;
+      dimensions_ready_ = true;
+    }
+
+    /* The grid is built while the GL thread uploads the mapped slabs */
+    occupancy_->Init(header.width, header.height, header.depth,
+                     kOccupancyCellSize);
+    occupancy_->Accumulate(cache_.GetData(), 0, header.depth);
+    ComputeGradients(cache_.GetData(), header.width, header.height,
+                     header.depth);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoded_ = true;
+    return;
+  }
+  cache_.Close();
+
+  std::unique_ptr<BrickStore> bricks(new BrickStore);
+  if (bricks->Open(kBrickFilename) &&
+      bricks->GetHeader().source_key == kKey &&
+      bricks->GetHeader().depth == static_cast<int>(paths.size())) {
+    PublishBricks(std::move(bricks));
+    return;
+  }
+
+  const QSize kFirstSlice =
+      QImageReader(QString::fromStdString(paths[0].string())).size();
+  if (!kFirstSlice.isValid()) {
+    Fail();
+    return;
+  }
+
+  const int kWidth = kFirstSlice.width();
+  const int kHeight = kFirstSlice.height();
+  const int kDepth = paths.size();
+  const size_t kSliceVoxels = static_cast<size_t>(kWidth) * kHeight;
+  const bool kBricked = kOutOfCore(kWidth, kHeight, kDepth);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    width_ = kWidth;
+    height_ = kHeight;
+    depth_ = kDepth;
+    dimensions_ready_ = !kBricked;
+  }
+
+  if (kBricked) {
+    if (!BrickStore::Build(paths, kWidth, kHeight, kKey, kBrickFilename,
+                           &built_slices_, &cancelled_)) {
+      if (!cancelled_) {
+        std::cerr << "Could not write the brick store " << kBrickFilename
+                  << std::endl;
+        Fail();
+      }
+      return;
+    }
+
+    if (!bricks->Open(kBrickFilename)) {
+      Fail();
+      return;
+    }
+
+    PublishBricks(std::move(bricks));
+    return;
+  }
+
+  VolumeFileHeader header;
+  VolumeFile::InitHeader(kWidth, kHeight, kDepth, kKey, &header);
+  VolumeFileWriter writer;
+  const bool kCaching = writer.Open(kCacheFilename, header);
+  std::vector<double> histogram(kHistogramSize, 0.0);
+  occupancy_->Init(kWidth, kHeight, kDepth, kOccupancyCellSize);
+
+  /* Wait for the GL thread to allocate the staging slots */
+  int slab_depth;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return slots_ready_ || cancelled_; });
+    if (cancelled_) return;
+    slab_depth = slab_depth_;
+  }
+
+  /* The slots are mapped write only, so every slab is decoded and consumed
+   * on the host and copied into its slot afterwards. The next slab is decoded
+   * while the GPU still reads the slot */
+  std::vector<unsigned char> slab(kSliceVoxels * slab_depth);
+  int slot = 0;
+  for (int z = 0; z < kDepth; z += slab_depth) {
+    const int kSlices = std::min(slab_depth, kDepth - z);
+    const size_t kSlabVoxels = kSliceVoxels * kSlices;
+
+    if (!DecodeDicomSlices(paths, z, kSlices, kWidth, kHeight, slab.data())) {
+      Fail();
+      return;
+    }
+    AccumulateHistogram(slab.data(), kSlabVoxels, &histogram);
+    occupancy_->Accumulate(slab.data(), z, kSlices);
+    if (kCaching) writer.Append(slab.data(), kSlabVoxels);
+
+    unsigned char* data;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this, slot] {
+        return cancelled_ || slots_[slot].state == kSlotFree;
+      });
+      if (cancelled_) return;
+      data = slots_[slot].data;
+    }
+    std::memcpy(data, slab.data(), kSlabVoxels);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      slots_[slot].state = kSlotReady;
+      slots_[slot].z = z;
+      slots_[slot].depth = kSlices;
+    }
+    slot = (slot + 1) % slots_.size();
+  }
+
+  if (kCaching && !writer.Finish(histogram.data()))
+    std::cerr << "Could not write the volume cache " << kCacheFilename
+              << std::endl;
+
+  /* The slabs are not kept, the gradients are computed from the cache */
+  VolumeFile cached;
+  if (kCaching && cached.Open(kCacheFilename))
+    ComputeGradients(cached.GetData(), kWidth, kHeight, kDepth);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  histogram_ = histogram;
+  decoded_ = true;
+}
+
+void VolumeLoader::PublishBricks(std::unique_ptr<BrickStore> bricks) {
+  const BrickStoreHeader& header = bricks->GetHeader();
+  std::lock_guard<std::mutex> lock(mutex_);
+  width_ = header.width;
+  height_ = header.height;
+  depth_ = header.depth;
+  histogram_.assign(header.histogram, header.histogram + kHistogramSize);
+  bricks_ = std::move(bricks);
+  bricked_ = true;
+  decoded_ = true;
+  dimensions_ready_ = true;
+}
+
+void VolumeLoader::ComputeGradients(const unsigned char* data, int width,
+                                    int height, int depth) {
+  const size_t kSize = 4 * static_cast<size_t>(width) * height * depth;
+  if (kSize > budget_) return;
+
+  gradients_.resize(kSize);
+  data_representation::ComputeGradients(data, width, height, depth,
+                                        gradients_.data());
+
+  joint_histogram_.assign(kHistogramSize * kHistogramSize, 0.0);
+  AccumulateJointHistogram(data, gradients_.data(), kSize / 4,
+                           &joint_histogram_);
+  NormalizeJointHistogram(&joint_histogram_);
+}
+
+void VolumeLoader::Fail() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  failed_ = true;
+}
+
+void VolumeLoader::CreateTexture() {
+  const size_t kSliceVoxels = static_cast<size_t>(width_) * height_;
+  slab_depth_ = std::max<int>(
+      1, std::min<size_t>(depth_, kStreamingSlabSize / kSliceVoxels));
+
+  vol_->width_ = width_;
+  vol_->height_ = height_;
+  vol_->depth_ = depth_;
+  vol_->id_ = CreateVolumeTexture(width_, height_, depth_);
+
+  /* Only the base level is sampled until the mipmaps are generated, and the
+   * slabs not loaded yet are empty */
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+  if (GLEW_ARB_clear_texture) {
+    const unsigned char kZero = 0;
+    glClearTexImage(vol_->id_, 0, GL_RED, GL_UNSIGNED_BYTE, &kZero);
+  }
+
+  if (from_cache_) return;
+
+  const size_t kSlotSize = kSliceVoxels * slab_depth_;
+  slots_.assign(kStreamingSlots, Slot{kSlotFree, nullptr, 0, 0});
+  if (PixelUnpackRing::IsSupported() &&
+      ring_.Init(kSlotSize, kStreamingSlots)) {
+    for (int i = 0; i < kStreamingSlots; ++i) slots_[i].data = ring_.Acquire(i);
+  } else {
+    host_slots_.assign(kStreamingSlots,
+                       std::vector<unsigned char>(kSlotSize));
+    for (int i = 0; i < kStreamingSlots; ++i)
+      slots_[i].data = host_slots_[i].data();
+  }
+
+  slots_ready_ = true;
+  condition_.notify_all();
+}
+
+void VolumeLoader::Finish() {
+  if (worker_.joinable()) worker_.join();
+  ring_.Release();
+  host_slots_.clear();
+  cache_.Close();
+
+  glBindTexture(GL_TEXTURE_3D, vol_->id_);
+  glGenerateMipmap(GL_TEXTURE_3D);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 1000);
+
+  vol_->histogram_ = histogram_;
+  NormalizeHistogram(&vol_->histogram_);
+  vol_->occupancy_ = std::move(occupancy_);
+
+  if (!gradients_.empty()) {
+    vol_->gradient_id_ = CreateGradientTexture(gradients_.data(), width_,
+                                               height_, depth_);
+    std::vector<unsigned char>().swap(gradients_);
+    vol_->joint_histogram_.swap(joint_histogram_);
+  }
+
+  std::cout << "Volume loaded, 3D texture built: " << vol_->width_ << " x "
+            << vol_->height_ << " x " << vol_->depth_ << std::endl;
+}
+
+void VolumeLoader::FinishBricked() {
+  if (worker_.joinable()) worker_.join();
+
+  const BrickStoreHeader& header = bricks_->GetHeader();
+  vol_->width_ = width_;
+  vol_->height_ = height_;
+  vol_->depth_ = depth_;
+  vol_->id_ = CreateVolumeTexture(header.overview[0], header.overview[1],
+                                  header.overview[2]);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, header.overview[0],
+                  header.overview[1], header.overview[2], GL_RED,
+                  GL_UNSIGNED_BYTE, bricks_->GetOverview());
+  glGenerateMipmap(GL_TEXTURE_3D);
+
+  /* Bricks are the cells of the grid, their ranges include the apron */
+  occupancy_->Init(width_, height_, depth_, kBrickSize);
+  for (int i = 0; i < bricks_->GetBrickCount(); ++i) {
+    const unsigned char* range = bricks_->GetBrickRange(i);
+    occupancy_->SetCellRange(i, range[0], range[1]);
+  }
+  vol_->occupancy_ = std::move(occupancy_);
+
+  /* Without a single brick slot only the overview is rendered */
+  vol_->brick_cache_.reset(new BrickCache);
+  if (!vol_->brick_cache_->Init(std::move(bricks_), budget_,
+                                max_texture_size_))
+    vol_->brick_cache_.reset();
+
+  vol_->histogram_ = histogram_;
+  NormalizeHistogram(&vol_->histogram_);
+  uploaded_slices_ = depth_;
+
+  std::cout << "Volume loaded, out-of-core: " << vol_->width_ << " x "
+            << vol_->height_ << " x " << vol_->depth_ << std::endl;
+}
+
+}  // namespace data_representation
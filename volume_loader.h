@@ -0,0 +1,171 @@
+#ifndef VOLUME_LOADER_H_
+#define VOLUME_LOADER_H_
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./brick_store.h"
+#include "./occupancy_grid.h"
+#include "./volume.h"
+#include "./volume_file.h"
+#include "./volume_stream.h"
+
+namespace data_representation {
+
+/**
+ * @brief VolumeLoader Loads a stack of images in the background. A worker
+ * thread scans and decodes the stack slab by slab, while the GL thread
+ * uploads every slab as soon as it is decoded, so that the volume can be
+ * displayed while it is being loaded. Stacks that do not fit in a single
+ * texture, or in the memory budget, are converted to a brick store and
+ * rendered out-of-core through a BrickCache.
+ */
+class VolumeLoader {
+ public:
+  enum State { kIdle, kLoading, kFinished, kFailed, kCancelled };
+
+  /**
+   * @brief VolumeLoader Constructor of the class.
+   */
+  VolumeLoader();
+
+  /**
+   * @brief ~VolumeLoader Destructor of the class. Calls Cancel.
+   */
+  ~VolumeLoader();
+
+  VolumeLoader(const VolumeLoader&) = delete;
+  VolumeLoader& operator=(const VolumeLoader&) = delete;
+
+  /**
+   * @brief Start Starts loading a stack, cancelling any previous load. Must be
+   * called from the GL thread.
+   * @param path Path to the stack of images.
+   * @param vol The volume to fill. It must outlive the load.
+   * @param budget GPU memory budget of the volume, in bytes.
+   */
+  void Start(const std::string& path, Volume* vol, size_t budget);
+
+  /**
+   * @brief Poll Creates the texture once the dimensions are known, uploads the
+   * slabs decoded since the last call and finishes the volume once all of them
+   * are uploaded. Must be called periodically from the GL thread.
+   * @return The state of the load.
+   */
+  State Poll();
+
+  /**
+   * @brief Cancel Stops the worker and releases the staging buffers. Must be
+   * called from the GL thread.
+   */
+  void Cancel();
+
+  /**
+   * @brief GetProgress Returns the fraction of slices uploaded, or written to
+   * the brick store, in [0, 1].
+   */
+  float GetProgress() const;
+
+  /**
+   * @brief HasData Whether the texture exists and holds at least one slab.
+   */
+  bool HasData() const;
+
+ private:
+  enum SlotState { kSlotFree, kSlotReady, kSlotUploading };
+
+  struct Slot {
+    SlotState state;
+    unsigned char* data;
+    int z;
+    int depth;
+  };
+
+  /**
+   * @brief Run Body of the worker thread.
+   */
+  void Run();
+
+  /**
+   * @brief PublishBricks Hands an opened brick store to the GL thread.
+   */
+  void PublishBricks(std::unique_ptr<BrickStore> bricks);
+
+  /**
+   * @brief ComputeGradients Computes the gradients of a volume held in host
+   * memory, and their joint histogram with the densities, if they fit in the
+   * budget.
+   */
+  void ComputeGradients(const unsigned char* data, int width, int height,
+                        int depth);
+
+  /**
+   * @brief Fail Marks the load as failed and wakes up the GL thread side.
+   */
+  void Fail();
+
+  /**
+   * @brief CreateTexture Allocates the texture and the staging slots once the
+   * dimensions are known. Called with mutex_ held.
+   */
+  void CreateTexture();
+
+  /**
+   * @brief Finish Generates the mipmaps and hands the histogram to the volume.
+   */
+  void Finish();
+
+  /**
+   * @brief FinishBricked Uploads the overview and creates the brick cache of
+   * an out-of-core volume.
+   */
+  void FinishBricked();
+
+  std::string path_;
+  Volume* vol_;
+  State state_;
+  size_t budget_;
+  int max_texture_size_;
+
+  std::thread worker_;
+  std::atomic<bool> cancelled_;
+
+  /* Shared between the worker and the GL thread, guarded by mutex_ */
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  bool dimensions_ready_;
+  bool slots_ready_;
+  bool decoded_;
+  bool failed_;
+  bool from_cache_;
+  bool bricked_;
+  int width_, height_, depth_;
+  int slab_depth_;
+  std::vector<Slot> slots_;
+  std::vector<double> histogram_;
+  VolumeFile cache_;
+  std::unique_ptr<BrickStore> bricks_;
+  std::atomic<int> built_slices_;
+
+  /* Built by the worker, read by the GL thread once it is joined */
+  std::unique_ptr<OccupancyGrid> occupancy_;
+  std::vector<unsigned char> gradients_;
+  std::vector<double> joint_histogram_;
+
+  /* Owned by the GL thread */
+  PixelUnpackRing ring_;
+  std::vector<std::vector<unsigned char>> host_slots_;
+  int next_upload_;
+  std::atomic<int> uploaded_slices_;
+};
+
+}  // namespace data_representation
+
+#endif  //  VOLUME_LOADER_H_
@@ -0,0 +1,107 @@
+#include <volume_stream.h>
+
+namespace data_representation {
+
+namespace {
+
+/* Write only: reading back from uncached, write-combined memory is slow */
+const GLbitfield kMapFlags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+/* One second, in nanoseconds */
+const GLuint64 kFenceTimeout = 1000000000;
+
+}  // namespace
+
+PixelUnpackRing::PixelUnpackRing() : slot_size_(0) {}
+
+PixelUnpackRing::~PixelUnpackRing() { Release(); }
+
+bool PixelUnpackRing::IsSupported() {
+  return GLEW_ARB_buffer_storage && GLEW_ARB_texture_storage && GLEW_ARB_sync;
+}
+
+bool PixelUnpackRing::Init(size_t slot_size, int slots) {
+  Release();
+
+  slot_size_ = slot_size;
+  buffers_.resize(slots, 0);
+  pointers_.resize(slots, nullptr);
+  fences_.resize(slots, nullptr);
+
+  glGenBuffers(slots, buffers_.data());
+  for (int i = 0; i < slots; ++i) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[i]);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, slot_size_, nullptr, kMapFlags);
+    pointers_[i] = static_cast<unsigned char*>(
+        glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slot_size_, kMapFlags));
+    if (pointers_[i] == nullptr) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      Release();
+      return false;
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  return true;
+}
+
+void PixelUnpackRing::Release() {
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    if (fences_[i] != nullptr) {
+      glClientWaitSync(fences_[i], GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeout);
+      glDeleteSync(fences_[i]);
+    }
+    if (pointers_[i] != nullptr) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[i]);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  if (!buffers_.empty()) glDeleteBuffers(buffers_.size(), buffers_.data());
+
+  buffers_.clear();
+  pointers_.clear();
+  fences_.clear();
+  slot_size_ = 0;
+}
+
+int PixelUnpackRing::GetSlotCount() const { return buffers_.size(); }
+
+unsigned char* PixelUnpackRing::Acquire(int slot) {
+  if (fences_[slot] != nullptr) {
+    while (glClientWaitSync(fences_[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                            kFenceTimeout) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fences_[slot]);
+    fences_[slot] = nullptr;
+  }
+
+  return pointers_[slot];
+}
+
+bool PixelUnpackRing::IsAvailable(int slot) {
+  if (fences_[slot] == nullptr) return true;
+
+  const GLenum kStatus = glClientWaitSync(fences_[slot], 0, 0);
+  if (kStatus == GL_TIMEOUT_EXPIRED) return false;
+
+  glDeleteSync(fences_[slot]);
+  fences_[slot] = nullptr;
+  return true;
+}
+
+void PixelUnpackRing::Upload(int slot, GLuint texture, int width, int height,
+                             int z, int depth) {
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[slot]);
+  glBindTexture(GL_TEXTURE_3D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, z, width, height, depth, GL_RED,
+                  GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  fences_[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+}  // namespace data_representation
@@ -0,0 +1,103 @@
+#ifndef VOLUME_STREAM_H_
+#define VOLUME_STREAM_H_
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief kStreamingSlabSize Slices are streamed to the GPU in slabs of about
+ * this many bytes.
+ */
+const size_t kStreamingSlabSize = 32 << 20;
+
+/**
+ * @brief kStreamingSlots Number of slabs in flight while streaming.
+ */
+const int kStreamingSlots = 3;
+
+/**
+ * @brief PixelUnpackRing A ring of persistently mapped pixel buffer objects.
+ * Slabs of slices are written into a slot and copied into a 3D texture by the
+ * GPU, while the CPU goes on filling the next slots.
+ */
+class PixelUnpackRing {
+ public:
+  /**
+   * @brief PixelUnpackRing Constructor of the class.
+   */
+  PixelUnpackRing();
+
+  /**
+   * @brief ~PixelUnpackRing Destructor of the class. Calls Release.
+   */
+  ~PixelUnpackRing();
+
+  PixelUnpackRing(const PixelUnpackRing&) = delete;
+  PixelUnpackRing& operator=(const PixelUnpackRing&) = delete;
+
+  /**
+   * @brief IsSupported Whether the context has immutable texture storage,
+   * persistent buffer mappings and sync objects (OpenGL 4.4, available on
+   * Mesa llvmpipe).
+   */
+  static bool IsSupported();
+
+  /**
+   * @brief Init Creates and maps the buffers.
+   * @param slot_size Size of every slot, in bytes.
+   * @param slots Number of slots.
+   * @return Whether the buffers could be mapped.
+   */
+  bool Init(size_t slot_size, int slots);
+
+  /**
+   * @brief Release Waits for pending uploads and deletes the buffers.
+   */
+  void Release();
+
+  /**
+   * @brief GetSlotCount Returns the number of slots.
+   */
+  int GetSlotCount() const;
+
+  /**
+   * @brief Acquire Waits until the GPU has finished reading a slot.
+   * @param slot Index of the slot.
+   * @return The mapped memory of the slot, write only.
+   */
+  unsigned char* Acquire(int slot);
+
+  /**
+   * @brief IsAvailable Whether the GPU has finished reading a slot. Does not
+   * block.
+   * @param slot Index of the slot.
+   */
+  bool IsAvailable(int slot);
+
+  /**
+   * @brief Upload Copies the slices held by a slot into a 3D texture of
+   * internal format GL_R8, and fences the slot.
+   * @param slot Index of the slot.
+   * @param texture Target texture, with immutable storage.
+   * @param width Slice width.
+   * @param height Slice height.
+   * @param z First slice of the slab.
+   * @param depth Number of slices of the slab.
+   */
+  void Upload(int slot, GLuint texture, int width, int height, int z,
+              int depth);
+
+ private:
+  size_t slot_size_;
+  std::vector<GLuint> buffers_;
+  std::vector<unsigned char*> pointers_;
+  std::vector<GLsync> fences_;
+};
+
+}  // namespace data_representation
+
+#endif  //  VOLUME_STREAM_H_